@@ -1,10 +1,16 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <vector>
+#include <fstream>
+#include <sstream>
 #include <opencv2\opencv.hpp>
 #include <opencv2\core.hpp>
 #include <opencv2\highgui.hpp>
 #include <opencv2\videoio.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 extern "C"
 {
@@ -16,7 +22,13 @@ extern "C"
 //  - 26339 - Hugo Poças
 //  - 26342 - Pedro Silva
 
-void vc_timer(void)
+// Compilação: o projecto tem três ficheiros fonte, main.cpp, vc.c (em C) e vc_kernels.cpp
+// (kernels especializados em C++, chamados por vc.c; sem ele a ligação falha). No Visual Studio
+// os três entram em "Source Files" do projecto; na linha de comandos, por exemplo:
+//   cl /O2 /EHsc /openmp /I <opencv>\include main.cpp vc.c vc_kernels.cpp /link /LIBPATH:<opencv>\x64\vc16\lib opencv_world<versão>.lib
+// /openmp é opcional (sem ele tudo corre numa thread) e /arch:AVX2 activa os caminhos AVX2 de vc.c.
+
+void vc_timer(bool pause = true)
 {
 	static bool running = false;
 	static std::chrono::steady_clock::time_point previousTime = std::chrono::steady_clock::now();
@@ -35,15 +47,18 @@ void vc_timer(void)
 		double nseconds = time_span.count();
 
 		std::cout << "Tempo decorrido: " << nseconds << "segundos" << std::endl;
-		std::cout << "Pressione qualquer tecla para continuar...\n";
-		std::cin.get();
+		if (pause)
+		{
+			std::cout << "Pressione qualquer tecla para continuar...\n";
+			std::cin.get();
+		}
 	}
 }
 
-int main(void)
+// Estado de cada fonte de vídeo: captura, pipeline (buffers e blobs seguidos) e escalonador
+struct Stream
 {
-	// V�deo
-	char videofile[] = "video_resistors.mp4";
+	std::string source;
 	cv::VideoCapture capture;
 	struct
 	{
@@ -52,97 +67,970 @@ int main(void)
 		int fps;
 		int nframe;
 	} video;
+	cv::Mat frame;
+	FRAMESVC *raw = NULL;	// Arquivo de frames descodificadas (em vez da captura)
+	cv::Mat canvas;	// Cópia da frame do arquivo para anotar (o mapeamento é só de leitura)
+	IVC image;
+	RESISTORPIPEVC *pipe;
+	SCHEDVC sched;
+	bool active;
+	std::string window;
+	cv::VideoWriter writer;
+};
+
+// Configuração lida uma vez no arranque (linha de comandos e ficheiros de configuração)
+struct Config
+{
+	std::vector<std::string> sources;	// Ficheiros de vídeo ou índices de câmaras
+	std::string output;	// Vídeo anotado ("" = não grava)
+	std::string results;	// Resultados em CSV ("" = não grava)
+	int threads = 0;	// 0 = valor por omissão do OpenMP
+	double budget = 1.0 / 60.0;	// Orçamento por frame, em segundos (0 = sem escalonador)
+	bool headless = false;	// Sem janelas
+	bool quiet = false;	// Sem relatório por frame
+	std::string sweep;	// Grelha de parâmetros a varrer ("" = processamento normal)
+	std::string groundtruth;	// Anotações para avaliar o varrimento
+	int frames = 0;	// Máximo de frames no varrimento e na regressão (0 = todas)
+	std::string record;	// Grava os checksums de referência da regressão
+	bool check = false;	// Compara com os checksums de referência
+	std::string golden = "video_resistors_regress.txt";	// Checksums de referência da comparação
+	std::string raw;	// Frames descodificadas da regressão ("" = <fonte>.raw)
+	int fuzz = 0;	// Casos aleatórios dos testes diferenciais (0 = não corre)
+	std::string decode;	// Descodifica a primeira fonte para este arquivo raw e termina
+	unsigned int seed = 1;	// Semente dos testes diferenciais
+	std::vector<std::pair<std::string, std::string>> params;	// Parâmetros do pipeline (vc_resistor_pipe_set)
+};
+
+static void config_usage(const char *program)
+{
+	std::cout << "Utilizacao: " << program << " [opcoes] [video|camara ...]\n"
+			  << "  -c ficheiro     Ficheiro de configuracao (linhas \"chave = valor\", # para comentarios)\n"
+			  << "  -i fonte        Ficheiro de video ou indice de camara (pode repetir-se)\n"
+			  << "  -o ficheiro     Grava o video anotado (com varias fontes, acrescenta o indice)\n"
+			  << "  -r ficheiro     Grava os resultados em CSV\n"
+			  << "  -t n            Numero de threads\n"
+			  << "  -b ms           Orcamento por frame (0 desliga o escalonador)\n"
+			  << "  -p chave=valor  Parametro do pipeline (hsv, closesize, minarea, roi, band.<cor>, ...)\n"
+			  << "  -q              Sem relatorio por frame\n"
+			  << "  --headless      Sem janelas\n"
+			  << "  -s ficheiro     Varrimento de parametros: linhas \"chave = v1 | v2 | ...\" (grelha completa)\n"
+			  << "  -g ficheiro     Anotacoes para o varrimento (frame x y largura altura [valor])\n"
+			  << "  -n frames       Maximo de frames do varrimento e da regressao\n"
+			  << "  --record fich.  Regressao: grava os checksums de referencia de cada operador por frame\n"
+			  << "  --check         Regressao: compara com os checksums de referencia (sai com 1 se diferirem)\n"
+			  << "  --golden fich.  Checksums de referencia do --check (por omissao, video_resistors_regress.txt,\n"
+			  << "                  gravados com a versao escalar, sem SIMD e com 1 thread, sobre video_resistors.mp4)\n"
+			  << "  --raw ficheiro  Frames descodificadas da regressao (por omissao, <fonte>.raw; criado se faltar)\n"
+			  << "  --decode fich.  Descodifica a primeira fonte (ate -n frames) para um arquivo raw e termina;\n"
+			  << "                  um ficheiro .raw pode depois ser usado como fonte, sem descodificacao\n"
+			  << "  --fuzz casos    Testes diferenciais: versoes optimizadas contra as referencias escalares\n"
+			  << "  --seed semente  Semente dos testes diferenciais (por omissao, 1)\n"
+			  << "No ficheiro de configuracao, as chaves sao input, output, results, threads, budget,\n"
+			  << "headless, quiet, sweep, groundtruth, frames, record, check, golden, raw, decode, fuzz, seed e os parametros\n"
+			  << "do pipeline.\n";
+}
+
+// Aplica uma chave; as que não são do programa ficam para o pipeline
+static bool config_set(Config &config, const std::string &key, const std::string &value)
+{
+	try
+	{
+		if (key == "input")
+			config.sources.push_back(value);
+		else if (key == "output")
+			config.output = value;
+		else if (key == "results")
+			config.results = value;
+		else if (key == "threads")
+			config.threads = std::stoi(value);
+		else if (key == "budget")
+			config.budget = std::stod(value) / 1000.0;
+		else if (key == "headless")
+			config.headless = (value != "0");
+		else if (key == "quiet")
+			config.quiet = (value != "0");
+		else if (key == "sweep")
+			config.sweep = value;
+		else if (key == "groundtruth")
+			config.groundtruth = value;
+		else if (key == "frames")
+			config.frames = std::stoi(value);
+		else if (key == "record")
+			config.record = value;
+		else if (key == "check")
+			config.check = (value != "0");
+		else if (key == "golden")
+			config.golden = value;
+		else if (key == "raw")
+			config.raw = value;
+		else if (key == "fuzz")
+			config.fuzz = std::stoi(value);
+		else if (key == "decode")
+			config.decode = value;
+		else if (key == "seed")
+			config.seed = (unsigned int)std::stoul(value);
+		else
+			config.params.push_back(std::make_pair(key, value));
+	}
+	catch (const std::exception &)
+	{
+		std::cerr << "Valor invalido para " << key << ": " << value << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+// Remove os espaços no início e no fim
+static std::string config_trim(const std::string &text)
+{
+	size_t first = text.find_first_not_of(" \t\r");
+	size_t last = text.find_last_not_of(" \t\r");
+
+	return (first == std::string::npos) ? std::string() : text.substr(first, last - first + 1);
+}
+
+// Lê um ficheiro de linhas "chave = valor"
+static bool config_load(Config &config, const std::string &filename)
+{
+	std::ifstream file(filename);
+	std::string line;
+	int nline = 0;
+
+	if (!file.is_open())
+	{
+		std::cerr << "Erro ao abrir o ficheiro de configuracao " << filename << "!\n";
+		return false;
+	}
+
+	while (std::getline(file, line))
+	{
+		nline++;
+		line = config_trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+
+		size_t equal = line.find('=');
+		if (equal == std::string::npos)
+		{
+			std::cerr << filename << ":" << nline << ": falta '='\n";
+			return false;
+		}
+		if (!config_set(config, config_trim(line.substr(0, equal)), config_trim(line.substr(equal + 1))))
+			return false;
+	}
+
+	return true;
+}
+
+// Lê a linha de comandos (as opções são aplicadas pela ordem em que aparecem)
+static bool config_args(Config &config, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		std::string value = (i + 1 < argc) ? argv[i + 1] : "";
+		bool ok = true;
+
+		if ((arg == "-h") || (arg == "--help"))
+		{
+			config_usage(argv[0]);
+			return false;
+		}
+		else if (arg == "--headless")
+			config.headless = true;
+		else if (arg == "-q")
+			config.quiet = true;
+		else if (arg == "--check")
+			config.check = true;
+		else if ((arg == "--record") || (arg == "--golden") || (arg == "--raw") || (arg == "--fuzz") || (arg == "--seed") || (arg == "--decode"))
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "Falta o valor de " << arg << "\n";
+				return false;
+			}
+			i++;
+			ok = config_set(config, arg.substr(2), value);
+		}
+		else if ((arg.size() == 2) && (arg[0] == '-') && (std::string("ciortbpsgn").find(arg[1]) != std::string::npos))
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "Falta o valor de " << arg << "\n";
+				return false;
+			}
+			i++;
+
+			switch (arg[1])
+			{
+			case 'c':
+				ok = config_load(config, value);
+				break;
+			case 'i':
+				ok = config_set(config, "input", value);
+				break;
+			case 'o':
+				ok = config_set(config, "output", value);
+				break;
+			case 'r':
+				ok = config_set(config, "results", value);
+				break;
+			case 't':
+				ok = config_set(config, "threads", value);
+				break;
+			case 'b':
+				ok = config_set(config, "budget", value);
+				break;
+			case 's':
+				ok = config_set(config, "sweep", value);
+				break;
+			case 'g':
+				ok = config_set(config, "groundtruth", value);
+				break;
+			case 'n':
+				ok = config_set(config, "frames", value);
+				break;
+			case 'p':
+			{
+				size_t equal = value.find('=');
+				if (equal == std::string::npos)
+				{
+					std::cerr << "Parametro sem '=': " << value << "\n";
+					return false;
+				}
+				ok = config_set(config, value.substr(0, equal), value.substr(equal + 1));
+				break;
+			}
+			}
+		}
+		else if ((arg.size() > 1) && (arg[0] == '-'))
+		{
+			std::cerr << "Opcao desconhecida: " << arg << "\n";
+			config_usage(argv[0]);
+			return false;
+		}
+		else
+			ok = config_set(config, "input", arg);
+
+		if (!ok)
+			return false;
+	}
+
+	if (config.sources.empty())
+		config.sources.push_back("video_resistors.mp4");
+
+	return true;
+}
+
+// Abre uma fonte de vídeo (ficheiro ou índice de câmara)
+static bool open_capture(cv::VideoCapture &capture, const std::string &source)
+{
+	if (source.find_first_not_of("0123456789") == std::string::npos)
+		capture.open(std::stoi(source));
+	else
+		capture.open(source);
+
+	return capture.isOpened();
+}
+
+// Arquivo de frames descodificadas (vc_frames_*), reconhecido pela extensão
+static bool is_raw(const std::string &source)
+{
+	return (source.size() > 4) && (source.compare(source.size() - 4, 4, ".raw") == 0);
+}
+
+// Descodifica uma fonte (até maxframes frames, 0 = todas) para um arquivo raw. As execuções
+// seguintes lêem as frames do arquivo, mapeado em memória, sem o custo da descodificação.
+static bool decode_raw(const std::string &source, const std::string &rawname, int maxframes)
+{
+	cv::VideoCapture capture;
+	cv::Mat frame;
+	FRAMESVC *raw = NULL;
+	int n = 0;
+
+	if (!open_capture(capture, source))
+	{
+		std::cerr << "Erro ao abrir o ficheiro de vídeo " << source << "!\n";
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (((maxframes <= 0) || (n < maxframes)) && capture.read(frame) && !frame.empty())
+	{
+		IVC image = {frame.data, frame.cols, frame.rows, 3, 255, (int)frame.step};
+
+		if ((raw == NULL) && ((raw = vc_frames_create(rawname.c_str(), frame.cols, frame.rows, 3, (int)capture.get(cv::CAP_PROP_FPS))) == NULL))
+			break;
+		if (!vc_frames_append(raw, &image))
+		{
+			raw = vc_frames_close(raw);
+			break;
+		}
+		n++;
+	}
+	capture.release();
+
+	if (raw == NULL)
+	{
+		std::cerr << "Erro ao criar o ficheiro " << rawname << "!\n";
+		return false;
+	}
+	vc_frames_close(raw);
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Frames descodificadas: " << n << " -> " << rawname << " (" << ((elapsed.count() > 0.0) ? n / elapsed.count() : 0.0) << " fps)\n";
+
+	return true;
+}
+
+// Varrimento de parâmetros: corre o pipeline completo sobre as frames da primeira fonte com
+// cada combinação da grelha e mostra, por combinação, o débito, os percentis da latência e as
+// detecções (comparadas com as anotações, se existirem). As frames são descodificadas uma vez
+// para memória; as combinações correm em paralelo, uma por thread (com -t 1, os tempos não são
+// afectados pelas outras combinações). A tabela marca com '*' a fronteira de Pareto entre
+// débito e F1 (sem anotações, entre débito e número de detecções).
+static int run_sweep(Config &config)
+{
+	typedef std::vector<std::pair<std::string, std::string>> Params;
+	std::vector<Params> grid(1);
+	std::vector<std::string> keys;
+	std::ifstream file(config.sweep);
+	std::string line;
+
+	if (!file.is_open())
+	{
+		std::cerr << "Erro ao abrir o ficheiro de varrimento " << config.sweep << "!\n";
+		return 1;
+	}
+
+	/* Grelha: produto cartesiano das alternativas de cada linha */
+	while (std::getline(file, line))
+	{
+		line = config_trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+
+		size_t equal = line.find('=');
+		if (equal == std::string::npos)
+		{
+			std::cerr << config.sweep << ": falta '=' em " << line << "\n";
+			return 1;
+		}
+
+		std::string key = config_trim(line.substr(0, equal));
+		std::stringstream alternatives(line.substr(equal + 1));
+		std::string value;
+		std::vector<Params> next;
+
+		keys.push_back(key);
+		while (std::getline(alternatives, value, '|'))
+		{
+			for (size_t g = 0; g < grid.size(); g++)
+			{
+				next.push_back(grid[g]);
+				next.back().push_back(std::make_pair(key, config_trim(value)));
+			}
+		}
+		grid.swap(next);
+	}
+
+	/* Frames da primeira fonte, descodificadas uma vez (de um arquivo raw, sem cópia) */
+	cv::VideoCapture capture;
+	std::vector<cv::Mat> frames;
+	cv::Mat frame;
+	FRAMESVC *raw = NULL;
+
+	if (is_raw(config.sources[0]))
+	{
+		IVC view;
+
+		if (((raw = vc_frames_open(config.sources[0].c_str())) == NULL) || (raw->channels != 3))
+		{
+			std::cerr << "Erro ao abrir o arquivo " << config.sources[0] << "!\n";
+			vc_frames_close(raw);
+			return 1;
+		}
+		for (int f = 0; ((config.frames <= 0) || (f < config.frames)) && vc_frames_get(raw, f, &view); f++)
+			frames.push_back(cv::Mat(view.height, view.width, CV_8UC3, view.data));
+	}
+	else
+	{
+		if (!open_capture(capture, config.sources[0]))
+		{
+			std::cerr << "Erro ao abrir o ficheiro de vídeo " << config.sources[0] << "!\n";
+			return 1;
+		}
+		while (((config.frames <= 0) || ((int)frames.size() < config.frames)) && capture.read(frame) && !frame.empty())
+			frames.push_back(frame.clone());
+		capture.release();
+	}
+	if (frames.empty())
+	{
+		vc_frames_close(raw);
+		return 1;
+	}
+
+	/* Parâmetros fixos (-p e ficheiro de configuração): validados uma vez, antes do varrimento */
+	RESISTORPIPEVC *probe = vc_resistor_pipe_new(frames[0].cols, frames[0].rows);
+	bool paramsok = (probe != NULL);
+	for (size_t i = 0; (i < config.params.size()) && paramsok; i++)
+	{
+		if (!vc_resistor_pipe_set(probe, config.params[i].first.c_str(), config.params[i].second.c_str()))
+		{
+			std::cerr << "Parametro desconhecido ou invalido: " << config.params[i].first << " = " << config.params[i].second << "\n";
+			paramsok = false;
+		}
+	}
+	vc_resistor_pipe_free(probe);
+	if (!paramsok)
+	{
+		vc_frames_close(raw);
+		return 1;
+	}
+
+	/* Anotações */
+	ANNOTVC *annotations = NULL;
+	int nannotations = 0;
+	if (!config.groundtruth.empty())
+	{
+		annotations = vc_annotations_read(config.groundtruth.c_str(), &nannotations);
+		if (annotations == NULL)
+		{
+			std::cerr << "Erro ao ler as anotacoes " << config.groundtruth << "!\n";
+			vc_frames_close(raw);
+			return 1;
+		}
+	}
+
+	int nconfigs = (int)grid.size();
+	std::vector<SCOREVC> scores(nconfigs);
+	std::vector<int> valid(nconfigs, 1);
+	std::vector<double> fps(nconfigs), quality(nconfigs);
+	std::vector<int> front(nconfigs);
+
+	std::cout << "Varrimento: " << nconfigs << " combinacoes x " << frames.size() << " frames\n";
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int c = 0; c < nconfigs; c++)
+	{
+		RESISTORPIPEVC *pipe = vc_resistor_pipe_new(frames[0].cols, frames[0].rows);
+
+		vc_score_init(&scores[c]);
+		if (pipe == NULL)
+		{
+			valid[c] = 0;
+			continue;
+		}
+
+		for (size_t i = 0; i < config.params.size(); i++)
+			vc_resistor_pipe_set(pipe, config.params[i].first.c_str(), config.params[i].second.c_str());
+		for (size_t i = 0; (i < grid[c].size()) && valid[c]; i++)
+			valid[c] = vc_resistor_pipe_set(pipe, grid[c][i].first.c_str(), grid[c][i].second.c_str());
+
+		for (size_t f = 0; (f < frames.size()) && valid[c]; f++)
+		{
+			IVC image = {frames[f].data, frames[f].cols, frames[f].rows, 3, 255, (int)frames[f].step};
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			vc_resistor_pipe_run(pipe, &image, VC_ORDER_BGR, NULL);
+
+			std::chrono::duration<double> latency = std::chrono::steady_clock::now() - start;
+			vc_score_frame(&scores[c], pipe, (int)f + 1, annotations, nannotations, latency.count());
+		}
+
+		vc_resistor_pipe_free(pipe);
+	}
+
+	for (int c = 0; c < nconfigs; c++)
+	{
+		fps[c] = (valid[c] && (scores[c].total > 0.0)) ? scores[c].nframes / scores[c].total : 0.0;
+		quality[c] = !valid[c] ? 0.0 : (annotations != NULL) ? vc_score_f1(&scores[c]) : scores[c].detections;
+	}
+	vc_pareto_front(fps.data(), quality.data(), nconfigs, front.data());
+
+	/* Tabela (e CSV, com -r) */
+	std::ofstream results;
+	if (!config.results.empty())
+	{
+		results.open(config.results);
+		results << "combinacao,pareto,fps,p50_ms,p95_ms,p99_ms,deteccoes,tp,fp,fn,f1,valores_certos,valores_anotados";
+		for (size_t k = 0; k < keys.size(); k++)
+			results << "," << keys[k];
+		results << "\n";
+	}
+
+	std::cout << "  #  P      fps   p50 ms   p95 ms   p99 ms  detec    tp    fp    fn     F1  valor  parametros\n";
+	for (int c = 0; c < nconfigs; c++)
+	{
+		SCOREVC *score = &scores[c];
+		char row[256];
+
+		if (!valid[c])
+		{
+			snprintf(row, sizeof(row), "%3d  parametros invalidos\n", c);
+			std::cout << row;
+			continue;
+		}
+
+		snprintf(row, sizeof(row), "%3d  %c %8.1f %8.2f %8.2f %8.2f %6d %5d %5d %5d %6.3f %3d/%-3d", c, front[c] ? '*' : ' ', fps[c],
+				 vc_score_percentile(score, 50.0) * 1000.0, vc_score_percentile(score, 95.0) * 1000.0, vc_score_percentile(score, 99.0) * 1000.0,
+				 score->detections, score->tp, score->fp, score->fn, vc_score_f1(score), score->correct, score->valued);
+		std::cout << row;
+		for (size_t k = 0; k < grid[c].size(); k++)
+			std::cout << " " << grid[c][k].first << "=" << grid[c][k].second;
+		std::cout << "\n";
+
+		if (results.is_open())
+		{
+			results << c << "," << front[c] << "," << fps[c] << "," << vc_score_percentile(score, 50.0) * 1000.0 << ","
+					<< vc_score_percentile(score, 95.0) * 1000.0 << "," << vc_score_percentile(score, 99.0) * 1000.0 << ","
+					<< score->detections << "," << score->tp << "," << score->fp << "," << score->fn << "," << vc_score_f1(score) << ","
+					<< score->correct << "," << score->valued;
+			for (size_t k = 0; k < grid[c].size(); k++)
+				results << ",\"" << grid[c][k].second << "\"";
+			results << "\n";
+		}
+	}
+
+	for (int c = 0; c < nconfigs; c++)
+		vc_score_free(&scores[c]);
+	free(annotations);
+	vc_frames_close(raw);
+
+	return 0;
+}
+
+// Regressão: corre todos os operadores e o pipeline completo (vc_regress_frame) sobre as frames
+// da primeira fonte e grava (--record) ou compara (--check) os checksums de cada verificação.
+// As frames são descodificadas uma vez para um ficheiro raw, de modo a que a regressão não
+// dependa da versão do descodificador; as corridas seguintes lêem esse ficheiro. As frames são
+// processadas em paralelo e os checksums não podem depender do número de threads nem das
+// extensões SIMD com que vc.c foi compilado.
+// Os checksums de referência de video_resistors.mp4 (video_resistors_regress.txt) foram gravados
+// com vc.c compilado sem SSSE3/AVX2 e com uma thread; --check compara com eles por omissão.
+static int run_regress(Config &config)
+{
+	std::string rawname = !config.raw.empty() ? config.raw : is_raw(config.sources[0]) ? config.sources[0] : config.sources[0] + ".raw";
+	FRAMESVC *raw = vc_frames_open(rawname.c_str());
+
+	/* Ficheiro raw em falta: descodifica a fonte */
+	if (raw == NULL)
+	{
+		if (!decode_raw(config.sources[0], rawname, config.frames))
+			return 1;
+
+		if ((raw = vc_frames_open(rawname.c_str())) == NULL)
+		{
+			std::cerr << "Erro ao abrir o ficheiro " << rawname << "!\n";
+			return 1;
+		}
+	}
+
+	int nframes = ((config.frames > 0) && (config.frames < raw->nframes)) ? config.frames : raw->nframes;
+	int nchecks = vc_regress_count();
+	std::vector<unsigned int> checksums((size_t)nframes * nchecks, 0);
+	std::vector<int> done(nframes, 0);
+
+	std::cout << "Regressao: " << nchecks << " verificacoes x " << nframes << " frames (" << raw->width << "x" << raw->height << ")\n";
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int f = 0; f < nframes; f++)
+	{
+		IVC image;
+
+		if (vc_frames_get(raw, f, &image))
+			done[f] = vc_regress_frame(&image, VC_ORDER_BGR, &checksums[(size_t)f * nchecks]);
+	}
+	vc_frames_close(raw);
+
+	for (int f = 0; f < nframes; f++)
+	{
+		if (done[f] != nchecks)
+		{
+			std::cerr << "Erro na frame " << f << "!\n";
+			return 1;
+		}
+	}
+
+	/* Gravação: uma linha "frame verificação checksum" por frame e verificação */
+	if (!config.record.empty())
+	{
+		std::ofstream golden(config.record);
+		char line[128];
+
+		if (!golden.is_open())
+		{
+			std::cerr << "Erro ao criar o ficheiro " << config.record << "!\n";
+			return 1;
+		}
+
+		golden << "# frame verificacao checksum (" << rawname << ", " << nframes << " frames)\n";
+		for (int f = 0; f < nframes; f++)
+		{
+			for (int c = 0; c < nchecks; c++)
+			{
+				snprintf(line, sizeof(line), "%d %s %08x\n", f, vc_regress_name(c), checksums[(size_t)f * nchecks + c]);
+				golden << line;
+			}
+		}
+		std::cout << "Checksums de referencia gravados em " << config.record << "\n";
+
+		return 0;
+	}
+
+	/* Comparação: mostra a primeira frame diferente de cada verificação */
+	std::ifstream golden(config.golden);
+	std::vector<int> first(nchecks, -1), mismatches(nchecks, 0);
+	std::string line;
+	int compared = 0, failed = 0;
+
+	if (!golden.is_open())
+	{
+		std::cerr << "Erro ao abrir o ficheiro " << config.golden << "!\n";
+		return 1;
+	}
+
+	while (std::getline(golden, line))
+	{
+		std::stringstream fields(line.substr(0, line.find('#')));
+		std::string name;
+		unsigned int expected;
+		int f, c;
+
+		if (!(fields >> f >> name >> std::hex >> expected) || (f < 0) || (f >= nframes))
+			continue;
+		for (c = 0; (c < nchecks) && (name != vc_regress_name(c)); c++)
+			;
+		if (c == nchecks)
+			continue;
+
+		compared++;
+		if (checksums[(size_t)f * nchecks + c] != expected)
+		{
+			if (mismatches[c]++ == 0)
+			{
+				char text[160];
+				snprintf(text, sizeof(text), "DIFERENTE %-20s frame %d: %08x (referencia %08x)\n", name.c_str(), f,
+						 checksums[(size_t)f * nchecks + c], expected);
+				std::cout << text;
+			}
+			failed++;
+		}
+	}
+
+	for (int c = 0; c < nchecks; c++)
+		if (mismatches[c] > 1)
+			std::cout << "  " << vc_regress_name(c) << ": " << mismatches[c] << " frames diferentes\n";
+	std::cout << "Regressao: " << compared << " checksums comparados, " << failed << " diferentes\n";
+
+	return ((compared == 0) || (failed > 0)) ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	// Configuração: fontes de vídeo, saídas e parâmetros
+	Config config;
 	// Outros
 	std::string str;
+	std::ofstream results;
 	int key = 0;
 
-	/* Leitura de v�deo de um ficheiro */
-	/* NOTA IMPORTANTE:
-	O ficheiro video.avi dever� estar localizado no mesmo direct�rio que o ficheiro de c�digo fonte.
-	*/
-	capture.open(videofile);
+	if (!config_args(config, argc, argv))
+		return 1;
 
-	/* Em alternativa, abrir captura de v�deo pela Webcam #0 */
-	// capture.open(0, cv::CAP_DSHOW); // Pode-se utilizar apenas capture.open(0);
+#ifdef _OPENMP
+	if (config.threads > 0)
+		omp_set_num_threads(config.threads);
+#endif
 
-	/* Verifica se foi poss�vel abrir o ficheiro de v�deo */
-	if (!capture.isOpened())
+	if (!config.decode.empty())
+		return decode_raw(config.sources[0], config.decode, config.frames) ? 0 : 1;
+	if (!config.sweep.empty())
+		return run_sweep(config);
+	if (!config.record.empty() || config.check)
+		return run_regress(config);
+	if (config.fuzz > 0)
 	{
-		std::cerr << "Erro ao abrir o ficheiro de v�deo!\n";
-		return 1;
+		int mismatches = vc_fuzz(config.fuzz, config.seed, 1);
+		std::cout << "Testes diferenciais: " << config.fuzz << " casos (semente " << config.seed << "), " << mismatches << " diferencas\n";
+		return (mismatches > 0) ? 1 : 0;
+	}
+
+	if (!config.results.empty())
+	{
+		results.open(config.results);
+		if (!results.is_open())
+		{
+			std::cerr << "Erro ao criar o ficheiro " << config.results << "!\n";
+			return 1;
+		}
+		results << "fonte,frame,blob,x,y,largura,altura,area,angulo,bandas,valor,tolerancia\n";
 	}
 
-	/* N�mero total de frames no v�deo */
-	video.ntotalframes = (int)capture.get(cv::CAP_PROP_FRAME_COUNT);
-	/* Frame rate do v�deo */
-	video.fps = (int)capture.get(cv::CAP_PROP_FPS);
-	/* Resolu��o do v�deo */
-	video.width = (int)capture.get(cv::CAP_PROP_FRAME_WIDTH);
-	video.height = (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+	int nstreams = (int)config.sources.size();
+	std::vector<Stream> streams(nstreams);
+	std::vector<RESISTORPIPEVC *> pipes(nstreams);
+	std::vector<SCHEDVC *> scheds(nstreams);
+	std::vector<IVC *> frames(nstreams);
+
+	for (int s = 0; s < nstreams; s++)
+	{
+		Stream &st = streams[s];
+
+		/* Leitura de v�deo de um ficheiro */
+		/* NOTA IMPORTANTE:
+		O ficheiro video.avi dever� estar localizado no mesmo direct�rio que o ficheiro de c�digo fonte.
+		*/
+		/* Em alternativa, um número abre a captura de vídeo pela Webcam com esse índice e um
+		ficheiro .raw (criado com --decode) repete as frames já descodificadas */
+		st.source = config.sources[s];
+		if (is_raw(st.source))
+		{
+			st.raw = vc_frames_open(st.source.c_str());
+			if ((st.raw == NULL) || (st.raw->channels != 3))
+			{
+				std::cerr << "Erro ao abrir o arquivo " << st.source << "!\n";
+				return 1;
+			}
+			st.video.ntotalframes = st.raw->nframes;
+			st.video.fps = st.raw->fps;
+			st.video.width = st.raw->width;
+			st.video.height = st.raw->height;
+			st.video.nframe = 0;
+		}
+		else
+		{
+			open_capture(st.capture, st.source);
+
+			/* Verifica se foi poss�vel abrir o ficheiro de v�deo */
+			if (!st.capture.isOpened())
+			{
+				std::cerr << "Erro ao abrir o ficheiro de vídeo " << st.source << "!\n";
+				return 1;
+			}
 
-	/* Cria uma janela para exibir o v�deo */
-	cv::namedWindow("VC - VIDEO", cv::WINDOW_AUTOSIZE);
+			/* N�mero total de frames no v�deo */
+			st.video.ntotalframes = (int)st.capture.get(cv::CAP_PROP_FRAME_COUNT);
+			/* Frame rate do v�deo */
+			st.video.fps = (int)st.capture.get(cv::CAP_PROP_FPS);
+			/* Resolu��o do v�deo */
+			st.video.width = (int)st.capture.get(cv::CAP_PROP_FRAME_WIDTH);
+			st.video.height = (int)st.capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+		}
+
+		/* Pipeline de resistências e escalonador próprios */
+		st.pipe = vc_resistor_pipe_new(st.video.width, st.video.height);
+		if (st.pipe == NULL)
+		{
+			std::cerr << "Erro ao criar o pipeline!\n";
+			return 1;
+		}
+		for (size_t i = 0; i < config.params.size(); i++)
+		{
+			if (!vc_resistor_pipe_set(st.pipe, config.params[i].first.c_str(), config.params[i].second.c_str()))
+			{
+				std::cerr << "Parametro desconhecido ou invalido: " << config.params[i].first << " = " << config.params[i].second << "\n";
+				return 1;
+			}
+		}
+		vc_sched_init(&st.sched, config.budget);
+		st.active = true;
+		pipes[s] = st.pipe;
+		scheds[s] = (config.budget > 0.0) ? &st.sched : NULL;
+
+		/* Vídeo anotado (com várias fontes, o índice vai antes da extensão) */
+		if (!config.output.empty())
+		{
+			std::string filename = config.output;
+			if (nstreams > 1)
+			{
+				size_t dot = filename.find_last_of('.');
+				filename.insert((dot == std::string::npos) ? filename.size() : dot, std::string("_").append(std::to_string(s)));
+			}
+			st.writer.open(filename, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), (st.video.fps > 0) ? st.video.fps : 30, cv::Size(st.video.width, st.video.height));
+			if (!st.writer.isOpened())
+			{
+				std::cerr << "Erro ao criar o ficheiro de vídeo " << filename << "!\n";
+				return 1;
+			}
+		}
+
+		/* Cria uma janela para exibir o v�deo */
+		st.window = std::string("VC - VIDEO ").append(std::to_string(s));
+		if (!config.headless)
+			cv::namedWindow(st.window, cv::WINDOW_AUTOSIZE);
+	}
 
 	/* Inicia o timer */
-	vc_timer();
+	vc_timer(!config.headless);
 
-	cv::Mat frame;
-	while (key != 'q')
+	int status = 0;
+	for (int round = 0; key != 'q'; round++)
 	{
-		/* Leitura de uma frame do v�deo */
-		capture.read(frame);
+		int nactive = 0;
 
-		/* Verifica se conseguiu ler a frame */
-		if (frame.empty())
-			break;
+		/* Leitura de uma frame de cada vídeo, em paralelo (a descodificação de cada fonte é independente) */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : nactive)
+#endif
+		for (int s = 0; s < nstreams; s++)
+		{
+			Stream &st = streams[s];
 
-		/* N�mero da frame a processar */
-		video.nframe = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
-
-		/* Exemplo de inser��o texto na frame */
-		str = std::string("RESOLUCAO: ").append(std::to_string(video.width)).append("x").append(std::to_string(video.height));
-		cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-		cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-		str = std::string("TOTAL DE FRAMES: ").append(std::to_string(video.ntotalframes));
-		cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-		cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-		str = std::string("FRAME RATE: ").append(std::to_string(video.fps));
-		cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-		cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
-		str = std::string("N. DA FRAME: ").append(std::to_string(video.nframe));
-		cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
-		cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
+			frames[s] = NULL;
+			if (!st.active)
+				continue;
+
+			/* Do arquivo raw, a frame mapeada (só de leitura) é processada sem cópia nem descodificação */
+			if (st.raw != NULL)
+			{
+				IVC view;
+
+				if (vc_frames_get(st.raw, st.video.nframe, &view))
+					st.frame = cv::Mat(view.height, view.width, CV_8UC3, view.data);
+				else
+					st.frame = cv::Mat();
+			}
+			else
+				st.capture.read(st.frame);
+
+			/* Verifica se conseguiu ler a frame */
+			if (st.frame.empty())
+			{
+				st.active = false;
+				continue;
+			}
+
+			/* N�mero da frame a processar */
+			if (st.raw != NULL)
+				st.video.nframe++;
+			else
+				st.video.nframe = (int)st.capture.get(cv::CAP_PROP_POS_FRAMES);
+
+			/* A frame do OpenCV (BGR) é usada directamente, sem cópia */
+			st.image = {st.frame.data, st.frame.cols, st.frame.rows, 3, 255, (int)st.frame.step};
+			frames[s] = &st.image;
+			nactive++;
+		}
+
+		if (nactive == 0)
+			break;
 
 		// Fa�a o seu c�digo aqui...
-		/*
-		// Cria uma nova imagem IVC
-		IVC *image = vc_image_new(video.width, video.height, 3, 255);
-		// Copia dados de imagem da estrutura cv::Mat para uma estrutura IVC
-		memcpy(image->data, frame.data, video.width * video.height * 3);
-		// Executa uma fun��o da nossa biblioteca vc
-		vc_rgb_get_green(image);
-		// Copia dados de imagem da estrutura IVC para uma estrutura cv::Mat
-		memcpy(frame.data, image->data, video.width * video.height * 3);
-		// Liberta a mem�ria da imagem IVC que havia sido criada
-		vc_image_free(image);
-		*/
+		/* Uma frame de cada fonte, repartidas pelas threads (a primeira fonte roda a cada ronda) */
+		/* Se algum pipeline falhar, os resultados dessa fonte não são desta frame: termina */
+		if (vc_resistor_pipe_run_many(pipes.data(), frames.data(), VC_ORDER_BGR, scheds.data(), nstreams, round) < 0)
+		{
+			std::cerr << "Erro ao processar as frames da ronda " << round << "!\n";
+			status = 1;
+			break;
+		}
 		// +++++++++++++++++++++++++
 
-		/* Exibe a frame */
-		cv::imshow("VC - VIDEO", frame);
+		/* Resultados e texto (as janelas são actualizadas nesta thread) */
+		for (int s = 0; s < nstreams; s++)
+		{
+			Stream &st = streams[s];
+
+			if (frames[s] == NULL)
+				continue;
+
+			if (!config.quiet && (scheds[s] != NULL))
+			{
+				std::cout << "[" << st.source << "] ";
+				vc_sched_print(&st.sched);
+			}
+
+			for (int i = 0; (i < st.pipe->nfound) && results.is_open(); i++)
+			{
+				OVC *blob = &st.pipe->blobs[i];
+				RESISTORVC *resistor = &st.pipe->resistors[i];
+
+				results << st.source << "," << st.video.nframe << "," << i << "," << blob->x << "," << blob->y << ","
+						<< blob->width << "," << blob->height << "," << blob->area << "," << blob->angle << ",";
+				for (int b = 0; b < resistor->nbands; b++)
+					results << ((b > 0) ? " " : "") << vc_resistor_band_name(resistor->bands[b]);
+				results << "," << resistor->value << "," << resistor->tolerance << "\n";
+			}
+
+			/* Sem janela nem vídeo anotado, não há nada para desenhar */
+			if (config.headless && !st.writer.isOpened())
+				continue;
+
+			/* A frame do arquivo não pode ser alterada: desenha numa cópia, com o buffer reutilizado */
+			if (st.raw != NULL)
+				st.frame.copyTo(st.canvas);
+			cv::Mat &frame = (st.raw != NULL) ? st.canvas : st.frame;
+
+			for (int i = 0; i < st.pipe->nfound; i++)
+			{
+				OVC *blob = &st.pipe->blobs[i];
+				cv::rectangle(frame, cv::Rect(blob->x, blob->y, blob->width, blob->height), cv::Scalar(0, 255, 0), 2);
+				if (st.pipe->resistors[i].value > 0.0)
+				{
+					str = std::to_string((int)st.pipe->resistors[i].value).append(" OHM");
+					cv::putText(frame, str, cv::Point(blob->x, blob->y - 5), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 255, 0), 2);
+				}
+			}
+
+			/* Exemplo de inser��o texto na frame */
+			str = std::string("RESOLUCAO: ").append(std::to_string(st.video.width)).append("x").append(std::to_string(st.video.height));
+			cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+			cv::putText(frame, str, cv::Point(20, 25), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
+			str = std::string("TOTAL DE FRAMES: ").append(std::to_string(st.video.ntotalframes));
+			cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+			cv::putText(frame, str, cv::Point(20, 50), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
+			str = std::string("FRAME RATE: ").append(std::to_string(st.video.fps));
+			cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+			cv::putText(frame, str, cv::Point(20, 75), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
+			str = std::string("N. DA FRAME: ").append(std::to_string(st.video.nframe));
+			cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 0), 2);
+			cv::putText(frame, str, cv::Point(20, 100), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(255, 255, 255), 1);
+
+			if (st.writer.isOpened())
+				st.writer.write(frame);
+
+			/* Exibe a frame */
+			if (!config.headless)
+				cv::imshow(st.window, frame);
+		}
 
 		/* Sai da aplica��o, se o utilizador premir a tecla 'q' */
-		key = cv::waitKey(1);
+		if (!config.headless)
+			key = cv::waitKey(1);
 	}
 
 	/* Para o timer e exibe o tempo decorrido */
-	vc_timer();
+	vc_timer(!config.headless);
 
-	/* Fecha a janela */
-	cv::destroyWindow("VC - VIDEO");
+	for (int s = 0; s < nstreams; s++)
+	{
+		Stream &st = streams[s];
 
-	/* Fecha o ficheiro de v�deo */
-	capture.release();
+		/* Degradações aplicadas pelo escalonador */
+		if (scheds[s] != NULL)
+		{
+			std::cout << "[" << st.source << "] ";
+			vc_sched_summary(&st.sched);
+		}
+		vc_resistor_pipe_free(st.pipe);
 
-	return 0;
+		/* Fecha a janela e o vídeo anotado */
+		if (!config.headless)
+			cv::destroyWindow(st.window);
+		st.writer.release();
+
+		/* Fecha o ficheiro de v�deo */
+		st.capture.release();
+		st.frame = cv::Mat();
+		st.canvas = cv::Mat();
+		st.raw = vc_frames_close(st.raw);
+	}
+
+	return status;
 }
@@ -11,11 +11,37 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <malloc.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "vc.h"
 
+// Instruções SIMD usadas quando o compilador as tem activas (/arch:AVX2, -mavx2, -mssse3).
+// Sem elas é usada a versão escalar.
+#if defined(__AVX2__)
+#define VC_USE_AVX2
+#endif
+#if defined(__AVX2__) || defined(__SSSE3__)
+#define VC_USE_SSSE3
+#include <immintrin.h>
+#endif
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: ALOCAR E LIBERTAR UMA IMAGEM
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -372,6 +398,71 @@ int vc_write_image(char *filename, IVC *image)
 	return 0;
 }
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Ordem dos canais de cor
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Os operadores de cor recebem a ordem dos canais (VC_ORDER_RGB, VC_ORDER_BGR ou VC_ORDER_BGRA),
+// o que permite trabalhar directamente sobre as imagens BGR do OpenCV sem trocar os canais.
+
+// Posição de R, G e B em cada pixel e número de bytes por pixel (0 se a ordem não existir)
+static int vc_order_layout(int order, int *ri, int *gi, int *bi)
+{
+	*ri = 0;
+	*gi = 0;
+	*bi = 0;
+
+	switch (order)
+	{
+	case VC_ORDER_RGB:
+		*ri = 0;
+		*gi = 1;
+		*bi = 2;
+		return 3;
+	case VC_ORDER_BGR:
+		*ri = 2;
+		*gi = 1;
+		*bi = 0;
+		return 3;
+	case VC_ORDER_BGRA:
+		*ri = 2;
+		*gi = 1;
+		*bi = 0;
+		return 4;
+	}
+
+	return 0;
+}
+
+// Chama CALL(ri, gi, bi, nch) com constantes para cada ordem. Como as funções chamadas são
+// __inline, o ciclo interior é compilado uma vez por ordem, sem índices lidos em tempo de execução.
+#define VC_ORDER_SWITCH(order, CALL) \
+	switch (order)                   \
+	{                                \
+	case VC_ORDER_RGB:               \
+		CALL(0, 1, 2, 3);            \
+		break;                       \
+	case VC_ORDER_BGR:               \
+		CALL(2, 1, 0, 3);            \
+		break;                       \
+	case VC_ORDER_BGRA:              \
+		CALL(2, 1, 0, 4);            \
+		break;                       \
+	default:                         \
+		return 0;                    \
+	}
+
+// Verifica se uma imagem tem o número de canais da ordem indicada
+static int vc_order_check(IVC *image, int order)
+{
+	int ri, gi, bi;
+
+	if ((image == NULL) || (image->width <= 0) || (image->height <= 0) || (image->data == NULL))
+		return 0;
+
+	return image->channels == vc_order_layout(order, &ri, &gi, &bi);
+}
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: Funções para negativo da imagem
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -379,13 +470,7 @@ int vc_write_image(char *filename, IVC *image)
 // Função para gerar negativo da imagem Gray ----- 1 canal
 int vc_gray_negative(IVC *srcdst)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
+	unsigned char lut[256];
 
 	// Verificação de erros
 	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
@@ -393,29 +478,16 @@ int vc_gray_negative(IVC *srcdst)
 	if (srcdst->channels != 1)
 		return 0;
 
-	// Inverte a imagem Grey
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = 255 - data[pos];
-		}
-	}
+	// Inverte a imagem Grey (tabela 255 - i)
+	vc_lut_negative(lut);
 
-	return 1;
+	return vc_lut_apply(srcdst, srcdst, lut);
 }
 
 // Função para gerar negativo da imagem RGB ---- 3 canais
 int vc_rgb_negative(IVC *srcdst)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
+	unsigned char lut[256];
 
 	// Verificação de erros
 	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
@@ -423,15 +495,32 @@ int vc_rgb_negative(IVC *srcdst)
 	if (srcdst->channels != 3)
 		return 0;
 
-	// Inverte a imagem RGB
-	for (y = 0; y < height; y++)
+	// Inverte a imagem RGB (a mesma tabela nas componentes R, G e B)
+	vc_lut_negative(lut);
+
+	return vc_lut_apply(srcdst, srcdst, lut);
+}
+
+// Negativo de uma imagem a cores em qualquer ordem (em BGRA o canal alfa não é alterado)
+int vc_rgb_negative_order(IVC *srcdst, int order)
+{
+	unsigned char *p;
+	int x, y;
+
+	if (!vc_order_check(srcdst, order))
+		return 0;
+	if (srcdst->channels == 3)
+		return vc_rgb_negative(srcdst);
+
+	for (y = 0; y < srcdst->height; y++)
 	{
-		for (x = 0; x < width; x++)
+		p = &srcdst->data[y * srcdst->bytesperline];
+
+		for (x = 0; x < srcdst->width * 4; x += 4)
 		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = 255 - data[pos];		 // Componente R
-			data[pos + 1] = 255 - data[pos + 1]; // Componente G
-			data[pos + 2] = 255 - data[pos + 2]; // Componente B
+			p[x] = 255 - p[x];
+			p[x + 1] = 255 - p[x + 1];
+			p[x + 2] = 255 - p[x + 2];
 		}
 	}
 
@@ -442,255 +531,253 @@ int vc_rgb_negative(IVC *srcdst)
 //            FUN��ES: Obter componentes de uma imagem RGB e converter em tons de cinza
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-// Função para obter o componente vermelho e convertê-lo em tons de cinza
-int vc_rgb_get_red_gray(IVC *srcdst)
+// Copia uma componente (na posição ci de cada pixel) para as três componentes de cor
+static __inline void vc_component_gray_image(IVC *srcdst, int ci, int nch)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
+	unsigned char *p;
 	int x, y;
-	long int pos;
-
-	// Verificação de erros
-	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
-		return 0;
-	if (srcdst->channels != 3)
-		return 0;
 
-	// Converte o componente vermelho em tons de cinza
-	for (y = 0; y < height; y++)
+	for (y = 0; y < srcdst->height; y++)
 	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos + 1] = data[pos]; // Componente G
-			data[pos + 2] = data[pos]; // Componente B
-		}
-	}
+		p = &srcdst->data[y * srcdst->bytesperline];
 
-	return 1;
+		for (x = 0; x < srcdst->width * nch; x += nch)
+			p[x] = p[x + 1] = p[x + 2] = p[x + ci];
+	}
 }
 
-// Função para obter o componente verde e convertê-lo em tons de cinza
-int vc_rgb_get_green_gray(IVC *srcdst)
+// Função para obter uma componente (0 = R, 1 = G, 2 = B) de uma imagem a cores em qualquer ordem
+// e convertê-la em tons de cinza
+int vc_rgb_get_gray_component(IVC *srcdst, int order, int component)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
+	int index[3];
 
 	// Verificação de erros
-	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
+	if (!vc_order_check(srcdst, order))
 		return 0;
-	if (srcdst->channels != 3)
+	if ((component < 0) || (component > 2))
 		return 0;
 
-	// Converte o componente verde em tons de cinza
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = data[pos];	   // Componente R
-			data[pos + 2] = data[pos]; // Componente B
-		}
-	}
+	vc_order_layout(order, &index[0], &index[1], &index[2]);
+
+	if (srcdst->channels == 4)
+		vc_component_gray_image(srcdst, index[component], 4);
+	else
+		vc_component_gray_image(srcdst, index[component], 3);
 
 	return 1;
 }
 
-// Função para obter o componente azul e convertê-lo em tons de cinza
-int vc_rgb_get_blue_gray(IVC *srcdst)
+// Função para obter o componente vermelho e convertê-lo em tons de cinza
+int vc_rgb_get_red_gray(IVC *srcdst)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
-
-	// Verificação de erros
-	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
-		return 0;
-	if (srcdst->channels != 3)
-		return 0;
+	return vc_rgb_get_gray_component(srcdst, VC_ORDER_RGB, 0);
+}
 
-	// Converte o componente azul em tons de cinza
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = data[pos];	   // Componente R
-			data[pos + 1] = data[pos]; // Componente G
-		}
-	}
+// Função para obter o componente verde e convertê-lo em tons de cinza
+int vc_rgb_get_green_gray(IVC *srcdst)
+{
+	return vc_rgb_get_gray_component(srcdst, VC_ORDER_RGB, 1);
+}
 
-	return 1;
+// Função para obter o componente azul e convertê-lo em tons de cinza
+int vc_rgb_get_blue_gray(IVC *srcdst)
+{
+	return vc_rgb_get_gray_component(srcdst, VC_ORDER_RGB, 2);
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: Conversão de imagem RGB para imagem HSV
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-// Função para converter uma imagem RGB para uma imagem HSV --- 3 canais para 3 canais
-int vc_rgb_to_hsv(IVC *srcdst)
+// Converte um pixel RGB para HSV, com H, S e V em [0,255]
+static __inline void vc_rgb_pixel_to_hsv(float r, float g, float b, unsigned char *hsv)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->bytesperline;
-	int channels = srcdst->channels;
-	float r, g, b, hue, saturation, value;
+	float hue, saturation, value;
 	float rgb_max, rgb_min;
-	int i, size;
-
-	// Verificação de erros
-	if ((width <= 0) || (height <= 0) || (data == NULL))
-		return 0;
-	if (channels != 3)
-		return 0;
 
-	size = width * height * channels;
+	// Calcula valores máximo e mínimo dos canais de cor R, G e B
+	rgb_max = (r > g ? (r > b ? r : b) : (g > b ? g : b));
+	rgb_min = (r < g ? (r < b ? r : b) : (g < b ? g : b));
 
-	for (i = 0; i < size; i = i + channels)
+	// Value toma valores entre [0,255]
+	value = rgb_max;
+	if (value == 0.0f)
 	{
-		r = (float)data[i];
-		g = (float)data[i + 1];
-		b = (float)data[i + 2];
-
-		// Calcula valores máximo e mínimo dos canais de cor R, G e B
-		rgb_max = (r > g ? (r > b ? r : b) : (g > b ? g : b));
-		rgb_min = (r < g ? (r < b ? r : b) : (g < b ? g : b));
+		hue = 0.0f;
+		saturation = 0.0f;
+	}
+	else
+	{
+		// Saturation toma valores entre [0,255]
+		saturation = ((rgb_max - rgb_min) / rgb_max) * 255.0f;
 
-		// Value toma valores entre [0,255]
-		value = rgb_max;
-		if (value == 0.0f)
+		if (saturation == 0.0f)
 		{
 			hue = 0.0f;
-			saturation = 0.0f;
 		}
 		else
 		{
-			// Saturation toma valores entre [0,255]
-			saturation = ((rgb_max - rgb_min) / rgb_max) * 255.0f;
-
-			if (saturation == 0.0f)
+			// Hue toma valores entre [0,360]
+			if ((rgb_max == r) && (g >= b))
 			{
-				hue = 0.0f;
+				hue = 60.0f * (g - b) / (rgb_max - rgb_min);
+			}
+			else if ((rgb_max == r) && (b > g))
+			{
+				hue = 360.0f + 60.0f * (g - b) / (rgb_max - rgb_min);
+			}
+			else if (rgb_max == g)
+			{
+				hue = 120.0f + 60.0f * (b - r) / (rgb_max - rgb_min);
 			}
 			else
 			{
-				// Hue toma valores entre [0,360]
-				if ((rgb_max == r) && (g >= b))
-				{
-					hue = 60.0f * (g - b) / (rgb_max - rgb_min);
-				}
-				else if ((rgb_max == r) && (b > g))
-				{
-					hue = 360.0f + 60.0f * (g - b) / (rgb_max - rgb_min);
-				}
-				else if (rgb_max == g)
-				{
-					hue = 120.0f + 60.0f * (b - r) / (rgb_max - rgb_min);
-				}
-				else
-				{
-					hue = 240.0f + 60.0f * (r - g) / (rgb_max - rgb_min);
-				}
+				hue = 240.0f + 60.0f * (r - g) / (rgb_max - rgb_min);
 			}
 		}
+	}
+
+	// Atribui valores entre [0,255]
+	hsv[0] = (unsigned char)(hue / 360.0f * 255.0f);
+	hsv[1] = (unsigned char)(saturation);
+	hsv[2] = (unsigned char)(value);
+}
 
-		// Atribui valores entre [0,255]
-		data[i] = (unsigned char)(hue / 360.0f * 255.0f);
-		data[i + 1] = (unsigned char)(saturation);
-		data[i + 2] = (unsigned char)(value);
+// Converte para HSV uma imagem com R, G e B nas posições ri, gi e bi de cada pixel de nch bytes.
+// H, S e V ficam nos 3 primeiros bytes do pixel (em BGRA o alfa não é alterado).
+static __inline void vc_rgb_to_hsv_image(IVC *srcdst, int ri, int gi, int bi, int nch)
+{
+	unsigned char *p;
+	int x, y;
+
+	for (y = 0; y < srcdst->height; y++)
+	{
+		p = &srcdst->data[y * srcdst->bytesperline];
+
+		for (x = 0; x < srcdst->width * nch; x += nch)
+			vc_rgb_pixel_to_hsv((float)p[x + ri], (float)p[x + gi], (float)p[x + bi], &p[x]);
 	}
+}
+
+// Função para converter uma imagem a cores (RGB, BGR ou BGRA) para uma imagem HSV
+int vc_rgb_to_hsv_order(IVC *srcdst, int order)
+{
+	// Verificação de erros
+	if (!vc_order_check(srcdst, order))
+		return 0;
+
+#define VC_CALL(ri, gi, bi, nch) vc_rgb_to_hsv_image(srcdst, ri, gi, bi, nch)
+	VC_ORDER_SWITCH(order, VC_CALL)
+#undef VC_CALL
 
 	return 1;
 }
 
-// Função para converter uma imagem HSV para uma imagem RGB --- 3 canais para 3 canais
-int vc_hsv_to_rgb(IVC *srcdst)
+// Função para converter uma imagem RGB para uma imagem HSV --- 3 canais para 3 canais
+int vc_rgb_to_hsv(IVC *srcdst)
+{
+	return vc_rgb_to_hsv_order(srcdst, VC_ORDER_RGB);
+}
+
+// Converte um pixel HSV (componentes em [0,255]) para R, G e B
+static __inline void vc_hsv_pixel_to_rgb(const unsigned char *hsv, unsigned char *red, unsigned char *green, unsigned char *blue)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->bytesperline;
-	int channels = srcdst->channels;
 	float hue, saturation, value, c, x, m;
-	int i, size;
+	float r, g, b;
 
-	// Verificação de erros
-	if ((width <= 0) || (height <= 0) || (data == NULL))
-		return 0;
-	if (channels != 3)
-		return 0;
+	hue = (float)hsv[0] / 255.0f * 360.0f;
+	saturation = (float)hsv[1] / 255.0f;
+	value = (float)hsv[2] / 255.0f;
 
-	size = width * height * channels;
+	c = value * saturation;
+	x = c * (1 - fabs(fmod(hue / 60.0f, 2) - 1));
+	m = value - c;
 
-	for (i = 0; i < size; i = i + channels)
+	if (hue >= 0 && hue < 60)
+	{
+		r = c;
+		g = x;
+		b = 0;
+	}
+	else if (hue >= 60 && hue < 120)
+	{
+		r = x;
+		g = c;
+		b = 0;
+	}
+	else if (hue >= 120 && hue < 180)
 	{
-		hue = (float)data[i] / 255.0f * 360.0f;
-		saturation = (float)data[i + 1] / 255.0f;
-		value = (float)data[i + 2] / 255.0f;
+		r = 0;
+		g = c;
+		b = x;
+	}
+	else if (hue >= 180 && hue < 240)
+	{
+		r = 0;
+		g = x;
+		b = c;
+	}
+	else if (hue >= 240 && hue < 300)
+	{
+		r = x;
+		g = 0;
+		b = c;
+	}
+	else
+	{
+		r = c;
+		g = 0;
+		b = x;
+	}
 
-		c = value * saturation;
-		x = c * (1 - fabs(fmod(hue / 60.0f, 2) - 1));
-		m = value - c;
+	*red = (unsigned char)((r + m) * 255.0f);
+	*green = (unsigned char)((g + m) * 255.0f);
+	*blue = (unsigned char)((b + m) * 255.0f);
+}
 
-		float r, g, b;
-		if (hue >= 0 && hue < 60)
-		{
-			r = c;
-			g = x;
-			b = 0;
-		}
-		else if (hue >= 60 && hue < 120)
-		{
-			r = x;
-			g = c;
-			b = 0;
-		}
-		else if (hue >= 120 && hue < 180)
-		{
-			r = 0;
-			g = c;
-			b = x;
-		}
-		else if (hue >= 180 && hue < 240)
-		{
-			r = 0;
-			g = x;
-			b = c;
-		}
-		else if (hue >= 240 && hue < 300)
-		{
-			r = x;
-			g = 0;
-			b = c;
-		}
-		else
+// Converte uma imagem HSV (H, S e V nos 3 primeiros bytes de cada pixel de nch bytes) para cor,
+// escrevendo R, G e B nas posições ri, gi e bi
+static __inline void vc_hsv_to_rgb_image(IVC *srcdst, int ri, int gi, int bi, int nch)
+{
+	unsigned char *p;
+	unsigned char r, g, b;
+	int x, y;
+
+	for (y = 0; y < srcdst->height; y++)
+	{
+		p = &srcdst->data[y * srcdst->bytesperline];
+
+		for (x = 0; x < srcdst->width * nch; x += nch)
 		{
-			r = c;
-			g = 0;
-			b = x;
+			vc_hsv_pixel_to_rgb(&p[x], &r, &g, &b);
+			p[x + ri] = r;
+			p[x + gi] = g;
+			p[x + bi] = b;
 		}
-
-		data[i] = (unsigned char)((r + m) * 255.0f);
-		data[i + 1] = (unsigned char)((g + m) * 255.0f);
-		data[i + 2] = (unsigned char)((b + m) * 255.0f);
 	}
+}
+
+// Função para converter uma imagem HSV para uma imagem a cores (RGB, BGR ou BGRA)
+int vc_hsv_to_rgb_order(IVC *srcdst, int order)
+{
+	// Verificação de erros
+	if (!vc_order_check(srcdst, order))
+		return 0;
+
+#define VC_CALL(ri, gi, bi, nch) vc_hsv_to_rgb_image(srcdst, ri, gi, bi, nch)
+	VC_ORDER_SWITCH(order, VC_CALL)
+#undef VC_CALL
 
 	return 1;
 }
 
+// Função para converter uma imagem HSV para uma imagem RGB --- 3 canais para 3 canais
+int vc_hsv_to_rgb(IVC *srcdst)
+{
+	return vc_hsv_to_rgb_order(srcdst, VC_ORDER_RGB);
+}
+
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: Segmentação de imagem HSV
@@ -700,6 +787,20 @@ int vc_hsv_to_rgb(IVC *srcdst)
 // 		// 255  -  360
 // 		//  h    -  x
 //         // x = 360*h / 255
+// Verifica se um pixel HSV (componentes em [0,255]) está dentro dos intervalos
+// H em [0,360], S e V em [0,100]
+static __inline int vc_hsv_pixel_in_range(const unsigned char *hsv, int hmin, int hmax, int smin,
+										  int smax, int vmin, int vmax)
+{
+	float h, s, v;
+
+	h = (float)hsv[0] * 360.0f / 255.0f;
+	s = (float)hsv[1] * 100.0f / 255.0f;
+	v = (float)hsv[2] * 100.0f / 255.0f;
+
+	return (h >= hmin && h <= hmax && s >= smin && s <= smax && v >= vmin && v <= vmax);
+}
+
 int vc_hsv_segmentation(IVC *src, int hmin, int hmax, int smin,
 						int smax, int vmin, int vmax)
 {
@@ -709,7 +810,6 @@ int vc_hsv_segmentation(IVC *src, int hmin, int hmax, int smin,
 	int height = src->height;
 	int bytesperline = src->width * src->channels;
 	int channels = src->channels;
-	float h, s, v;
 	int i, size;
 
 	if ((src->width) <= 0 || (src->height <= 0) || (src->data == NULL))
@@ -721,12 +821,7 @@ int vc_hsv_segmentation(IVC *src, int hmin, int hmax, int smin,
 
 	for (i = 0; i < size; i = i + channels)
 	{
-
-		h = (float)data[i] * 360.0f / 255.0f;
-		s = (float)data[i + 1] * 100.0f / 255.0f;
-		v = (float)data[i + 2] * 100.0f / 255.0f;
-
-		if (h >= hmin && h <= hmax && s >= smin && s <= smax && v >= vmin && v <= vmax)
+		if (vc_hsv_pixel_in_range(&data[i], hmin, hmax, smin, smax, vmin, vmax))
 		{
 			data[i] = 255;
 			data[i + 1] = 255;
@@ -742,20 +837,140 @@ int vc_hsv_segmentation(IVC *src, int hmin, int hmax, int smin,
 	return 1;
 }
 
-int vc_3channels_to_1channel(IVC *src, IVC *dst)
+// Segmentação HSV directamente sobre uma imagem a cores (RGB, BGR ou BGRA): cada pixel é
+// convertido para HSV e testado, sem imagem HSV intermédia. dst é a máscara (1 canal).
+static __inline void vc_color_hsv_segmentation_image(IVC *src, IVC *dst, const int *range, int ri, int gi, int bi, int nch)
 {
-	unsigned char *data_src = (unsigned char *)src->data;
-	unsigned char *data_dst = (unsigned char *)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->width * src->channels;
-	int channels = src->channels;
+	unsigned char hsv[3];
+	unsigned char *ps, *pd;
 	int x, y;
-	long int pos;
 
-	if ((src->width) <= 0 || (src->height <= 0) || (src->data == NULL))
-		return 0;
-	if (src->channels != 3)
+	for (y = 0; y < src->height; y++)
+	{
+		ps = &src->data[y * src->bytesperline];
+		pd = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < src->width; x++, ps += nch)
+		{
+			vc_rgb_pixel_to_hsv((float)ps[ri], (float)ps[gi], (float)ps[bi], hsv);
+			pd[x] = vc_hsv_pixel_in_range(hsv, range[0], range[1], range[2], range[3], range[4], range[5]) ? 255 : 0;
+		}
+	}
+}
+
+int vc_color_hsv_segmentation(IVC *src, IVC *dst, int order, int hmin, int hmax, int smin,
+							  int smax, int vmin, int vmax)
+{
+	int range[6];
+
+	// Verificação de erros
+	if (!vc_order_check(src, order))
+		return 0;
+	if ((dst == NULL) || (dst->data == NULL) || (dst->channels != 1))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height))
+		return 0;
+
+	range[0] = hmin;
+	range[1] = hmax;
+	range[2] = smin;
+	range[3] = smax;
+	range[4] = vmin;
+	range[5] = vmax;
+
+#define VC_CALL(ri, gi, bi, nch) vc_color_hsv_segmentation_image(src, dst, range, ri, gi, bi, nch)
+	VC_ORDER_SWITCH(order, VC_CALL)
+#undef VC_CALL
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Conversão de 3 canais para cinzentos
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Luminância Y = 0.299 R + 0.587 G + 0.114 B em vírgula fixa: pesos em 1/32768 (soma 32768),
+// resultado truncado como na fórmula em double. A diferença para o double é no máximo 1 nível.
+#define VC_GRAY_WR 9798
+#define VC_GRAY_WG 19235
+#define VC_GRAY_WB 3735
+
+// Converte uma linha de n pixéis com nch bytes por pixel (3 ou 4) em cinzentos:
+// (p0 * w0 + p1 * w1 + p2 * w2) >> 15, com os pesos já pela ordem dos bytes.
+// As versões SIMD separam os canais com PSHUFB (4 pixéis por cada 128 bits), multiplicam e somam
+// os pares de canais com PMADDWD e juntam 16 (SSSE3) ou 32 (AVX2) resultados numa escrita.
+// Com 3 bytes por pixel cada leitura de 16 bytes passa 4 bytes do último pixel lido, por isso
+// o ciclo pára 2 pixéis antes do fim.
+static __inline void vc_gray_row(const unsigned char *src, unsigned char *dst, int n, int nch, int w0, int w1, int w2)
+{
+	int x = 0;
+
+#if defined(VC_USE_SSSE3)
+	const int guard = (nch == 3) ? 2 : 0;
+	const __m128i s01 = (nch == 3) ? _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1)
+								   : _mm_setr_epi8(0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1, 12, -1, 13, -1);
+	const __m128i s2 = (nch == 3) ? _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1)
+								  : _mm_setr_epi8(2, -1, -1, -1, 6, -1, -1, -1, 10, -1, -1, -1, 14, -1, -1, -1);
+	__m128i v[4];
+	int i;
+#if defined(VC_USE_AVX2)
+	const __m256i s01x2 = _mm256_broadcastsi128_si256(s01);
+	const __m256i s2x2 = _mm256_broadcastsi128_si256(s2);
+	const __m256i k01x2 = _mm256_set1_epi32((w1 << 16) | w0);
+	const __m256i k2x2 = _mm256_set1_epi32(w2);
+	const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i p, q[4];
+
+	for (; x + 32 + guard <= n; x += 32)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			const unsigned char *ps = &src[(x + 8 * i) * nch];
+
+			p = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)ps)),
+										_mm_loadu_si128((const __m128i *)(ps + 4 * nch)), 1);
+			q[i] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_shuffle_epi8(p, s01x2), k01x2),
+													  _mm256_madd_epi16(_mm256_shuffle_epi8(p, s2x2), k2x2)), 15);
+		}
+
+		// O empacotamento é feito por metades de 128 bits; a permutação repõe a ordem dos pixéis
+		p = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+		_mm256_storeu_si256((__m256i *)&dst[x], _mm256_permutevar8x32_epi32(p, perm));
+	}
+#endif
+	const __m128i k01 = _mm_set1_epi32((w1 << 16) | w0);
+	const __m128i k2 = _mm_set1_epi32(w2);
+
+	for (; x + 16 + guard <= n; x += 16)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			__m128i p4 = _mm_loadu_si128((const __m128i *)&src[(x + 4 * i) * nch]);
+
+			v[i] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(p4, s01), k01),
+												_mm_madd_epi16(_mm_shuffle_epi8(p4, s2), k2)), 15);
+		}
+
+		_mm_storeu_si128((__m128i *)&dst[x], _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+	}
+#endif
+
+	for (; x < n; x++)
+		dst[x] = (unsigned char)((src[x * nch] * w0 + src[x * nch + 1] * w1 + src[x * nch + 2] * w2) >> 15);
+}
+
+// Converte uma imagem a cores (ordem RGB, BGR ou BGRA) numa imagem em tons de cinzento
+int vc_rgb_to_gray(IVC *src, IVC *dst, int order)
+{
+	int ri, gi, bi, nch;
+	int w[3];
+	int y;
+
+	nch = vc_order_layout(order, &ri, &gi, &bi);
+
+	if ((src->width) <= 0 || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if ((nch == 0) || (src->channels != nch))
 		return 0;
 	if ((dst->width) <= 0 || (dst->height <= 0) || (dst->data == NULL))
 		return 0;
@@ -764,79 +979,144 @@ int vc_3channels_to_1channel(IVC *src, IVC *dst)
 	if (src->width != dst->width || src->height != dst->height)
 		return 0;
 
-	for (y = 0; y < height; y++)
+	// Pesos pela ordem dos bytes de cada pixel
+	w[ri] = VC_GRAY_WR;
+	w[gi] = VC_GRAY_WG;
+	w[bi] = VC_GRAY_WB;
+
+	for (y = 0; y < src->height; y++)
 	{
-		for (x = 0; x < width; x++)
+		if (nch == 4)
+			vc_gray_row(&src->data[y * src->bytesperline], &dst->data[y * dst->bytesperline], src->width, 4, w[0], w[1], w[2]);
+		else
+			vc_gray_row(&src->data[y * src->bytesperline], &dst->data[y * dst->bytesperline], src->width, 3, w[0], w[1], w[2]);
+	}
+
+	return 1;
+}
+
+int vc_3channels_to_1channel(IVC *src, IVC *dst)
+{
+	return vc_rgb_to_gray(src, dst, VC_ORDER_RGB);
+}
+
+// Compara vc_rgb_to_gray com a fórmula em double (0.299 R + 0.587 G + 0.114 B, truncada)
+// em todas as 2^24 cores, nas ordens RGB e BGR. Devolve 1 se o erro máximo for <= 1 nível.
+int vc_rgb_to_gray_accuracy(void)
+{
+	IVC *src = vc_image_new(256, 256, 3, 255);
+	IVC *dst = vc_image_new(256, 256, 1, 255);
+	long long mismatches[2] = {0, 0};
+	int maxerror = 0;
+	int order, r, g, b, ref, err;
+	unsigned char *p;
+
+	if ((src == NULL) || (dst == NULL))
+	{
+		vc_image_free(src);
+		vc_image_free(dst);
+		return 0;
+	}
+
+	for (order = VC_ORDER_RGB; order <= VC_ORDER_BGR; order++)
+	{
+		for (r = 0; r < 256; r++)
 		{
-			pos = y * bytesperline + x * channels;
-			data_dst[y * width + x] = (unsigned char)(0.299 * data_src[pos] + 0.587 * data_src[pos + 1] + 0.114 * data_src[pos + 2]);
+			// Uma imagem 256 x 256 por valor de R: G ao longo das linhas, B ao longo das colunas
+			for (g = 0; g < 256; g++)
+			{
+				for (b = 0; b < 256; b++)
+				{
+					p = &src->data[g * src->bytesperline + b * 3];
+					p[0] = (unsigned char)((order == VC_ORDER_BGR) ? b : r);
+					p[1] = (unsigned char)g;
+					p[2] = (unsigned char)((order == VC_ORDER_BGR) ? r : b);
+				}
+			}
+
+			vc_rgb_to_gray(src, dst, order);
+
+			for (g = 0; g < 256; g++)
+			{
+				for (b = 0; b < 256; b++)
+				{
+					ref = (unsigned char)(0.299 * r + 0.587 * g + 0.114 * b);
+					err = dst->data[g * dst->bytesperline + b] - ref;
+					if (err < 0)
+						err = -err;
+
+					if (err != 0)
+						mismatches[order]++;
+					if (err > maxerror)
+						maxerror = err;
+				}
+			}
 		}
 	}
 
-	return 1;
+	printf("Cinzentos (vírgula fixa vs double): RGB %lld, BGR %lld cores diferentes em %d; erro máximo %d\n",
+		   mismatches[VC_ORDER_RGB], mismatches[VC_ORDER_BGR], 1 << 24, maxerror);
+
+	vc_image_free(src);
+	vc_image_free(dst);
+
+	return maxerror <= 1;
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: Conversão de imagem Gray para imagem RGB
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-// Função para converter uma imagem Gray para uma imagem RGB
-int vc_scale_gray_to_rgb(IVC *src, IVC *dst)
+// Escreve a paleta de falsa cor em R, G e B nas posições ri, gi e bi (em BGRA o alfa fica a 255)
+static __inline void vc_scale_gray_to_rgb_image(IVC *src, IVC *dst, const unsigned char *lut3, int ri, int gi, int bi, int nch)
 {
-	int i, size;
-	unsigned char *data_src, *data_dst;
-	unsigned char red, green, blue;
+	unsigned char *ps, *pd;
+	int x, y;
+
+	for (y = 0; y < src->height; y++)
+	{
+		ps = &src->data[y * src->bytesperline];
+		pd = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < src->width; x++, pd += nch)
+		{
+			pd[ri] = lut3[ps[x]];
+			pd[gi] = lut3[256 + ps[x]];
+			pd[bi] = lut3[512 + ps[x]];
+			if (nch == 4)
+				pd[3] = 255;
+		}
+	}
+}
+
+// Função para converter uma imagem Gray para uma imagem a cores (falsa cor) em qualquer ordem
+int vc_scale_gray_to_rgb_order(IVC *src, IVC *dst, int order)
+{
+	unsigned char lut3[3 * 256];
 
-	if (src == NULL || dst == NULL)
+	if (src == NULL || dst == NULL || src->data == NULL)
 		return 0;
-	if (src->channels != 1 || dst->channels != 3)
+	if (src->channels != 1 || !vc_order_check(dst, order))
 		return 0;
 	if (src->width != dst->width || src->height != dst->height)
 		return 0;
 
-	size = src->width * src->height;
-	data_src = (unsigned char *)src->data;
-	data_dst = (unsigned char *)dst->data;
-
-	for (i = 0; i < size; i++)
-	{
-		int d = i * 3;
-		unsigned char intensity = data_src[i];
-
-		// Regras de mapeamento conforme os slides
-		if (intensity < 64)
-		{ // Intensidade baixa -> Azul
-			blue = 255;
-			green = 4 * intensity;
-			red = 0;
-		}
-		else if (intensity < 128)
-		{ // Intensidade média-baixa -> Verde
-			blue = 255 - 4 * (intensity - 64);
-			green = 255;
-			red = 0;
-		}
-		else if (intensity < 192)
-		{ // Intensidade média-alta -> Verde
-			blue = 0;
-			green = 255;
-			red = 4 * (intensity - 128);
-		}
-		else
-		{ // Intensidade alta -> Vermelho
-			blue = 0;
-			green = 255 - 4 * (intensity - 192);
-			red = 255;
-		}
+	// Regras de mapeamento conforme os slides (tabela de falsa cor)
+	vc_lut_false_color(lut3);
 
-		data_dst[d] = red;
-		data_dst[d + 1] = green;
-		data_dst[d + 2] = blue;
-	}
+#define VC_CALL(ri, gi, bi, nch) vc_scale_gray_to_rgb_image(src, dst, lut3, ri, gi, bi, nch)
+	VC_ORDER_SWITCH(order, VC_CALL)
+#undef VC_CALL
 
 	return 1; // Sucesso
 }
 
+// Função para converter uma imagem Gray para uma imagem RGB
+int vc_scale_gray_to_rgb(IVC *src, IVC *dst)
+{
+	return vc_scale_gray_to_rgb_order(src, dst, VC_ORDER_RGB);
+}
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //            FUN��ES: Calcular pixeis dentro de uma imagem segmentada HSV
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -882,13 +1162,7 @@ int vc_pixels_inside_segmented(IVC *srcdst, int *numPixels)
 // Função para converter uma imagem Gray para Binary
 int vc_gray_to_binary(IVC *srcdst, int threshold)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
+	unsigned char lut3[3 * 256];
 
 	// Verificação de erros
 	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
@@ -896,37 +1170,18 @@ int vc_gray_to_binary(IVC *srcdst, int threshold)
 	if (srcdst->channels != 3)
 		return 0;
 
-	// Converte a imagem Gray para Binary
-	for (y = 0; y < height; y++)
-	{ // Percorre a altura da imagem
-		for (x = 0; x < width; x++)
-		{										   // Percorre a largura da imagem
-			pos = y * bytesperline + x * channels; // Posição do pixel -> Decorar equação
-			if (data[pos] > threshold)
-			{					 // Se o pixel for maior que o threshold
-				data[pos] = 255; // Pixel branco
-			}
-			else
-			{				   // Se o pixel for menor que o threshold
-				data[pos] = 0; // Pixel preto
-			}
-		}
-	}
+	// Converte a imagem Gray para Binary: só o primeiro canal de cada pixel é binarizado
+	vc_lut_threshold(lut3, threshold);
+	vc_lut_identity(lut3 + 256);
+	vc_lut_identity(lut3 + 512);
 
-	return 1;
+	return vc_lut3_apply(srcdst, srcdst, lut3);
 }
 
 // Função para converter uma imagem Gray para Binary com imagens de entrada e saída diferentes
 int vc_gray_to_binary_src_dst(IVC *src, IVC *dst, int threshold)
 {
-	unsigned char *data_src = (unsigned char *)src->data;
-	unsigned char *data_dst = (unsigned char *)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->width * src->channels;
-	int channels = src->channels;
-	int x, y;
-	long int pos;
+	unsigned char lut[256];
 
 	// Verificação de erros
 	if ((src->width) <= 0 || (src->height <= 0) || (src->data == NULL))
@@ -941,39 +1196,17 @@ int vc_gray_to_binary_src_dst(IVC *src, IVC *dst, int threshold)
 		return 0;
 
 	// Converte a imagem Gray para Binary
-	for (y = 0; y < height; y++)
-	{ // Percorre a altura da imagem
-		for (x = 0; x < width; x++)
-		{										   // Percorre a largura da imagem
-			pos = y * bytesperline + x * channels; // Posição do pixel -> Decorar equação
-			if (data_src[pos] > threshold)
-			{						 // Se o pixel for maior que o threshold
-				data_dst[pos] = 255; // Pixel branco
-			}
-			else
-			{					   // Se o pixel for menor que o threshold
-				data_dst[pos] = 0; // Pixel preto
-			}
-		}
-	}
+	vc_lut_threshold(lut, threshold);
 
-	return 1;
+	return vc_lut_apply(src, dst, lut);
 }
 
 // Binarização automática é percorrer a imagem toda.
 // E fazer o somatório da intensidade dos pixéis é dividir pelo numero total de pixéis existentes. (Média Global)
 int vc_gray_to_binary_global_mean(IVC *srcdst)
 {
-	unsigned char *data = (unsigned char *)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
-	int sum = 0;
-	int numPixels = width * height; // Número total de pixéis
 	int threshold;
+	int hist[256];
 
 	// Verificação de erros
 	if ((srcdst->width) <= 0 || (srcdst->height <= 0) || (srcdst->data == NULL))
@@ -981,38 +1214,14 @@ int vc_gray_to_binary_global_mean(IVC *srcdst)
 	if (srcdst->channels != 1)
 		return 0;
 
-	// Calcula a média global
-	for (y = 0; y < height; y++)
-	{ // Percorre a altura da imagem
-		for (x = 0; x < width; x++)
-		{										   // Percorre a largura da imagem
-			pos = y * bytesperline + x * channels; // Posição do pixel -> Decorar equação
-			sum += data[pos];					   // Soma a intensidade do pixel, é igual a sum = sum + data[pos]
-		}
-	}
-
-	threshold = sum / numPixels; // Calcula a média global
+	// Calcula a média global a partir do histograma
+	vc_gray_histogram(srcdst, hist);
+	threshold = vc_histogram_mean(hist);
 
 	printf("Threshold = %d\n", threshold); // Mostra o threshold calculado
 
 	// Converte a imagem Gray para Binary
-	for (y = 0; y < height; y++)
-	{ // Percorre a altura da imagem
-		for (x = 0; x < width; x++)
-		{										   // Percorre a largura da imagem
-			pos = y * bytesperline + x * channels; // Posição do pixel -> Decorar equação
-			if (data[pos] > threshold)
-			{					 // Se o pixel for maior que o threshold
-				data[pos] = 255; // Pixel branco
-			}
-			else
-			{				   // Se o pixel for menor que o threshold
-				data[pos] = 0; // Pixel preto
-			}
-		}
-	}
-
-	return 1;
+	return vc_gray_to_binary_src_dst(srcdst, srcdst, threshold);
 }
 
 // Binarização automática com metodo adaptativo (midpoint)
@@ -1161,8 +1370,8 @@ int vc_gray_to_binary_niblack(IVC *src, IVC *dst, int kernel, float k)
 	int offset = (kernel - 1) / 2;
 	int max, min;
 	long int pos, kpos;
-	float mean, stdDev;
-	unsigned char threshold;
+	float stdDev;
+	float threshold;
 
 	// Verificação de erros
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
@@ -1172,6 +1381,10 @@ int vc_gray_to_binary_niblack(IVC *src, IVC *dst, int kernel, float k)
 	if ((dst->channels != 1))
 		return 0;
 
+	// Versão especializada para kernels 3, 5, 7 e 9 (vc_kernels.cpp)
+	if (vc_kernel_niblack(src, dst, kernel, k))
+		return 1;
+
 	for (y = 0; y < height; y++)
 	{
 		for (x = 0; x < width; x++)
@@ -1182,6 +1395,7 @@ int vc_gray_to_binary_niblack(IVC *src, IVC *dst, int kernel, float k)
 			min = datasrc[pos];
 
 			float mean = 0.0f;
+			stdDev = 0.0f;
 
 			// Counter = (kernel * kernel)
 
@@ -1221,14 +1435,17 @@ int vc_gray_to_binary_niblack(IVC *src, IVC *dst, int kernel, float k)
 
 			stdDev = sqrt(stdDev / (kernel * kernel));
 
+			// O threshold fica em float (a conversão para unsigned char é indefinida fora de [0,255])
 			threshold = mean + k * stdDev;
 
 			if (datasrc[pos] <= threshold)
-				datadst[pos] = 0;
+				datadst[y * dst->bytesperline + x * channels] = 0;
 			else
-				datadst[pos] = 255;
+				datadst[y * dst->bytesperline + x * channels] = 255;
 		}
 	}
+
+	return 1;
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -1260,10 +1477,6 @@ int vc_binary_dilate2(IVC *src, IVC *dst, int kernelSize)
 
 	offset = (kernelSize - 1) / 2;
 
-	// Copia a imagem original para a imagem destino
-	// Imagem de destino é igual a imagem original
-	memcpy(datadst, datasrc, bytesperline * height);
-
 	// Calcula da erosão
 	for (y = 0; y < height; y++)
 	{
@@ -1277,15 +1490,15 @@ int vc_binary_dilate2(IVC *src, IVC *dst, int kernelSize)
 			{
 				j = y + ky;
 
-				if ((j < 0) && (j >= height))
-					continue; // Operador lógico AND
+				if ((j < 0) || (j >= height))
+					continue; // Operador lógico OU
 
 				for (kx = -offset; kx <= offset; kx++)
 				{
 					i = x + kx;
 
-					if ((i < 0) && (i >= width))
-						continue; // Operador lógico AND
+					if ((i < 0) || (i >= width))
+						continue; // Operador lógico OU
 
 					kpos = j * bytesperline + i * channels;
 
@@ -1295,11 +1508,13 @@ int vc_binary_dilate2(IVC *src, IVC *dst, int kernelSize)
 
 			// Se um qualquer pixel da vizinhança for zero então..
 			if (pixel == 0)
-				datadst[pos] = 0; // Pixel preto
+				datadst[y * dst->bytesperline + x * channels] = 0; // Pixel preto
 			else
-				datadst[pos] = 255; // Pixel branco
+				datadst[y * dst->bytesperline + x * channels] = 255; // Pixel branco
 		}
 	}
+
+	return 1;
 }
 
 int vc_binary_dilate(IVC *src, IVC *dst, int kernel)
@@ -1320,11 +1535,15 @@ int vc_binary_dilate(IVC *src, IVC *dst, int kernel)
 	if (src->channels != 1)
 		return 0;
 
+	// Versão especializada para kernels 3, 5, 7 e 9 (vc_kernels.cpp)
+	if (vc_kernel_binary_dilate(src, dst, kernel))
+		return 1;
+
 	for (y = 0; y < height; ++y)
 	{
 		for (x = 0; x < width; ++x)
 		{
-			pos = y * bytesperline + x * channels;
+			pos = y * dst->bytesperline + x * channels;
 			int foundWhite = 0;
 
 			// NxM vizinhança
@@ -1373,11 +1592,11 @@ int vc_binary_erode(IVC *src, IVC *dst, int kernelSize)
 	if ((dst->channels != 1))
 		return 0;
 
-	offset = (kernelSize - 1) / 2;
+	// Versão especializada para kernels 3, 5, 7 e 9 (vc_kernels.cpp)
+	if (vc_kernel_binary_erode(src, dst, kernelSize))
+		return 1;
 
-	// Copia a imagem original para a imagem destino
-	// Imagem de destino é igual a imagem original
-	memcpy(datadst, datasrc, bytesperline * height);
+	offset = (kernelSize - 1) / 2;
 
 	// Calcula da erosão
 	for (y = 0; y < height; y++)
@@ -1410,11 +1629,13 @@ int vc_binary_erode(IVC *src, IVC *dst, int kernelSize)
 
 			// Se um qualquer pixel da vizinhança for zero então..
 			if (pixel == 0)
-				datadst[pos] = 0; // Pixel preto
+				datadst[y * dst->bytesperline + x * channels] = 0; // Pixel preto
 			else
-				datadst[pos] = 255; // Pixel branco
+				datadst[y * dst->bytesperline + x * channels] = 255; // Pixel branco
 		}
 	}
+
+	return 1;
 }
 
 // Função para aplicar uma abertura morfológica em imagens binárias (1º Erosão, 2º Dilatação)
@@ -1516,7 +1737,7 @@ int vc_gray_erode(IVC *src, IVC *dst, int kernel)
 	unsigned char *datadst = (unsigned char *)dst->data;
 	int width = src->width;
 	int height = src->height;
-	int bytesperline = src->width * src->channels;
+	int bytesperline = src->bytesperline;
 	int channels = src->channels;
 	int x, y, kx, ky, min, max;
 	long int pos, posk;
@@ -1532,11 +1753,15 @@ int vc_gray_erode(IVC *src, IVC *dst, int kernel)
 	if (src->channels != 1 || dst->channels != 1)
 		return 0; // Verifica se as imagens têm os canais corretos
 
+	// Versão especializada para kernels 3, 5, 7 e 9 (vc_kernels.cpp)
+	if (vc_kernel_gray_erode(src, dst, kernel))
+		return 1;
+
 	for (y = 0; y < height; y++)
 	{
 		for (x = 0; x < width; x++)
 		{
-			pos = y * bytesperline + x * channels;
+			pos = y * dst->bytesperline + x * channels;
 
 			max = 0;
 			min = 255;
@@ -1568,7 +1793,7 @@ int vc_gray_dilate(IVC *src, IVC *dst, int kernel)
 	unsigned char *datadst = (unsigned char *)dst->data;
 	int width = src->width;
 	int height = src->height;
-	int bytesperline = src->width * src->channels;
+	int bytesperline = src->bytesperline;
 	int channels = src->channels;
 	int x, y, kx, ky, min, max;
 	long int pos, posk;
@@ -1584,11 +1809,15 @@ int vc_gray_dilate(IVC *src, IVC *dst, int kernel)
 	if (src->channels != 1 || dst->channels != 1)
 		return 0; // Verifica se as imagens têm os canais corretos
 
+	// Versão especializada para kernels 3, 5, 7 e 9 (vc_kernels.cpp)
+	if (vc_kernel_gray_dilate(src, dst, kernel))
+		return 1;
+
 	for (y = 0; y < height; y++)
 	{
 		for (x = 0; x < width; x++)
 		{
-			pos = y * bytesperline + x * channels;
+			pos = y * dst->bytesperline + x * channels;
 
 			int flag = 0;
 			max = 0;
@@ -1655,57 +1884,341 @@ int vc_gray_close(IVC *src, IVC *dst, int kernelE, int kernelD)
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-//            FUN��ES: Subtrair 2 Imagens binarias
+//            FUNÇÕES: Transformada de distância e morfologia com disco
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-int vc_binary_subtract(IVC *src1, IVC *src2, IVC *dst)
-{
-	unsigned char *data_src1 = (unsigned char *)src1->data;
-	unsigned char *data_src2 = (unsigned char *)src2->data;
-	unsigned char *data_dst = (unsigned char *)dst->data;
-	int width = src1->width;
-	int height = src1->height;
-	int bytesperline = src1->width * src1->channels;
-	int channels = src1->channels;
-	int x, y;
-	long int pos;
+// A transformada de distância dá, para cada pixel, a distância ao pixel de fundo (0) mais
+// próximo. Com ela, a erosão/dilatação por um disco de raio r fica um limiar sobre a distância,
+// com custo linear no número de pixéis, qualquer que seja o raio.
 
-	// Verificação de erros
-	if ((src1->width <= 0) || (src1->height <= 0) || (src1->data == NULL))
-		return 0;
-	if ((src2->width <= 0) || (src2->height <= 0) || (src2->data == NULL))
-		return 0;
-	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL))
-		return 0;
-	if (src1->width != src2->width || src1->height != src2->height || src1->channels != src2->channels)
-		return 0;
-	if (src1->width != dst->width || src1->height != dst->height || src1->channels != dst->channels)
-		return 0;
+// Distância euclidiana ao quadrado exacta (Felzenszwalb-Huttenlocher), numa linha de n
+// valores: d[i] = min_j (f[j] + (i - j)^2). Os valores VC_DIST_INF não são considerados.
+// v e z são arrays auxiliares com n e n + 1 posições.
+static void vc_distance_1d(const int *f, int *d, int n, int *v, double *z)
+{
+	int q, k = -1;
+	double s;
 
-	// Subtrai as duas imagens binárias
-	for (y = 0; y < height; y++)
+	for (q = 0; q < n; q++)
 	{
-		for (x = 0; x < width; x++)
+		if (f[q] >= VC_DIST_INF)
+			continue;
+
+		// Remove as parábolas que ficam por cima da nova
+		while (k >= 0)
 		{
-			pos = y * bytesperline + x * channels;
-			if (data_src1[pos] > 0 && data_src2[pos] == 0)
-			{
-				data_dst[pos] = 255;
-			}
-			else
-			{
-				data_dst[pos] = 0;
-			}
+			s = (((double)f[q] + (double)q * q) - ((double)f[v[k]] + (double)v[k] * v[k])) / (2.0 * (q - v[k]));
+			if (s > z[k])
+				break;
+			k--;
 		}
+
+		k++;
+		v[k] = q;
+		z[k] = (k == 0) ? -1e30 : s;
+		z[k + 1] = 1e30;
 	}
 
-	return 1;
+	if (k < 0)
+	{
+		for (q = 0; q < n; q++)
+			d[q] = VC_DIST_INF;
+		return;
+	}
+
+	for (q = 0, k = 0; q < n; q++)
+	{
+		while (z[k + 1] < q)
+			k++;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
 }
 
-int vc_exclude_regions(IVC *original, IVC *mask, IVC *final_image)
+// Transformada euclidiana exacta. target = 0: distância ao fundo mais próximo; target = 1:
+// distância ao primeiro plano mais próximo. Os pixéis fora da imagem não contam.
+static int vc_distance_euclidean(IVC *src, int *dist, int target)
 {
-	if (original == NULL || mask == NULL || final_image == NULL)
-		return 0;
+	int width = src->width;
+	int height = src->height;
+	int x, y, ok = 1;
+
+	// Passo 1: distância vertical (em cada coluna), com uma passagem para baixo e outra para cima
+	for (y = 0; y < height; y++)
+	{
+		const unsigned char *p = &src->data[y * src->bytesperline];
+		int *d = &dist[y * width];
+
+		for (x = 0; x < width; x++)
+		{
+			if ((p[x] != 0) == target)
+				d[x] = 0;
+			else
+				d[x] = ((y > 0) && (d[x - width] < VC_DIST_INF)) ? d[x - width] + 1 : VC_DIST_INF;
+		}
+	}
+	for (y = height - 2; y >= 0; y--)
+	{
+		int *d = &dist[y * width];
+
+		for (x = 0; x < width; x++)
+			if (d[x + width] + 1 < d[x])
+				d[x] = d[x + width] + 1;
+	}
+	for (x = 0; x < width * height; x++)
+		if (dist[x] < VC_DIST_INF)
+			dist[x] = dist[x] * dist[x];
+
+	// Passo 2: envelope inferior de parábolas em cada linha
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		int *f = (int *)malloc(width * sizeof(int));
+		int *v = (int *)malloc(width * sizeof(int));
+		double *z = (double *)malloc((width + 1) * sizeof(double));
+		int yy;
+
+		if ((f == NULL) || (v == NULL) || (z == NULL))
+		{
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+			ok = 0;
+		}
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+		for (yy = 0; yy < height; yy++)
+		{
+			if ((f == NULL) || (v == NULL) || (z == NULL))
+				continue;
+
+			memcpy(f, &dist[yy * width], width * sizeof(int));
+			vc_distance_1d(f, &dist[yy * width], width, v, z);
+		}
+
+		free(f);
+		free(v);
+		free(z);
+	}
+
+	return ok;
+}
+
+// Transformada chanfrada 3-4 (passo horizontal/vertical = 3, diagonal = 4), em duas passagens.
+// A distância vem em terços de pixel.
+static int vc_distance_chamfer(IVC *src, int *dist, int target)
+{
+	int width = src->width;
+	int height = src->height;
+	int x, y, d;
+	int *p;
+
+	for (y = 0; y < height; y++)
+	{
+		p = &dist[y * width];
+
+		for (x = 0; x < width; x++)
+		{
+			if ((src->data[y * src->bytesperline + x] != 0) == target)
+			{
+				p[x] = 0;
+				continue;
+			}
+
+			d = VC_DIST_INF;
+			if (x > 0)
+				d = MY_MIN(d, p[x - 1] + 3);
+			if (y > 0)
+			{
+				d = MY_MIN(d, p[x - width] + 3);
+				if (x > 0)
+					d = MY_MIN(d, p[x - width - 1] + 4);
+				if (x < width - 1)
+					d = MY_MIN(d, p[x - width + 1] + 4);
+			}
+			p[x] = MY_MIN(d, VC_DIST_INF);
+		}
+	}
+
+	for (y = height - 1; y >= 0; y--)
+	{
+		p = &dist[y * width];
+
+		for (x = width - 1; x >= 0; x--)
+		{
+			d = p[x];
+			if (x < width - 1)
+				d = MY_MIN(d, p[x + 1] + 3);
+			if (y < height - 1)
+			{
+				d = MY_MIN(d, p[x + width] + 3);
+				if (x < width - 1)
+					d = MY_MIN(d, p[x + width + 1] + 4);
+				if (x > 0)
+					d = MY_MIN(d, p[x + width - 1] + 4);
+			}
+			p[x] = MY_MIN(d, VC_DIST_INF);
+		}
+	}
+
+	return 1;
+}
+
+// Transformada de distância de uma imagem binária (1 canal)
+// dist		: width * height valores: distância de cada pixel ao pixel de fundo (0) mais próximo,
+//			  0 nos pixéis de fundo e VC_DIST_INF se a imagem não tiver fundo
+// metric	: VC_DIST_EUCLIDEAN (distância ao quadrado, exacta) ou VC_DIST_CHAMFER34 (em terços de pixel)
+int vc_binary_distance_transform(IVC *src, int *dist, int metric)
+{
+	// Verificação de erros
+	if ((src == NULL) || (dist == NULL) || (src->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0) || (src->channels != 1))
+		return 0;
+
+	if (metric == VC_DIST_EUCLIDEAN)
+		return vc_distance_euclidean(src, dist, 0);
+	if (metric == VC_DIST_CHAMFER34)
+		return vc_distance_chamfer(src, dist, 0);
+
+	return 0;
+}
+
+// Erosão ou dilatação por um disco de raio 'radius' (pixéis a distância euclidiana <= radius).
+// Erosão: fica a 255 quem não tem fundo no disco (distância ao fundo > radius).
+// Dilatação: fica a 255 quem tem primeiro plano no disco (distância ao primeiro plano <= radius).
+// Como em vc_binary_erode / vc_binary_dilate, os pixéis fora da imagem são ignorados.
+static int vc_binary_disc(IVC *src, IVC *dst, int radius, int dilate)
+{
+	int *dist;
+	int x, y, r2;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0) || (src->channels != 1))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels))
+		return 0;
+	if (radius < 0)
+		return 0;
+
+	dist = (int *)malloc(src->width * src->height * sizeof(int));
+	if (dist == NULL)
+		return 0;
+
+	if (!vc_distance_euclidean(src, dist, dilate))
+	{
+		free(dist);
+		return 0;
+	}
+
+	r2 = radius * radius;
+
+	for (y = 0; y < src->height; y++)
+	{
+		const int *d = &dist[y * src->width];
+		unsigned char *p = &dst->data[y * dst->bytesperline];
+
+		if (dilate)
+		{
+			for (x = 0; x < src->width; x++)
+				p[x] = (d[x] <= r2) ? 255 : 0;
+		}
+		else
+		{
+			for (x = 0; x < src->width; x++)
+				p[x] = (d[x] > r2) ? 255 : 0;
+		}
+	}
+
+	free(dist);
+
+	return 1;
+}
+
+int vc_binary_erode_disc(IVC *src, IVC *dst, int radius)
+{
+	return vc_binary_disc(src, dst, radius, 0);
+}
+
+int vc_binary_dilate_disc(IVC *src, IVC *dst, int radius)
+{
+	return vc_binary_disc(src, dst, radius, 1);
+}
+
+// Abertura com disco (1º Erosão, 2º Dilatação). Pode ser src == dst.
+int vc_binary_open_disc(IVC *src, IVC *dst, int radius)
+{
+	if (!vc_binary_disc(src, dst, radius, 0))
+		return 0;
+
+	return vc_binary_disc(dst, dst, radius, 1);
+}
+
+// Fecho com disco (1º Dilatação, 2º Erosão). Pode ser src == dst.
+int vc_binary_close_disc(IVC *src, IVC *dst, int radius)
+{
+	if (!vc_binary_disc(src, dst, radius, 1))
+		return 0;
+
+	return vc_binary_disc(dst, dst, radius, 0);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUN��ES: Subtrair 2 Imagens binarias
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+int vc_binary_subtract(IVC *src1, IVC *src2, IVC *dst)
+{
+	unsigned char *data_src1 = (unsigned char *)src1->data;
+	unsigned char *data_src2 = (unsigned char *)src2->data;
+	unsigned char *data_dst = (unsigned char *)dst->data;
+	int width = src1->width;
+	int height = src1->height;
+	int bytesperline = src1->width * src1->channels;
+	int channels = src1->channels;
+	int x, y;
+	long int pos;
+
+	// Verificação de erros
+	if ((src1->width <= 0) || (src1->height <= 0) || (src1->data == NULL))
+		return 0;
+	if ((src2->width <= 0) || (src2->height <= 0) || (src2->data == NULL))
+		return 0;
+	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL))
+		return 0;
+	if (src1->width != src2->width || src1->height != src2->height || src1->channels != src2->channels)
+		return 0;
+	if (src1->width != dst->width || src1->height != dst->height || src1->channels != dst->channels)
+		return 0;
+
+	// Subtrai as duas imagens binárias
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			pos = y * bytesperline + x * channels;
+			if (data_src1[pos] > 0 && data_src2[pos] == 0)
+			{
+				data_dst[pos] = 255;
+			}
+			else
+			{
+				data_dst[pos] = 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+int vc_exclude_regions(IVC *original, IVC *mask, IVC *final_image)
+{
+	if (original == NULL || mask == NULL || final_image == NULL)
+		return 0;
 	if (original->width != mask->width || original->height != mask->height || original->channels != mask->channels)
 		return 0;
 
@@ -1744,13 +2257,14 @@ int vc_exclude_regions(IVC *original, IVC *mask, IVC *final_image)
 // dst		: Imagem grayscale (ir� conter as etiquetas)
 // nlabels	: Endere�o de mem�ria de uma vari�vel, onde ser� armazenado o n�mero de etiquetas encontradas.
 // OVC*		: Retorna um array de estruturas de blobs (objectos), com respectivas etiquetas. � necess�rio libertar posteriormente esta mem�ria.
+//			  Devolve NULL se as etiquetas provisórias não couberem em [1, 254].
 OVC *vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels) // identifica os blobs apenas
 {
 	unsigned char *datasrc = (unsigned char *)src->data;
 	unsigned char *datadst = (unsigned char *)dst->data;
 	int width = src->width;
 	int height = src->height;
-	int bytesperline = src->bytesperline;
+	int bytesperline = dst->bytesperline;
 	int channels = src->channels;
 	int x, y, a, b;
 	long int i, size;
@@ -1770,7 +2284,8 @@ OVC *vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels) // identifica os
 		return NULL;
 
 	// Copia dados da imagem bin�ria para imagem grayscale
-	memcpy(datadst, datasrc, bytesperline * height);
+	for (y = 0; y < height; y++)
+		memcpy(&datadst[y * bytesperline], &datasrc[y * src->bytesperline], width * channels);
 
 	// Todos os pix�is de plano de fundo devem obrigat�riamente ter valor 0
 	// Todos os pix�is de primeiro plano devem obrigat�riamente ter valor 255
@@ -1814,6 +2329,13 @@ OVC *vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels) // identifica os
 			{
 				if ((datadst[posA] == 0) && (datadst[posB] == 0) && (datadst[posC] == 0) && (datadst[posD] == 0))
 				{
+					// Sem etiquetas livres em [1, 254]: como na versão por faixas, devolve NULL
+					if (label > 254)
+					{
+						*nlabels = 0;
+						return NULL;
+					}
+
 					datadst[posX] = label;
 					labeltable[label] = label;
 					label++;
@@ -1951,6 +2473,49 @@ OVC *vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels) // identifica os
 	return blobs;
 }
 
+// Segue o contorno de um blob (definida na secção de contornos)
+static float vc_contour_trace(IVC *src, int label, int xstart, int ystart, CONTOURVC *contour);
+
+// Centro de massa, momentos centrais de 2ª ordem, orientação, eixos e excentricidade de um blob, a partir das
+// somas inteiras de x, y, x^2, y^2 e xy dos seus n pixéis (só aqui se passa a vírgula flutuante)
+static void vc_blob_set_moments(OVC *blob, long long n, long long sx, long long sy, long long sxx, long long syy, long long sxy)
+{
+	double mx, my, mu20, mu02, mu11, d, l1, l2;
+
+	blob->cx = blob->cy = 0.0f;
+	blob->mu20 = blob->mu02 = blob->mu11 = 0.0f;
+	blob->angle = blob->major = blob->minor = blob->eccentricity = 0.0f;
+	if (n <= 0)
+		return;
+
+	mx = (double)sx / n;
+	my = (double)sy / n;
+	blob->cx = (float)mx;
+	blob->cy = (float)my;
+	mu20 = (double)sxx / n - mx * mx;
+	mu02 = (double)syy / n - my * my;
+	mu11 = (double)sxy / n - mx * my;
+
+	// Valores próprios da matriz de covariância: l1 >= l2
+	d = sqrt((mu20 - mu02) * (mu20 - mu02) + 4.0 * mu11 * mu11);
+	l1 = MY_MAX((mu20 + mu02 + d) / 2.0, 0.0);
+	l2 = MY_MAX((mu20 + mu02 - d) / 2.0, 0.0);
+
+	blob->mu20 = (float)mu20;
+	blob->mu02 = (float)mu02;
+	blob->mu11 = (float)mu11;
+
+	// Orientação do eixo maior, em graus [0, 180[ (y a crescer para baixo)
+	blob->angle = (float)(0.5 * atan2(2.0 * mu11, mu20 - mu02) * 180.0 / 3.14159265358979);
+	if (blob->angle < 0.0f)
+		blob->angle += 180.0f;
+
+	// Eixos da elipse com os mesmos momentos
+	blob->major = (float)(4.0 * sqrt(l1));
+	blob->minor = (float)(4.0 * sqrt(l2));
+	blob->eccentricity = (l1 > 0.0) ? (float)sqrt(1.0 - l2 / l1) : 0.0f;
+}
+
 int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima indentificados sao um corpo
 {
 	unsigned char *data = (unsigned char *)src->data;
@@ -1961,7 +2526,9 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 	int x, y, i;
 	long int pos;
 	int xmin, ymin, xmax, ymax;
+	int xfirst;
 	long int sumx, sumy;
+	long long sumxx, sumyy, sumxy;
 
 	// Verifica��o de erros
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
@@ -1979,6 +2546,8 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 
 		sumx = 0;
 		sumy = 0;
+		sumxx = sumyy = sumxy = 0;
+		xfirst = 0;
 
 		blobs[i].area = 0;
 
@@ -1990,6 +2559,10 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 
 				if (data[pos] == blobs[i].label)
 				{
+					// Primeiro pixel do blob (em ordem raster): início do contorno
+					if (blobs[i].area == 0)
+						xfirst = x;
+
 					// �rea
 					blobs[i].area++;
 
@@ -1997,6 +2570,11 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 					sumx += x;
 					sumy += y;
 
+					// Momentos de 2ª ordem
+					sumxx += (long long)x * x;
+					sumyy += (long long)y * y;
+					sumxy += (long long)x * y;
+
 					// Bounding Box
 					if (xmin > x)
 						xmin = x;
@@ -2006,13 +2584,6 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 						xmax = x;
 					if (ymax < y)
 						ymax = y;
-
-					// Per�metro
-					// Se pelo menos um dos quatro vizinhos n�o pertence ao mesmo label, ent�o � um pixel de contorno
-					if ((data[pos - 1] != blobs[i].label) || (data[pos + 1] != blobs[i].label) || (data[pos - bytesperline] != blobs[i].label) || (data[pos + bytesperline] != blobs[i].label))
-					{
-						blobs[i].perimeter++;
-					}
 				}
 			}
 		}
@@ -2028,6 +2599,15 @@ int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs) // os blobs acima inde
 		// blobs[i].yc = (ymax - ymin) / 2;
 		blobs[i].xc = sumx / MY_MAX(blobs[i].area, 1);
 		blobs[i].yc = sumy / MY_MAX(blobs[i].area, 1);
+
+		// Momentos centrais, orientação e eixos
+		vc_blob_set_moments(&blobs[i], blobs[i].area, sumx, sumy, sumxx, sumyy, sumxy);
+
+		// Per�metro
+		// Comprimento do contorno exterior, seguido a partir do primeiro pixel do blob
+		blobs[i].perimeter = 0;
+		if (blobs[i].area > 0)
+			blobs[i].perimeter = (int)(vc_contour_trace(src, blobs[i].label, xfirst, ymin, NULL) + 0.5f);
 	}
 
 	return 1;
@@ -2174,10 +2754,146 @@ int vc_draw_centerofgravity(IVC *src, OVC *blob)
 //            FUN��ES: Histogramas
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+// Lê 8 pixéis de uma vez (sem requisitos de alinhamento)
+static __inline unsigned long long vc_load64(const unsigned char *p)
+{
+	unsigned long long v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return v;
+}
+
+// Número de bandas de linhas processadas em paralelo (OpenMP) e área mínima para as usar
+#define VC_HIST_BANDS 8
+#define VC_HIST_PARALLEL_MIN (256 * 256)
+
+// Tempo em segundos (com OpenMP, clock() soma o tempo de CPU de todas as threads)
+#ifdef _OPENMP
+#define VC_SECONDS() omp_get_wtime()
+#else
+#define VC_SECONDS() ((double)clock() / CLOCKS_PER_SEC)
+#endif
+
+// Conta os pixéis das linhas [y0, y1[ em 4 histogramas intercalados. Pixéis iguais seguidos
+// caem em bancos diferentes, pelo que os incrementos não esperam pelo anterior
+// (store-to-load forwarding). Os pixéis são lidos 8 a 8 numa única leitura de 64 bits.
+static void vc_histogram_rows(const unsigned char *data, int width, int bytesperline, int y0, int y1, int *hist)
+{
+	unsigned int bank[4][256];
+	unsigned long long v;
+	const unsigned char *row;
+	int x, y, i;
+
+	memset(bank, 0, sizeof(bank));
+
+	for (y = y0; y < y1; y++)
+	{
+		row = &data[y * bytesperline];
+
+		for (x = 0; x + 8 <= width; x += 8)
+		{
+			v = vc_load64(&row[x]);
+
+			bank[0][v & 0xFF]++;
+			bank[1][(v >> 8) & 0xFF]++;
+			bank[2][(v >> 16) & 0xFF]++;
+			bank[3][(v >> 24) & 0xFF]++;
+			bank[0][(v >> 32) & 0xFF]++;
+			bank[1][(v >> 40) & 0xFF]++;
+			bank[2][(v >> 48) & 0xFF]++;
+			bank[3][v >> 56]++;
+		}
+
+		for (; x < width; x++)
+			bank[x & 3][row[x]]++;
+	}
+
+	for (i = 0; i < 256; i++)
+		hist[i] = (int)(bank[0][i] + bank[1][i] + bank[2][i] + bank[3][i]);
+}
+
+// Histograma de uma imagem em tons de cinzento (256 posições)
+// Em imagens grandes as linhas são divididas em bandas contadas em paralelo (se compilado
+// com OpenMP) e os histogramas das bandas são somados no fim.
+int vc_gray_histogram(IVC *src, int *hist)
+{
+	int band[VC_HIST_BANDS][256];
+	int nbands = 1;
+	int b, i;
+
+	// Verificação de erros
+	if ((src == NULL) || (hist == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if (src->channels != 1)
+		return 0;
+
+	if ((src->width * src->height >= VC_HIST_PARALLEL_MIN) && (src->height >= VC_HIST_BANDS))
+		nbands = VC_HIST_BANDS;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (nbands > 1)
+#endif
+	for (b = 0; b < nbands; b++)
+	{
+		vc_histogram_rows(src->data, src->width, src->bytesperline,
+						  src->height * b / nbands, src->height * (b + 1) / nbands, band[b]);
+	}
+
+	memcpy(hist, band[0], 256 * sizeof(int));
+	for (b = 1; b < nbands; b++)
+		for (i = 0; i < 256; i++)
+			hist[i] += band[b][i];
+
+	return 1;
+}
+
+// Compara o tempo do histograma (vc_gray_histogram) com o ciclo simples hist[data[i]]++
+// e verifica se os resultados são iguais
+int vc_gray_histogram_benchmark(IVC *src, int iterations)
+{
+	int hist[256], ref[256];
+	double start, tnaive, tbanks;
+	int n, x, y;
+
+	// Verificação de erros
+	if ((src == NULL) || (src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if ((src->channels != 1) || (iterations <= 0))
+		return 0;
+
+	start = VC_SECONDS();
+	for (n = 0; n < iterations; n++)
+	{
+		memset(ref, 0, sizeof(ref));
+		for (y = 0; y < src->height; y++)
+			for (x = 0; x < src->width; x++)
+				ref[src->data[y * src->bytesperline + x]]++;
+	}
+	tnaive = (VC_SECONDS() - start) * 1000.0 / iterations;
+
+	start = VC_SECONDS();
+	for (n = 0; n < iterations; n++)
+		vc_gray_histogram(src, hist);
+	tbanks = (VC_SECONDS() - start) * 1000.0 / iterations;
+
+	if (memcmp(hist, ref, sizeof(hist)) != 0)
+	{
+		printf("Histograma: resultados diferentes!\n");
+		return 0;
+	}
+
+	printf("Histograma %dx%d: simples %.3f ms, bancos %.3f ms (x%.2f)\n",
+		   src->width, src->height, tnaive, tbanks, (tbanks > 0.0) ? tnaive / tbanks : 0.0);
+
+	return 1;
+}
+
 // Função para imprimir um histograma de uma imagem em tons de cinzento
 int vc_gray_histogram_show(IVC *src, IVC *dst)
 {
-    unsigned char *data_src = (unsigned char *)src->data;
     unsigned char *data_dst = (unsigned char *)dst->data;
     int width = 256; // Largura fixa para o histograma
     int height = dst->height;
@@ -2197,10 +2913,7 @@ int vc_gray_histogram_show(IVC *src, IVC *dst)
         return 0;
 
     // Contagem : hist[data_src[i]]+= 1
-    for (i = 0; i < src->width * src->height; i++)
-    {
-        hist[data_src[i]] += 1;
-    }
+    vc_gray_histogram(src, hist);
 
     // Obter max do hist
     for (i = 0; i < 256; i++)
@@ -2246,19 +2959,9 @@ int vc_gray_histogram_show(IVC *src, IVC *dst)
 // Função para equalizar o histograma de uma imagem em tons de cinzento
 int vc_gray_histogram_equalization(IVC *src, IVC *dst)
 {
-    unsigned char *data_src = (unsigned char *)src->data;
-    unsigned char *data_dst = (unsigned char *)dst->data;
-    int width = src->width;
-    int height = src->height;
-    int bytesperline = src->bytesperline;
     int channels = src->channels;
-    int x, y, i;
-    long int pos;
     int hist[256] = {0}; // Histograma
-    int cdf[256] = {0};  // Função de distribuição cumulativa
-    int equalization[256] = {0}; // Mapeamento de equalização
-    int min_cdf = -1; // Valor mínimo do CDF
-    int max_cdf = 0;  // Valor máximo do CDF
+    unsigned char equalization[256]; // Mapeamento de equalização
 
     // Verificação de erros
     if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
@@ -2271,44 +2974,6567 @@ int vc_gray_histogram_equalization(IVC *src, IVC *dst)
         return 0;
 
     // Contagem do histograma
-    for (i = 0; i < width * height; i++)
-    {
-        hist[data_src[i]]++;
-    }
+    vc_gray_histogram(src, hist);
 
-    // Cálculo da função de distribuição cumulativa (CDF)
-    cdf[0] = hist[0];
-    for (i = 1; i < 256; i++)
-    {
-        cdf[i] = cdf[i - 1] + hist[i];
-    }
+    // Cálculo do mapeamento de equalização a partir da função de distribuição cumulativa (CDF)
+    vc_lut_equalization(equalization, hist, src->levels);
 
-    // Encontra o valor mínimo e máximo do CDF
-    for (i = 0; i < 256; i++)
-    {
-        if (cdf[i] > 0 && min_cdf == -1) {
-            min_cdf = cdf[i];
-        }
-        if (cdf[i] > max_cdf) {
-            max_cdf = cdf[i];
-        }
-    }
+    // Aplica a equalização aos pixels da imagem de entrada
+    return vc_lut_apply(src, dst, equalization);
+}
 
-    // Cálculo do mapeamento de equalização
-    for (i = 0; i < 256; i++)
-    {
-        equalization[i] = (int)(((float)cdf[i] - min_cdf) / ((float)max_cdf - min_cdf) * (src->levels - 1));
-    }
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Equalização adaptativa (CLAHE)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Interpolação entre os centros dos blocos ao longo de um eixo: para cada coordenada guarda
+// os dois blocos vizinhos e o peso do segundo (0..256)
+static void vc_clahe_axis(int size, int ntiles, int *i0, int *i1, int *w)
+{
+	int p, t;
+	float c0, c1, f;
+
+	for (p = 0, t = 0; p < size; p++)
+	{
+		// Centro do bloco t: meio de [size * t / ntiles, size * (t + 1) / ntiles[
+		while ((t + 1 < ntiles) && (p >= (size * (t + 1) / ntiles + size * (t + 2) / ntiles - 1) / 2.0f))
+			t++;
+
+		c0 = (size * t / ntiles + size * (t + 1) / ntiles - 1) / 2.0f;
+
+		if ((p < c0) || (t + 1 >= ntiles))
+		{
+			// Antes do primeiro centro ou depois do último: só um bloco
+			i0[p] = i1[p] = t;
+			w[p] = 0;
+		}
+		else
+		{
+			c1 = (size * (t + 1) / ntiles + size * (t + 2) / ntiles - 1) / 2.0f;
+			f = (p - c0) / (c1 - c0);
+
+			i0[p] = t;
+			i1[p] = t + 1;
+			w[p] = (int)(f * 256.0f + 0.5f);
+		}
+	}
+}
+
+// Equalização de histograma adaptativa com limite de contraste (CLAHE)
+// A imagem é dividida em tilesx x tilesy blocos. Cada bloco tem o seu histograma, limitado a
+// cliplimit vezes a altura média (o excesso é redistribuído por todos os níveis), e a sua
+// tabela de equalização. Cada pixel usa a interpolação bilinear das tabelas dos 4 blocos
+// mais próximos, em vírgula fixa. Os histogramas dos blocos e as linhas da imagem são
+// processados em paralelo quando compilado com OpenMP.
+int vc_gray_clahe(IVC *src, IVC *dst, int tilesx, int tilesy, float cliplimit)
+{
+	unsigned char *lut;
+	int *xi0, *xi1, *xw, *yi0, *yi1, *yw;
+	int width, height, ntiles;
+	int t, y;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1))
+		return 0;
+	if ((tilesx < 1) || (tilesy < 1) || (tilesx > src->width) || (tilesy > src->height))
+		return 0;
+
+	width = src->width;
+	height = src->height;
+	ntiles = tilesx * tilesy;
+
+	lut = (unsigned char *)malloc(ntiles * 256);
+	xi0 = (int *)malloc(3 * width * sizeof(int));
+	yi0 = (int *)malloc(3 * height * sizeof(int));
+	if ((lut == NULL) || (xi0 == NULL) || (yi0 == NULL))
+	{
+		free(lut);
+		free(xi0);
+		free(yi0);
+		return 0;
+	}
+	xi1 = xi0 + width;
+	xw = xi1 + width;
+	yi1 = yi0 + height;
+	yw = yi1 + height;
+
+	// Tabelas de equalização dos blocos
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (t = 0; t < ntiles; t++)
+	{
+		int tx = t % tilesx, ty = t / tilesx;
+		int x0 = width * tx / tilesx, x1 = width * (tx + 1) / tilesx;
+		int y0 = height * ty / tilesy, y1 = height * (ty + 1) / tilesy;
+		int area = (x1 - x0) * (y1 - y0);
+		int hist[256];
+		int limit, excess, add, rest, step, cdf, i;
+
+		vc_histogram_rows(&src->data[x0], x1 - x0, src->bytesperline, y0, y1, hist);
+
+		// Limite de contraste: corta os picos e redistribui o excesso
+		if (cliplimit > 0.0f)
+		{
+			limit = (int)(cliplimit * area / 256);
+			if (limit < 1)
+				limit = 1;
+
+			for (i = 0, excess = 0; i < 256; i++)
+			{
+				if (hist[i] > limit)
+				{
+					excess += hist[i] - limit;
+					hist[i] = limit;
+				}
+			}
+
+			add = excess / 256;
+			rest = excess - add * 256;
+			step = (rest > 0) ? 256 / rest : 1;
+
+			for (i = 0; i < 256; i++)
+				hist[i] += add;
+			for (i = 0; (i < 256) && (rest > 0); i += step, rest--)
+				hist[i]++;
+		}
+
+		// Mapeamento: cdf normalizada para [0, 255]
+		for (i = 0, cdf = 0; i < 256; i++)
+		{
+			cdf += hist[i];
+			lut[t * 256 + i] = (unsigned char)(((long long)cdf * 255 + area / 2) / area);
+		}
+	}
+
+	vc_clahe_axis(width, tilesx, xi0, xi1, xw);
+	vc_clahe_axis(height, tilesy, yi0, yi1, yw);
+
+	// Interpolação bilinear das tabelas (pesos de 8 bits em cada eixo)
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (y = 0; y < height; y++)
+	{
+		const unsigned char *lut0 = &lut[yi0[y] * tilesx * 256];
+		const unsigned char *lut1 = &lut[yi1[y] * tilesx * 256];
+		const unsigned char *s = &src->data[y * src->bytesperline];
+		unsigned char *d = &dst->data[y * dst->bytesperline];
+		int wy = yw[y];
+		int x, v, top, bottom;
+
+		for (x = 0; x < width; x++)
+		{
+			v = s[x];
+			top = lut0[xi0[x] * 256 + v] * (256 - xw[x]) + lut0[xi1[x] * 256 + v] * xw[x];
+			bottom = lut1[xi0[x] * 256 + v] * (256 - xw[x]) + lut1[xi1[x] * 256 + v] * xw[x];
+
+			d[x] = (unsigned char)((top * (256 - wy) + bottom * wy + (1 << 15)) >> 16);
+		}
+	}
+
+	free(lut);
+	free(xi0);
+	free(yi0);
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Limiares automáticos a partir do histograma
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Todas as funções seguintes só percorrem as 256 posições do histograma; a imagem é lida uma
+// única vez (vc_gray_histogram). O limiar devolvido segue vc_gray_to_binary: pixel > limiar
+// fica a 255. Devolvem -1 se o histograma estiver vazio.
+
+// Limiar pela média global
+int vc_histogram_mean(const int *hist)
+{
+	long long n = 0, sum = 0;
+	int i;
+
+	for (i = 0; i < 256; i++)
+	{
+		n += hist[i];
+		sum += (long long)i * hist[i];
+	}
+
+	return (n > 0) ? (int)(sum / n) : -1;
+}
+
+// Otsu: limiar que maximiza a variância entre classes
+// sigma_b(t) = (mT * w0 - m0)^2 / (w0 * (n - w0)), com w0 e m0 acumulados até t
+int vc_histogram_otsu(const int *hist)
+{
+	double n = 0.0, mT = 0.0;
+	double w0 = 0.0, m0 = 0.0;
+	double sigma, best = -1.0;
+	int t, threshold = -1;
+
+	for (t = 0; t < 256; t++)
+	{
+		n += hist[t];
+		mT += (double)t * hist[t];
+	}
+	if (n <= 0.0)
+		return -1;
+	mT /= n;
+
+	for (t = 0; t < 255; t++)
+	{
+		w0 += hist[t];
+		m0 += (double)t * hist[t];
+
+		if ((w0 <= 0.0) || (w0 >= n))
+			continue;
+
+		sigma = (mT * w0 - m0) * (mT * w0 - m0) / (w0 * (n - w0));
+		if (sigma > best)
+		{
+			best = sigma;
+			threshold = t;
+		}
+	}
+
+	// Imagem com um único nível de cinzento
+	if (threshold < 0)
+		for (threshold = 0; hist[threshold] == 0; threshold++);
+
+	return threshold;
+}
+
+// Multi-Otsu: divide o histograma em (nthresholds + 1) classes, maximizando a variância entre
+// classes. Como a média total é fixa, isso equivale a maximizar a soma de S^2 / W de cada classe
+// (W = número de pixéis, S = soma dos níveis), que é aditiva: resolve-se por programação
+// dinâmica em O(nthresholds * 256^2) em vez de testar todas as combinações.
+// thresholds[i] é o último nível da classe i (ordem crescente). Devolve o nº de limiares ou 0.
+int vc_histogram_multi_otsu(const int *hist, int nthresholds, int *thresholds)
+{
+	double P[257], S[257];
+	double best[VC_OTSU_MAX_THRESHOLDS + 1][256];
+	unsigned char from[VC_OTSU_MAX_THRESHOLDS + 1][256];
+	double w, sum, score;
+	int i, j, b, t;
+
+	if ((hist == NULL) || (thresholds == NULL) || (nthresholds < 1) || (nthresholds > VC_OTSU_MAX_THRESHOLDS))
+		return 0;
+
+	// Somas acumuladas: a classe [a, b] tem W = P[b + 1] - P[a] e S = S[b + 1] - S[a]
+	P[0] = S[0] = 0.0;
+	for (i = 0; i < 256; i++)
+	{
+		P[i + 1] = P[i] + hist[i];
+		S[i + 1] = S[i] + (double)i * hist[i];
+	}
+	if (P[256] <= 0.0)
+		return 0;
+
+	// best[j][b]: melhor divisão de [0, b] em j + 1 classes; from[j][b]: fim da classe anterior
+	for (b = 0; b < 256; b++)
+	{
+		best[0][b] = (P[b + 1] > 0.0) ? S[b + 1] * S[b + 1] / P[b + 1] : 0.0;
+		from[0][b] = 0;
+	}
+
+	for (j = 1; j <= nthresholds; j++)
+	{
+		for (b = 0; b < 256; b++)
+		{
+			best[j][b] = -1.0;
+			from[j][b] = 0;
+
+			for (t = j - 1; t < b; t++)
+			{
+				w = P[b + 1] - P[t + 1];
+				sum = S[b + 1] - S[t + 1];
+				score = best[j - 1][t] + ((w > 0.0) ? sum * sum / w : 0.0);
+
+				if (score > best[j][b])
+				{
+					best[j][b] = score;
+					from[j][b] = (unsigned char)t;
+				}
+			}
+		}
+	}
+
+	// Reconstrução dos limiares a partir do fim
+	b = 255;
+	for (j = nthresholds; j >= 1; j--)
+	{
+		thresholds[j - 1] = from[j][b];
+		b = from[j][b];
+	}
+
+	return nthresholds;
+}
+
+// Triângulo: recta entre o pico do histograma e a extremidade mais afastada (primeiro ou último
+// nível não nulo); o limiar é o nível com maior distância à recta. Adequado a histogramas com
+// um pico dominante (fundo) e o objecto numa cauda.
+int vc_histogram_triangle(const int *hist)
+{
+	int first, last, peak = 0, end, dir;
+	int i, threshold;
+	double dx, dy, d, dmax = -1.0;
+
+	for (first = 0; (first < 256) && (hist[first] == 0); first++);
+	if (first == 256)
+		return -1;
+	for (last = 255; hist[last] == 0; last--);
+
+	for (i = first; i <= last; i++)
+		if (hist[i] > hist[peak])
+			peak = i;
+
+	// Extremidade mais afastada do pico
+	if (last - peak > peak - first)
+	{
+		end = last;
+		dir = 1;
+	}
+	else
+	{
+		end = first;
+		dir = -1;
+	}
+
+	threshold = peak;
+	dx = end - peak;
+	dy = -(double)hist[peak];
+
+	// Distância (sem normalizar) de cada ponto (i, hist[i]) à recta pico -> (end, 0)
+	for (i = peak; i != end + dir; i += dir)
+	{
+		d = dy * (i - peak) - dx * ((double)hist[i] - hist[peak]);
+		if (d < 0.0)
+			d = -d;
+
+		if (d > dmax)
+		{
+			dmax = d;
+			threshold = i;
+		}
+	}
+
+	// Com o objecto à esquerda do pico, os pixéis do objecto são os <= limiar
+	if (dir < 0)
+		threshold--;
+
+	return (threshold < 0) ? 0 : threshold;
+}
+
+// Binarização pelo método de Otsu (uma leitura da imagem para o histograma)
+int vc_gray_to_binary_otsu(IVC *src, IVC *dst)
+{
+	int hist[256];
+	int threshold;
+
+	if (!vc_gray_histogram(src, hist))
+		return 0;
+
+	threshold = vc_histogram_otsu(hist);
+
+	return vc_gray_to_binary_src_dst(src, dst, threshold);
+}
+
+// Binarização pelo método do triângulo
+int vc_gray_to_binary_triangle(IVC *src, IVC *dst)
+{
+	int hist[256];
+	int threshold;
+
+	if (!vc_gray_histogram(src, hist))
+		return 0;
+
+	threshold = vc_histogram_triangle(hist);
+
+	return vc_gray_to_binary_src_dst(src, dst, threshold);
+}
+
+// Segmentação em (nthresholds + 1) níveis por multi-Otsu. A classe c fica com o valor
+// c * 255 / nthresholds. Se thresholds != NULL, recebe os limiares calculados.
+int vc_gray_multi_otsu(IVC *src, IVC *dst, int nthresholds, int *thresholds)
+{
+	int hist[256];
+	int t[VC_OTSU_MAX_THRESHOLDS];
+	unsigned char lut[256];
+	int x, y, i, c;
+
+	// Verificação de erros
+	if ((dst == NULL) || (dst->data == NULL) || (dst->channels != 1))
+		return 0;
+	if ((src == NULL) || (src->width != dst->width) || (src->height != dst->height))
+		return 0;
+	if (!vc_gray_histogram(src, hist))
+		return 0;
+	if (!vc_histogram_multi_otsu(hist, nthresholds, t))
+		return 0;
+
+	// Tabela nível -> classe
+	for (i = 0, c = 0; i < 256; i++)
+	{
+		while ((c < nthresholds) && (i > t[c]))
+			c++;
+		lut[i] = (unsigned char)(c * 255 / nthresholds);
+	}
+
+	for (y = 0; y < src->height; y++)
+	{
+		unsigned char *s = &src->data[y * src->bytesperline];
+		unsigned char *d = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < src->width; x++)
+			d[x] = lut[s[x]];
+	}
+
+	if (thresholds != NULL)
+		memcpy(thresholds, t, nthresholds * sizeof(int));
+
+	return 1;
+}
+
+// Inicializa o estado do limiar automático para vídeo
+void vc_threshold_init(THRESHVC *state, int method, float alpha, int period)
+{
+	memset(state, 0, sizeof(THRESHVC));
+
+	state->method = method;
+	state->alpha = ((alpha > 0.0f) && (alpha <= 1.0f)) ? alpha : 1.0f;
+	state->period = (period >= 1) ? period : 1;
+	state->threshold = -1;
+}
+
+// Binarização automática de um frame de vídeo. O histograma só é lido da imagem a cada
+// state->period frames e é misturado com o anterior (smooth = alpha * novo + (1 - alpha) * smooth),
+// o que evita oscilações do limiar entre frames. Nos restantes frames é usado o último limiar.
+int vc_gray_to_binary_auto(IVC *src, IVC *dst, THRESHVC *state)
+{
+	int hist[256];
+	int i;
+
+	if (state == NULL)
+		return 0;
+
+	if ((state->frame % state->period == 0) || (state->threshold < 0))
+	{
+		if (!vc_gray_histogram(src, hist))
+			return 0;
+
+		for (i = 0; i < 256; i++)
+		{
+			if (state->threshold < 0)
+				state->smooth[i] = (float)hist[i];
+			else
+				state->smooth[i] = state->alpha * hist[i] + (1.0f - state->alpha) * state->smooth[i];
+
+			hist[i] = (int)(state->smooth[i] + 0.5f);
+		}
+
+		switch (state->method)
+		{
+		case VC_THRESHOLD_MEAN:
+			state->threshold = vc_histogram_mean(hist);
+			break;
+		case VC_THRESHOLD_TRIANGLE:
+			state->threshold = vc_histogram_triangle(hist);
+			break;
+		default:
+			state->threshold = vc_histogram_otsu(hist);
+			break;
+		}
+	}
+
+	state->frame++;
+
+	return vc_gray_to_binary_src_dst(src, dst, state->threshold);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Tabelas de consulta (LUT)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Os operadores ponto a ponto (negativo, binarização, equalização, falsa cor) são tabelas de
+// 256 entradas. Uma sequência destes operadores compõe-se numa única tabela (vc_lut_compose),
+// e a imagem é percorrida uma só vez com uma leitura de tabela por pixel.
+
+void vc_lut_identity(unsigned char *lut)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+		lut[i] = (unsigned char)i;
+}
+
+void vc_lut_negative(unsigned char *lut)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+		lut[i] = (unsigned char)(255 - i);
+}
+
+// Pixel > threshold -> 255, restantes -> 0 (como vc_gray_to_binary)
+void vc_lut_threshold(unsigned char *lut, int threshold)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+		lut[i] = (i > threshold) ? 255 : 0;
+}
+
+// Mapeamento de equalização: (cdf - cdf_min) / (cdf_max - cdf_min) * (levels - 1)
+// Uma imagem de um só nível fica inalterada (tabela identidade).
+void vc_lut_equalization(unsigned char *lut, const int *hist, int levels)
+{
+	int cdf[256];
+	int min_cdf = -1, max_cdf;
+	int i, v;
+
+	cdf[0] = hist[0];
+	for (i = 1; i < 256; i++)
+		cdf[i] = cdf[i - 1] + hist[i];
+
+	for (i = 0; (i < 256) && (min_cdf == -1); i++)
+		if (cdf[i] > 0)
+			min_cdf = cdf[i];
+	max_cdf = cdf[255];
+
+	if (max_cdf <= min_cdf)
+	{
+		vc_lut_identity(lut);
+		return;
+	}
+
+	for (i = 0; i < 256; i++)
+	{
+		v = (int)(((float)cdf[i] - min_cdf) / ((float)max_cdf - min_cdf) * (levels - 1));
+		lut[i] = (unsigned char)((v < 0) ? 0 : (v > 255) ? 255 : v);
+	}
+}
+
+// Rampa de falsa cor (azul -> verde -> vermelho) usada em vc_scale_gray_to_rgb
+// Tabela de 3 canais: R, G e B
+void vc_lut_false_color(unsigned char *lut3)
+{
+	int i;
+
+	for (i = 0; i < 256; i++)
+	{
+		if (i < 64)
+		{ // Intensidade baixa -> Azul
+			lut3[i] = 0;
+			lut3[256 + i] = (unsigned char)(4 * i);
+			lut3[512 + i] = 255;
+		}
+		else if (i < 128)
+		{ // Intensidade média-baixa -> Verde
+			lut3[i] = 0;
+			lut3[256 + i] = 255;
+			lut3[512 + i] = (unsigned char)(255 - 4 * (i - 64));
+		}
+		else if (i < 192)
+		{ // Intensidade média-alta -> Verde
+			lut3[i] = (unsigned char)(4 * (i - 128));
+			lut3[256 + i] = 255;
+			lut3[512 + i] = 0;
+		}
+		else
+		{ // Intensidade alta -> Vermelho
+			lut3[i] = 255;
+			lut3[256 + i] = (unsigned char)(255 - 4 * (i - 192));
+			lut3[512 + i] = 0;
+		}
+	}
+}
+
+// Composição: lut[i] = second[first[i]] (aplicar first e depois second)
+// lut pode ser a mesma tabela que first ou second.
+void vc_lut_compose(unsigned char *lut, const unsigned char *first, const unsigned char *second)
+{
+	unsigned char tmp[256];
+	int i;
+
+	for (i = 0; i < 256; i++)
+		tmp[i] = second[first[i]];
+
+	memcpy(lut, tmp, 256);
+}
+
+// Aplica uma tabela a n bytes. Lê e escreve 8 pixéis de cada vez (uma leitura e uma escrita
+// de 64 bits), o que permite src == dst.
+static void vc_lut_row(const unsigned char *src, unsigned char *dst, int n, const unsigned char *lut)
+{
+	unsigned long long v, r;
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		v = vc_load64(&src[i]);
+
+		r = (unsigned long long)lut[v & 0xFF] |
+			((unsigned long long)lut[(v >> 8) & 0xFF] << 8) |
+			((unsigned long long)lut[(v >> 16) & 0xFF] << 16) |
+			((unsigned long long)lut[(v >> 24) & 0xFF] << 24) |
+			((unsigned long long)lut[(v >> 32) & 0xFF] << 32) |
+			((unsigned long long)lut[(v >> 40) & 0xFF] << 40) |
+			((unsigned long long)lut[(v >> 48) & 0xFF] << 48) |
+			((unsigned long long)lut[v >> 56] << 56);
+
+		memcpy(&dst[i], &r, sizeof(r));
+	}
+
+	for (; i < n; i++)
+		dst[i] = lut[src[i]];
+}
+
+// Aplica a mesma tabela a todos os canais (src e dst com as mesmas dimensões; pode ser src == dst)
+int vc_lut_apply(IVC *src, IVC *dst, const unsigned char *lut)
+{
+	int y;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (lut == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels))
+		return 0;
+
+	for (y = 0; y < src->height; y++)
+		vc_lut_row(&src->data[y * src->bytesperline], &dst->data[y * dst->bytesperline], src->width * src->channels, lut);
+
+	return 1;
+}
+
+// Aplica uma tabela diferente a cada canal de uma imagem de 3 canais (pode ser src == dst)
+int vc_lut3_apply(IVC *src, IVC *dst, const unsigned char *lut3)
+{
+	const unsigned char *lut0 = lut3, *lut1 = lut3 + 256, *lut2 = lut3 + 512;
+	unsigned char *ps, *pd;
+	int x, y;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (lut3 == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 3) || (dst->channels != 3))
+		return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		ps = &src->data[y * src->bytesperline];
+		pd = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < src->width * 3; x += 3)
+		{
+			pd[x] = lut0[ps[x]];
+			pd[x + 1] = lut1[ps[x + 1]];
+			pd[x + 2] = lut2[ps[x + 2]];
+		}
+	}
+
+	return 1;
+}
+
+// Converte uma imagem de 1 canal em 3 canais através de uma tabela de 3 canais (paleta)
+int vc_lut_gray_to_rgb(IVC *src, IVC *dst, const unsigned char *lut3)
+{
+	unsigned char *ps, *pd;
+	int x, y;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (lut3 == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 3))
+		return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		ps = &src->data[y * src->bytesperline];
+		pd = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < src->width; x++)
+		{
+			pd[x * 3] = lut3[ps[x]];
+			pd[x * 3 + 1] = lut3[256 + ps[x]];
+			pd[x * 3 + 2] = lut3[512 + ps[x]];
+		}
+	}
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Imagens binárias em Run-Length (RLE)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Uma imagem binária RLE guarda, para cada linha, a lista ordenada de runs (segmentos
+// horizontais de pixéis de primeiro plano). As funções seguintes só percorrem os runs, pelo
+// que o seu custo depende do número de segmentos e não da área da imagem.
+
+// Acumuladores das estatísticas de um blob, preenchidos run a run
+typedef struct vcblobacc
+{
+	long long area;
+	long long sumx, sumy;
+	long long sumxx, sumyy, sumxy;	// Momentos de 2ª ordem
+	int xmin, ymin, xmax, ymax;
+} VCBLOBACC;
+
+static void vc_blob_acc_init(VCBLOBACC *acc, int width, int height)
+{
+	acc->area = 0;
+	acc->sumx = 0;
+	acc->sumy = 0;
+	acc->sumxx = 0;
+	acc->sumyy = 0;
+	acc->sumxy = 0;
+	acc->xmin = width - 1;
+	acc->ymin = height - 1;
+	acc->xmax = 0;
+	acc->ymax = 0;
+}
+
+// Soma ao blob o run [x0, x1] da linha y
+static __inline void vc_blob_acc_add_run(VCBLOBACC *acc, int y, int x0, int x1)
+{
+	long long n = x1 - x0 + 1;
+	long long sx = ((long long)(x0 + x1) * n) / 2; // Soma de x0..x1 (o produto é sempre par)
+	long long a = x0 - 1, b = x1;
+
+	acc->area += n;
+	acc->sumx += sx;
+	acc->sumy += (long long)y * n;
+
+	// Soma de x^2 em x0..x1: S(x1) - S(x0 - 1), com S(k) = k (k + 1) (2k + 1) / 6
+	acc->sumxx += (b * (b + 1) * (2 * b + 1) - a * (a + 1) * (2 * a + 1)) / 6;
+	acc->sumyy += (long long)y * y * n;
+	acc->sumxy += (long long)y * sx;
+
+	if (acc->xmin > x0)
+		acc->xmin = x0;
+	if (acc->xmax < x1)
+		acc->xmax = x1;
+	if (acc->ymin > y)
+		acc->ymin = y;
+	if (acc->ymax < y)
+		acc->ymax = y;
+}
+
+// Converte os acumuladores nos campos do OVC (mesmas convenções de vc_binary_blob_info)
+static void vc_blob_acc_to_ovc(VCBLOBACC *acc, OVC *blob)
+{
+	blob->area = (int)acc->area;
+	blob->perimeter = 0;
+
+	if (acc->area == 0)
+	{
+		blob->x = blob->y = blob->width = blob->height = 0;
+		blob->xc = blob->yc = 0;
+		vc_blob_set_moments(blob, 0, 0, 0, 0, 0, 0);
+		return;
+	}
+
+	// Bounding Box
+	blob->x = acc->xmin;
+	blob->y = acc->ymin;
+	blob->width = (acc->xmax - acc->xmin) + 1;
+	blob->height = (acc->ymax - acc->ymin) + 1;
+
+	// Centro de Gravidade
+	blob->xc = (int)(acc->sumx / acc->area);
+	blob->yc = (int)(acc->sumy / acc->area);
+
+	// Momentos centrais, orientação e eixos
+	vc_blob_set_moments(blob, acc->area, acc->sumx, acc->sumy, acc->sumxx, acc->sumyy, acc->sumxy);
+}
+
+// Procura a raiz de um elemento numa floresta union-find (com compressão de caminho)
+static int vc_uf_find(int *parent, int i)
+{
+	int root = i, next;
+
+	while (parent[root] != root)
+		root = parent[root];
+
+	while (parent[i] != root)
+	{
+		next = parent[i];
+		parent[i] = root;
+		i = next;
+	}
+
+	return root;
+}
+
+// Une dois conjuntos. A raiz com menor índice prevalece, pelo que a raiz de cada
+// conjunto é sempre o seu primeiro elemento (em ordem raster, no caso dos runs).
+static void vc_uf_union(int *parent, int a, int b)
+{
+	a = vc_uf_find(parent, a);
+	b = vc_uf_find(parent, b);
+
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
+
+// Garante espaço para mais 'count' runs
+static int vc_rle_reserve(RLEVC *rle, int count)
+{
+	RUNVC *runs;
+	int capacity = rle->capacity;
+
+	if (rle->nruns + count <= capacity)
+		return 1;
+
+	while (rle->nruns + count > capacity)
+		capacity *= 2;
+
+	runs = (RUNVC *)realloc(rle->runs, capacity * sizeof(RUNVC));
+	if (runs == NULL)
+		return 0;
+
+	rle->runs = runs;
+	rle->capacity = capacity;
+
+	return 1;
+}
+
+// Une duas listas ordenadas de runs de uma linha. Devolve o número de runs em out.
+static int vc_runs_union(const RUNVC *a, int na, const RUNVC *b, int nb, RUNVC *out)
+{
+	int i = 0, j = 0, n = 0;
+	RUNVC r;
+
+	while ((i < na) || (j < nb))
+	{
+		if ((j >= nb) || ((i < na) && (a[i].x0 <= b[j].x0)))
+			r = a[i++];
+		else
+			r = b[j++];
+
+		// Runs sobrepostos ou adjacentes fundem-se num só
+		if ((n > 0) && (r.x0 <= out[n - 1].x1 + 1))
+		{
+			if (r.x1 > out[n - 1].x1)
+				out[n - 1].x1 = r.x1;
+		}
+		else
+		{
+			out[n].x0 = r.x0;
+			out[n].x1 = r.x1;
+			out[n].label = 0;
+			n++;
+		}
+	}
+
+	return n;
+}
+
+// Intersecta duas listas ordenadas de runs de uma linha. Devolve o número de runs em out.
+static int vc_runs_intersect(const RUNVC *a, int na, const RUNVC *b, int nb, RUNVC *out)
+{
+	int i = 0, j = 0, n = 0;
+	int x0, x1;
+
+	while ((i < na) && (j < nb))
+	{
+		x0 = MY_MAX(a[i].x0, b[j].x0);
+		x1 = MY_MIN(a[i].x1, b[j].x1);
+
+		if (x0 <= x1)
+		{
+			out[n].x0 = x0;
+			out[n].x1 = x1;
+			out[n].label = 0;
+			n++;
+		}
+
+		if (a[i].x1 < b[j].x1)
+			i++;
+		else
+			j++;
+	}
+
+	return n;
+}
+
+// Alocar memória para uma imagem RLE
+RLEVC *vc_rle_new(int width, int height, int capacity)
+{
+	RLEVC *rle;
+
+	if ((width <= 0) || (height <= 0))
+		return NULL;
+
+	rle = (RLEVC *)malloc(sizeof(RLEVC));
+	if (rle == NULL)
+		return NULL;
+
+	rle->width = width;
+	rle->height = height;
+	rle->nruns = 0;
+	rle->capacity = MY_MAX(capacity, 16);
+	rle->runs = (RUNVC *)malloc(rle->capacity * sizeof(RUNVC));
+	rle->rowstart = (int *)calloc(height + 1, sizeof(int));
+
+	if ((rle->runs == NULL) || (rle->rowstart == NULL))
+		return vc_rle_free(rle);
+
+	return rle;
+}
+
+// Libertar memória de uma imagem RLE
+RLEVC *vc_rle_free(RLEVC *rle)
+{
+	if (rle != NULL)
+	{
+		if (rle->runs != NULL)
+			free(rle->runs);
+		if (rle->rowstart != NULL)
+			free(rle->rowstart);
+
+		free(rle);
+		rle = NULL;
+	}
+
+	return rle;
+}
+
+// Acrescenta ao RLE os runs da linha y (as linhas têm de ser acrescentadas por ordem)
+static int vc_rle_append_row(RLEVC *rle, int y, const unsigned char *row)
+{
+	int width = rle->width;
+	int x = 0, x0;
+	RUNVC *run;
+
+	rle->rowstart[y] = rle->nruns;
+
+	// Uma linha tem, no máximo, (width + 1) / 2 runs
+	if (!vc_rle_reserve(rle, (width + 1) / 2))
+		return 0;
+
+	while (x < width)
+	{
+		// Salta o fundo, 8 pixéis de cada vez
+		while ((x + 8 <= width) && (vc_load64(&row[x]) == 0))
+			x += 8;
+		while ((x < width) && (row[x] == 0))
+			x++;
+		if (x >= width)
+			break;
+
+		x0 = x;
+		while ((x < width) && (row[x] != 0))
+			x++;
+
+		run = &rle->runs[rle->nruns++];
+		run->x0 = x0;
+		run->x1 = x - 1;
+		run->label = 0;
+	}
+
+	rle->rowstart[y + 1] = rle->nruns;
+
+	return 1;
+}
+
+// Converte uma imagem binária (1 canal, primeiro plano != 0) para RLE
+int vc_rle_from_image(IVC *src, RLEVC *rle)
+{
+	unsigned char *data = (unsigned char *)src->data;
+	int y;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if (src->channels != 1)
+		return 0;
+	if ((rle == NULL) || (rle->width != src->width) || (rle->height != src->height))
+		return 0;
+
+	rle->nruns = 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		if (!vc_rle_append_row(rle, y, &data[y * src->bytesperline]))
+			return 0;
+	}
+
+	return 1;
+}
+
+// Converte uma imagem RLE numa imagem de 1 canal
+// uselabels = 0 : primeiro plano a 255
+// uselabels = 1 : cada run é pintado com a sua etiqueta (etiquetas > 255 ficam a 255)
+int vc_rle_to_image(RLEVC *rle, IVC *dst, int uselabels)
+{
+	unsigned char *data = (unsigned char *)dst->data;
+	unsigned char *row;
+	int bytesperline = dst->bytesperline;
+	int y, i, value;
+
+	// Verificação de erros
+	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL))
+		return 0;
+	if (dst->channels != 1)
+		return 0;
+	if ((rle == NULL) || (rle->width != dst->width) || (rle->height != dst->height))
+		return 0;
+
+	for (y = 0; y < rle->height; y++)
+	{
+		row = &data[y * bytesperline];
+		memset(row, 0, rle->width);
+
+		for (i = rle->rowstart[y]; i < rle->rowstart[y + 1]; i++)
+		{
+			value = uselabels ? MY_MIN(rle->runs[i].label, 255) : 255;
+			memset(&row[rle->runs[i].x0], value, rle->runs[i].x1 - rle->runs[i].x0 + 1);
+		}
+	}
+
+	return 1;
+}
+
+// Etiquetagem de blobs sobre runs (vizinhança-8, como em vc_binary_blob_labelling)
+// rle		: Imagem RLE de entrada (o campo label de cada run é preenchido)
+// nlabels	: Endereço de memória onde será armazenado o número de etiquetas encontradas
+// OVC*		: Array de blobs com etiquetas 1..nlabels, numeradas pela ordem raster do primeiro pixel.
+//			  É necessário libertar posteriormente esta memória.
+// Ao contrário de vc_binary_blob_labelling, não há limite de 254 etiquetas e os rebordos não são apagados.
+OVC *vc_rle_labelling(RLEVC *rle, int *nlabels)
+{
+	RUNVC *runs;
+	int *parent;
+	int y, i, j, k, end, pend;
+	int label = 0;
+	OVC *blobs;
+
+	*nlabels = 0;
+
+	// Verificação de erros
+	if ((rle == NULL) || (rle->runs == NULL))
+		return NULL;
+	if (rle->nruns == 0)
+		return NULL;
+
+	parent = (int *)malloc(rle->nruns * sizeof(int));
+	if (parent == NULL)
+		return NULL;
+
+	runs = rle->runs;
+	for (i = 0; i < rle->nruns; i++)
+		parent[i] = i;
+
+	// Une cada run aos runs da linha anterior que lhe tocam (incluindo na diagonal)
+	for (y = 1; y < rle->height; y++)
+	{
+		j = rle->rowstart[y - 1];
+		pend = rle->rowstart[y];
+		end = rle->rowstart[y + 1];
+
+		for (i = rle->rowstart[y]; i < end; i++)
+		{
+			while ((j < pend) && (runs[j].x1 + 1 < runs[i].x0))
+				j++;
+
+			for (k = j; (k < pend) && (runs[k].x0 <= runs[i].x1 + 1); k++)
+				vc_uf_union(parent, i, k);
+		}
+	}
+
+	// As raízes são o primeiro run de cada blob, logo recebem as etiquetas por ordem
+	for (i = 0; i < rle->nruns; i++)
+	{
+		if (parent[i] == i)
+			runs[i].label = ++label;
+		else
+			runs[i].label = runs[vc_uf_find(parent, i)].label;
+	}
+
+	free(parent);
+
+	*nlabels = label;
+
+	// Cria lista de blobs (objectos) e preenche a etiqueta
+	blobs = (OVC *)calloc(label, sizeof(OVC));
+	if (blobs == NULL)
+		return NULL;
+
+	for (i = 0; i < label; i++)
+		blobs[i].label = i + 1;
+
+	return blobs;
+}
+
+// Calcula área, bounding box e centro de gravidade de cada blob, percorrendo apenas os runs
+int vc_rle_blob_info(RLEVC *rle, OVC *blobs, int nblobs)
+{
+	VCBLOBACC *acc;
+	int *index;
+	int maxlabel = 0;
+	int y, i, b;
+
+	// Verificação de erros
+	if ((rle == NULL) || (rle->runs == NULL))
+		return 0;
+	if ((blobs == NULL) || (nblobs <= 0))
+		return 0;
+
+	for (i = 0; i < nblobs; i++)
+		maxlabel = MY_MAX(maxlabel, blobs[i].label);
+
+	// Tabela etiqueta -> índice do blob (os blobs podem ter sido reordenados ou filtrados)
+	index = (int *)malloc((maxlabel + 1) * sizeof(int));
+	acc = (VCBLOBACC *)malloc(nblobs * sizeof(VCBLOBACC));
+	if ((index == NULL) || (acc == NULL))
+	{
+		free(index);
+		free(acc);
+		return 0;
+	}
+
+	for (i = 0; i <= maxlabel; i++)
+		index[i] = -1;
+	for (i = 0; i < nblobs; i++)
+	{
+		if (blobs[i].label > 0)
+			index[blobs[i].label] = i;
+		vc_blob_acc_init(&acc[i], rle->width, rle->height);
+	}
+
+	for (y = 0; y < rle->height; y++)
+	{
+		for (i = rle->rowstart[y]; i < rle->rowstart[y + 1]; i++)
+		{
+			if ((rle->runs[i].label <= 0) || (rle->runs[i].label > maxlabel))
+				continue;
+
+			b = index[rle->runs[i].label];
+			if (b >= 0)
+				vc_blob_acc_add_run(&acc[b], y, rle->runs[i].x0, rle->runs[i].x1);
+		}
+	}
+
+	for (i = 0; i < nblobs; i++)
+		vc_blob_acc_to_ovc(&acc[i], &blobs[i]);
+
+	free(index);
+	free(acc);
+
+	return 1;
+}
+
+// Dilatação binária com elemento estruturante quadrado (kernel x kernel) sobre runs.
+// O quadrado é separável: dilata-se cada run na horizontal e depois faz-se a união das
+// linhas vizinhas. Os pixéis fora da imagem são ignorados, como em vc_binary_dilate.
+int vc_rle_dilate(RLEVC *src, RLEVC *dst, int kernel)
+{
+	int width, height;
+	int offset = (kernel - 1) / 2;
+	int x, y, yy, i, n, nrow;
+	RLEVC *tmp;
+	RUNVC *acc, *aux, *swap;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src == dst))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height))
+		return 0;
+
+	width = src->width;
+	height = src->height;
+	nrow = (width + 1) / 2 + 1;
+
+	tmp = vc_rle_new(width, height, src->nruns);
+	acc = (RUNVC *)malloc(nrow * sizeof(RUNVC));
+	aux = (RUNVC *)malloc(nrow * sizeof(RUNVC));
+	if ((tmp == NULL) || (acc == NULL) || (aux == NULL))
+	{
+		vc_rle_free(tmp);
+		free(acc);
+		free(aux);
+		return 0;
+	}
+
+	// Dilatação horizontal: cada run cresce 'offset' pixéis para cada lado
+	for (y = 0; y < height; y++)
+	{
+		tmp->rowstart[y] = tmp->nruns;
+
+		for (i = src->rowstart[y]; i < src->rowstart[y + 1]; i++)
+		{
+			x = MY_MAX(src->runs[i].x0 - offset, 0);
+
+			if ((tmp->nruns > tmp->rowstart[y]) && (x <= tmp->runs[tmp->nruns - 1].x1 + 1))
+			{
+				tmp->runs[tmp->nruns - 1].x1 = MY_MIN(src->runs[i].x1 + offset, width - 1);
+			}
+			else
+			{
+				tmp->runs[tmp->nruns].x0 = x;
+				tmp->runs[tmp->nruns].x1 = MY_MIN(src->runs[i].x1 + offset, width - 1);
+				tmp->runs[tmp->nruns].label = 0;
+				tmp->nruns++;
+			}
+		}
+	}
+	tmp->rowstart[height] = tmp->nruns;
+
+	// Dilatação vertical: união das linhas [y - offset, y + offset]
+	dst->nruns = 0;
+	for (y = 0; y < height; y++)
+	{
+		dst->rowstart[y] = dst->nruns;
+
+		yy = MY_MAX(y - offset, 0);
+		n = tmp->rowstart[yy + 1] - tmp->rowstart[yy];
+		memcpy(acc, &tmp->runs[tmp->rowstart[yy]], n * sizeof(RUNVC));
+
+		for (yy = yy + 1; yy <= MY_MIN(y + offset, height - 1); yy++)
+		{
+			n = vc_runs_union(acc, n, &tmp->runs[tmp->rowstart[yy]], tmp->rowstart[yy + 1] - tmp->rowstart[yy], aux);
+			swap = acc;
+			acc = aux;
+			aux = swap;
+		}
+
+		if (!vc_rle_reserve(dst, n))
+		{
+			vc_rle_free(tmp);
+			free(acc);
+			free(aux);
+			return 0;
+		}
+		memcpy(&dst->runs[dst->nruns], acc, n * sizeof(RUNVC));
+		dst->nruns += n;
+	}
+	dst->rowstart[height] = dst->nruns;
+
+	vc_rle_free(tmp);
+	free(acc);
+	free(aux);
+
+	return 1;
+}
+
+// Erosão binária com elemento estruturante quadrado (kernel x kernel) sobre runs.
+// Cada run encolhe 'offset' pixéis para cada lado (excepto junto ao rebordo) e depois
+// faz-se a intersecção das linhas vizinhas. Os pixéis fora da imagem são ignorados,
+// como em vc_binary_erode.
+int vc_rle_erode(RLEVC *src, RLEVC *dst, int kernel)
+{
+	int width, height;
+	int offset = (kernel - 1) / 2;
+	int x0, x1, y, yy, i, n, nrow;
+	RLEVC *tmp;
+	RUNVC *acc, *aux, *swap;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src == dst))
+		return 0;
+	if ((src->width != dst->width) || (src->height != dst->height))
+		return 0;
+
+	width = src->width;
+	height = src->height;
+	nrow = (width + 1) / 2 + 1;
+
+	tmp = vc_rle_new(width, height, src->nruns);
+	acc = (RUNVC *)malloc(nrow * sizeof(RUNVC));
+	aux = (RUNVC *)malloc(nrow * sizeof(RUNVC));
+	if ((tmp == NULL) || (acc == NULL) || (aux == NULL))
+	{
+		vc_rle_free(tmp);
+		free(acc);
+		free(aux);
+		return 0;
+	}
+
+	// Erosão horizontal
+	for (y = 0; y < height; y++)
+	{
+		tmp->rowstart[y] = tmp->nruns;
+
+		for (i = src->rowstart[y]; i < src->rowstart[y + 1]; i++)
+		{
+			x0 = (src->runs[i].x0 == 0) ? 0 : src->runs[i].x0 + offset;
+			x1 = (src->runs[i].x1 == width - 1) ? width - 1 : src->runs[i].x1 - offset;
+
+			if (x0 <= x1)
+			{
+				tmp->runs[tmp->nruns].x0 = x0;
+				tmp->runs[tmp->nruns].x1 = x1;
+				tmp->runs[tmp->nruns].label = 0;
+				tmp->nruns++;
+			}
+		}
+	}
+	tmp->rowstart[height] = tmp->nruns;
+
+	// Erosão vertical: intersecção das linhas [y - offset, y + offset]
+	dst->nruns = 0;
+	for (y = 0; y < height; y++)
+	{
+		dst->rowstart[y] = dst->nruns;
+
+		yy = MY_MAX(y - offset, 0);
+		n = tmp->rowstart[yy + 1] - tmp->rowstart[yy];
+		memcpy(acc, &tmp->runs[tmp->rowstart[yy]], n * sizeof(RUNVC));
+
+		for (yy = yy + 1; (n > 0) && (yy <= MY_MIN(y + offset, height - 1)); yy++)
+		{
+			n = vc_runs_intersect(acc, n, &tmp->runs[tmp->rowstart[yy]], tmp->rowstart[yy + 1] - tmp->rowstart[yy], aux);
+			swap = acc;
+			acc = aux;
+			aux = swap;
+		}
+
+		if (!vc_rle_reserve(dst, n))
+		{
+			vc_rle_free(tmp);
+			free(acc);
+			free(aux);
+			return 0;
+		}
+		memcpy(&dst->runs[dst->nruns], acc, n * sizeof(RUNVC));
+		dst->nruns += n;
+	}
+	dst->rowstart[height] = dst->nruns;
+
+	vc_rle_free(tmp);
+	free(acc);
+	free(aux);
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Etiquetagem paralela por faixas
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Versão paralela de vc_binary_blob_labelling, com o mesmo resultado (mesmas etiquetas e a mesma
+// lista de blobs). A imagem é dividida em faixas horizontais etiquetadas em simultâneo; as
+// equivalências entre faixas são resolvidas no fim, só ao longo das linhas de fronteira.
+//
+// Etiquetas iguais às da versão série: na versão série, um pixel recebe uma etiqueta nova quando
+// A, B, C e D (vizinhos já percorridos) são fundo, e a etiqueta final de cada blob é a menor
+// etiqueta nova do blob. Essa condição só depende da imagem binária, por isso cada faixa conta as
+// suas etiquetas novas de forma independente e a numeração global obtém-se somando as contagens
+// das faixas anteriores. Na 1ª linha de uma faixa, um pixel que só tenha vizinhos na faixa de
+// cima recebe uma etiqueta "pendente", numerada depois de todas as etiquetas novas, para nunca
+// ser a raiz (a união mantém a menor etiqueta).
+
+// Estado de uma faixa
+typedef struct
+{
+	int y0, y1;		// Linhas [y0, y1[
+	int nnew;		// Etiquetas novas (locais 1..nnew)
+	int npending;	// Etiquetas pendentes (locais capnew+1..capnew+npending)
+	int capnew;		// Nº máximo de etiquetas novas na faixa
+	int *parent;	// Union-find local
+	int offnew;		// Nº de etiquetas novas das faixas anteriores
+	int offpending; // Nº de etiquetas pendentes das faixas anteriores
+} VCSTRIPE;
+
+// Etiqueta global de uma etiqueta local l da faixa st (ntotal = nº total de etiquetas novas)
+static __inline int vc_stripe_global(VCSTRIPE *st, int l, int ntotal)
+{
+	return (l <= st->capnew) ? st->offnew + l : ntotal + st->offpending + (l - st->capnew);
+}
+
+// Etiqueta as linhas [y0, y1[ de uma faixa. labels recebe etiquetas locais (0 = fundo).
+static void vc_stripe_label(const unsigned char *bin, int *labels, int width, int bytesperline, VCSTRIPE *st)
+{
+	int x, y, l;
+	int la, lb, lc, ld;
+	long int pos;
+
+	st->nnew = st->npending = 0;
+
+	for (y = st->y0; y < st->y1; y++)
+	{
+		// Rebordos (fundo)
+		labels[y * bytesperline] = 0;
+		labels[y * bytesperline + width - 1] = 0;
+
+		for (x = 1; x < width - 1; x++)
+		{
+			pos = y * bytesperline + x;
+
+			if (bin[pos] == 0)
+			{
+				labels[pos] = 0;
+				continue;
+			}
+
+			// Vizinhos A, B, C (linha de cima, só se for da mesma faixa) e D
+			if (y > st->y0)
+			{
+				la = labels[pos - bytesperline - 1];
+				lb = labels[pos - bytesperline];
+				lc = labels[pos - bytesperline + 1];
+			}
+			else
+				la = lb = lc = 0;
+			ld = labels[pos - 1];
+
+			// A, C e D são vizinhos de B, e A é vizinho de D, por isso já foram unidos ao
+			// etiquetar os pixéis anteriores: só C pode juntar dois blobs (com A ou com D)
+			if (lb != 0)
+				labels[pos] = lb;
+			else if (lc != 0)
+			{
+				labels[pos] = lc;
+				if (la != 0)
+					vc_uf_union(st->parent, lc, la);
+				else if (ld != 0)
+					vc_uf_union(st->parent, lc, ld);
+			}
+			else if (la != 0)
+				labels[pos] = la;
+			else if (ld != 0)
+				labels[pos] = ld;
+			else if ((y == st->y0) && ((bin[pos - bytesperline - 1] != 0) || (bin[pos - bytesperline] != 0) || (bin[pos - bytesperline + 1] != 0)))
+			{
+				// Só tem vizinhos na faixa de cima: etiqueta pendente
+				st->npending++;
+				l = st->capnew + st->npending;
+				st->parent[l] = l;
+				labels[pos] = l;
+			}
+			else
+			{
+				// Etiqueta nova, como na versão série
+				st->nnew++;
+				st->parent[st->nnew] = st->nnew;
+				labels[pos] = st->nnew;
+			}
+		}
+	}
+}
+
+// Junta os acumuladores de src aos de dst
+static void vc_blob_acc_merge(VCBLOBACC *dst, const VCBLOBACC *src)
+{
+	if (src->area == 0)
+		return;
+
+	dst->area += src->area;
+	dst->sumx += src->sumx;
+	dst->sumy += src->sumy;
+	dst->sumxx += src->sumxx;
+	dst->sumyy += src->sumyy;
+	dst->sumxy += src->sumxy;
+	dst->xmin = MY_MIN(dst->xmin, src->xmin);
+	dst->ymin = MY_MIN(dst->ymin, src->ymin);
+	dst->xmax = MY_MAX(dst->xmax, src->xmax);
+	dst->ymax = MY_MAX(dst->ymax, src->ymax);
+}
+
+// Etiquetagem por faixas. Se acc != NULL (256 entradas, indexadas pela etiqueta), as
+// estatísticas de cada blob são acumuladas na mesma passagem em que a imagem é reescrita.
+static OVC *vc_blob_labelling_stripes(IVC *src, IVC *dst, int *nlabels, int nstripes, VCBLOBACC *acc)
+{
+	unsigned char *datadst;
+	int width, height, bytesperline;
+	int *labels = NULL, *parent = NULL;
+	VCSTRIPE *stripes = NULL;
+	VCBLOBACC *stripeacc = NULL;
+	int ntotal, npending, nids, rows;
+	int s, x, y, i, g, ok = 1;
+	long int pos, size;
+	OVC *blobs = NULL;
+
+	*nlabels = 0;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return NULL;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels))
+		return NULL;
+	if (src->channels != 1)
+		return NULL;
+
+	width = src->width;
+	height = src->height;
+	bytesperline = dst->bytesperline;
+	datadst = dst->data;
+	size = (long int)bytesperline * height;
+
+	// Copia, binariza (0 / 255) e limpa os rebordos, como a versão série
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			datadst[y * bytesperline + x] = (src->data[y * src->bytesperline + x] != 0) ? 255 : 0;
+	for (y = 0; y < height; y++)
+	{
+		datadst[y * bytesperline] = 0;
+		datadst[y * bytesperline + width - 1] = 0;
+	}
+	for (x = 0; x < width; x++)
+	{
+		datadst[x] = 0;
+		datadst[(height - 1) * bytesperline + x] = 0;
+	}
+
+	if ((width < 3) || (height < 3))
+		return NULL;
+
+	// Faixas sobre as linhas interiores [1, height - 1[
+	rows = height - 2;
+	if (nstripes <= 0)
+	{
+#ifdef _OPENMP
+		nstripes = omp_get_max_threads();
+#else
+		nstripes = 1;
+#endif
+	}
+	if (nstripes > rows)
+		nstripes = rows;
+
+	labels = (int *)malloc(size * sizeof(int));
+	stripes = (VCSTRIPE *)calloc(nstripes, sizeof(VCSTRIPE));
+	if ((labels == NULL) || (stripes == NULL))
+		ok = 0;
+
+	// Acumuladores de cada faixa, juntos no fim
+	if (ok && (acc != NULL))
+	{
+		stripeacc = (VCBLOBACC *)malloc(nstripes * 256 * sizeof(VCBLOBACC));
+		if (stripeacc == NULL)
+			ok = 0;
+	}
+
+	for (s = 0; ok && (s < nstripes); s++)
+	{
+		stripes[s].y0 = 1 + rows * s / nstripes;
+		stripes[s].y1 = 1 + rows * (s + 1) / nstripes;
+
+		// Etiquetas novas: no máximo 1 em cada bloco 2x2 (não podem ser vizinhas);
+		// pendentes: no máximo 1 em cada 2 pixéis da 1ª linha
+		stripes[s].capnew = ((width + 1) / 2) * ((stripes[s].y1 - stripes[s].y0 + 1) / 2);
+		stripes[s].parent = (int *)malloc((stripes[s].capnew + (width + 1) / 2 + 1) * sizeof(int));
+		if (stripes[s].parent == NULL)
+			ok = 0;
+	}
+
+	if (ok)
+	{
+		// Passo 1: etiquetagem de cada faixa
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (s = 0; s < nstripes; s++)
+			vc_stripe_label(datadst, labels, width, bytesperline, &stripes[s]);
+
+		// Numeração global: etiquetas novas de todas as faixas, seguidas das pendentes
+		ntotal = npending = 0;
+		for (s = 0; s < nstripes; s++)
+		{
+			stripes[s].offnew = ntotal;
+			stripes[s].offpending = npending;
+			ntotal += stripes[s].nnew;
+			npending += stripes[s].npending;
+		}
+		nids = ntotal + npending + 1;
+
+		// As etiquetas novas são as etiquetas provisórias da versão série: com mais de 254 a
+		// versão série devolve NULL, e esta também (as finais nunca passam de ntotal)
+		if (ntotal > 254)
+			ok = 0;
+		else if ((parent = (int *)malloc(nids * sizeof(int))) == NULL)
+			ok = 0;
+	}
+
+	if (ok)
+	{
+		// Passo 2: union-find global a partir das faixas
+		for (s = 0; s < nstripes; s++)
+		{
+			for (i = 1; i <= stripes[s].nnew; i++)
+				parent[vc_stripe_global(&stripes[s], i, ntotal)] = vc_stripe_global(&stripes[s], vc_uf_find(stripes[s].parent, i), ntotal);
+			for (i = stripes[s].capnew + 1; i <= stripes[s].capnew + stripes[s].npending; i++)
+				parent[vc_stripe_global(&stripes[s], i, ntotal)] = vc_stripe_global(&stripes[s], vc_uf_find(stripes[s].parent, i), ntotal);
+		}
+		parent[0] = 0;
+
+		// Passo 3: equivalências ao longo das fronteiras (1ª linha de cada faixa com a linha de cima)
+		for (s = 1; s < nstripes; s++)
+		{
+			y = stripes[s].y0;
+
+			for (x = 1; x < width - 1; x++)
+			{
+				pos = y * bytesperline + x;
+				if (labels[pos] == 0)
+					continue;
+
+				g = vc_stripe_global(&stripes[s], labels[pos], ntotal);
+
+				for (i = -1; i <= 1; i++)
+				{
+					if (labels[pos - bytesperline + i] != 0)
+						vc_uf_union(parent, g, vc_stripe_global(&stripes[s - 1], labels[pos - bytesperline + i], ntotal));
+				}
+			}
+		}
+
+		// Etiqueta final de cada etiqueta global (a menor etiqueta nova do blob)
+		for (i = 1; i < nids; i++)
+			parent[i] = vc_uf_find(parent, i);
+	}
+
+	if (ok)
+	{
+		// Passo 4: reescreve a imagem com as etiquetas finais
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (s = 0; s < nstripes; s++)
+		{
+			VCSTRIPE *st = &stripes[s];
+			VCBLOBACC *sacc = (stripeacc != NULL) ? &stripeacc[s * 256] : NULL;
+			unsigned char *row;
+			long int p;
+			int x0, x2, y2, v;
+
+			for (v = 0; (sacc != NULL) && (v < 256); v++)
+				vc_blob_acc_init(&sacc[v], width, height);
+
+			for (y2 = st->y0; y2 < st->y1; y2++)
+			{
+				for (x2 = 1; x2 < width - 1; x2++)
+				{
+					p = y2 * bytesperline + x2;
+					if (labels[p] != 0)
+						datadst[p] = (unsigned char)parent[vc_stripe_global(st, labels[p], ntotal)];
+				}
+
+				if (sacc == NULL)
+					continue;
+
+				// Estatísticas: runs de pixéis com a mesma etiqueta
+				row = &datadst[y2 * bytesperline];
+				for (x2 = 1; x2 < width - 1;)
+				{
+					v = row[x2];
+					if (v == 0)
+					{
+						x2++;
+						continue;
+					}
+
+					for (x0 = x2; (x2 < width - 1) && (row[x2] == v); x2++)
+						;
+					vc_blob_acc_add_run(&sacc[v], y2, x0, x2 - 1);
+				}
+			}
+		}
+
+		if (acc != NULL)
+		{
+			for (i = 0; i < 256; i++)
+			{
+				vc_blob_acc_init(&acc[i], width, height);
+				for (s = 0; s < nstripes; s++)
+					vc_blob_acc_merge(&acc[i], &stripeacc[s * 256 + i]);
+			}
+		}
+
+		// Lista de blobs por ordem crescente de etiqueta, como na versão série
+		for (i = 1; i <= ntotal; i++)
+			if (parent[i] == i)
+				(*nlabels)++;
+
+		if (*nlabels > 0)
+		{
+			blobs = (OVC *)calloc(*nlabels, sizeof(OVC));
+			if (blobs != NULL)
+			{
+				for (i = 1, g = 0; i <= ntotal; i++)
+					if (parent[i] == i)
+						blobs[g++].label = i;
+			}
+			else
+				*nlabels = 0;
+		}
+	}
+
+	for (s = 0; (stripes != NULL) && (s < nstripes); s++)
+		free(stripes[s].parent);
+	free(stripes);
+	free(stripeacc);
+	free(labels);
+	free(parent);
+
+	return blobs;
+}
+
+// Etiquetagem de blobs em paralelo (OpenMP), por nstripes faixas horizontais (<= 0: automático).
+// As etiquetas e os blobs são iguais aos de vc_binary_blob_labelling e as duas falham nos mesmos
+// casos: devolvem NULL se o varrimento série precisar de mais de 254 etiquetas provisórias (uma
+// por cada pixel sem vizinhos marcados acima nem à esquerda), mesmo que os blobs finais caibam.
+OVC *vc_binary_blob_labelling_parallel(IVC *src, IVC *dst, int *nlabels, int nstripes)
+{
+	return vc_blob_labelling_stripes(src, dst, nlabels, nstripes, NULL);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Filtragem e consulta de blobs
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Filtro sem restrições (todos os blobs passam)
+void vc_blob_filter_init(BLOBFILTERVC *filter)
+{
+	filter->minarea = 0;
+	filter->maxarea = 0;
+	filter->minaspect = 0.0f;
+	filter->maxaspect = 0.0f;
+	filter->minfill = 0.0f;
+	filter->maxfill = 0.0f;
+	filter->roi_x = 0;
+	filter->roi_y = 0;
+	filter->roi_width = 0;
+	filter->roi_height = 0;
+}
+
+// Verifica se um blob (com área, bounding box e centro de massa calculados) passa no filtro.
+// Não usa o perímetro, para poder ser avaliado antes de seguir o contorno.
+int vc_blob_filter_match(BLOBFILTERVC *filter, OVC *blob)
+{
+	float aspect, fill;
+
+	if (filter == NULL)
+		return 1;
+	if (blob->area <= 0)
+		return 0;
+
+	// Área
+	if (blob->area < filter->minarea)
+		return 0;
+	if ((filter->maxarea > 0) && (blob->area > filter->maxarea))
+		return 0;
+
+	// Proporção da bounding box (largura / altura)
+	aspect = (float)blob->width / (float)blob->height;
+	if (aspect < filter->minaspect)
+		return 0;
+	if ((filter->maxaspect > 0.0f) && (aspect > filter->maxaspect))
+		return 0;
+
+	// Preenchimento da bounding box (área / área da bounding box)
+	fill = (float)blob->area / ((float)blob->width * (float)blob->height);
+	if (fill < filter->minfill)
+		return 0;
+	if ((filter->maxfill > 0.0f) && (fill > filter->maxfill))
+		return 0;
+
+	// Centro de massa dentro da região de interesse
+	if ((filter->roi_width > 0) && (filter->roi_height > 0))
+	{
+		if ((blob->xc < filter->roi_x) || (blob->xc >= filter->roi_x + filter->roi_width))
+			return 0;
+		if ((blob->yc < filter->roi_y) || (blob->yc >= filter->roi_y + filter->roi_height))
+			return 0;
+	}
+
+	return 1;
+}
+
+// Remove do array os blobs que não passam no filtro, mantendo a ordem dos restantes.
+// Devolve o novo número de blobs.
+int vc_blob_filter(OVC *blobs, int nblobs, BLOBFILTERVC *filter)
+{
+	int i, n;
+
+	if (blobs == NULL)
+		return 0;
+
+	for (i = 0, n = 0; i < nblobs; i++)
+	{
+		if (vc_blob_filter_match(filter, &blobs[i]))
+			blobs[n++] = blobs[i];
+	}
+
+	return n;
+}
+
+// Etiquetagem com estatísticas e filtro na mesma passagem.
+// Equivale a vc_binary_blob_labelling + vc_binary_blob_info + vc_blob_filter, mas a área, a
+// bounding box e o centro de massa são acumulados ao reescrever as etiquetas (em vez de uma
+// passagem pela imagem por blob), o filtro é avaliado antes de seguir o contorno, e os blobs
+// rejeitados são apagados de dst (ficam a 0) sem chegarem a ser devolvidos. As etiquetas dos
+// blobs aceites são as mesmas de vc_binary_blob_labelling.
+// nlabels	: Número de blobs aceites
+OVC *vc_binary_blob_labelling_filtered(IVC *src, IVC *dst, int *nlabels, BLOBFILTERVC *filter)
+{
+	VCBLOBACC acc[256];
+	unsigned char lut[256];
+	unsigned char *row;
+	OVC *blobs;
+	int i, n, x, label;
+
+	blobs = vc_blob_labelling_stripes(src, dst, &n, 0, acc);
+	*nlabels = 0;
+	if (blobs == NULL)
+		return NULL;
+
+	vc_lut_identity(lut);
+
+	for (i = 0, *nlabels = 0; i < n; i++)
+	{
+		label = blobs[i].label;
+		vc_blob_acc_to_ovc(&acc[label], &blobs[*nlabels]);
+		blobs[*nlabels].label = label;
+
+		if (vc_blob_filter_match(filter, &blobs[*nlabels]))
+			(*nlabels)++;
+		else
+			lut[label] = 0;
+	}
+
+	if (*nlabels < n)
+		vc_lut_apply(dst, dst, lut);
+
+	if (*nlabels == 0)
+	{
+		free(blobs);
+		return NULL;
+	}
+
+	// Perímetro, só dos blobs aceites (o contorno começa no 1º pixel do blob em ordem raster)
+	for (i = 0; i < *nlabels; i++)
+	{
+		row = &dst->data[blobs[i].y * dst->bytesperline];
+		for (x = blobs[i].x; row[x] != blobs[i].label; x++)
+			;
+		blobs[i].perimeter = (int)(vc_contour_trace(dst, blobs[i].label, x, blobs[i].y, NULL) + 0.5f);
+	}
+
+	return blobs;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Etiquetagem incremental (vídeo)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Entre frames consecutivas só são re-etiquetados os blocos (tiles) que mudaram. A região
+// re-etiquetada é fechada em relação aos componentes da frame anterior: se um componente
+// toca num bloco alterado, todos os blocos da sua bounding box entram na região. Assim, cada
+// componente antigo fica inteiramente dentro ou inteiramente fora da região; os de fora não
+// mudaram e mantêm a etiqueta e as estatísticas. Os componentes novos da região que tocam num
+// componente de fora juntam-se a ele (se tocarem em vários, estes são fundidos na menor
+// etiqueta). Os restantes reaproveitam a etiqueta antiga do seu 1º pixel, se estiver livre.
+// Vizinhança-8, sobre toda a imagem (os rebordos não são apagados), como vc_rle_labelling.
+
+#define VC_CCL_FREE		0	// Etiqueta livre
+#define VC_CCL_ALIVE	1	// Etiqueta de um componente
+#define VC_CCL_STALE	2	// Componente antigo dentro da região a re-etiquetar
+
+CCLVC *vc_ccl_new(int width, int height, int tilesize)
+{
+	CCLVC *ccl;
+	long int size = (long int)width * height;
+
+	if ((width <= 0) || (height <= 0) || (tilesize <= 0))
+		return NULL;
+
+	ccl = (CCLVC *)calloc(1, sizeof(CCLVC));
+	if (ccl == NULL)
+		return NULL;
+
+	// Lado dos blocos arredondado a uma potência de 2
+	for (ccl->tileshift = 0; (1 << ccl->tileshift) < tilesize; ccl->tileshift++)
+		;
+	ccl->tilesize = 1 << ccl->tileshift;
+	ccl->tilesx = (width + ccl->tilesize - 1) >> ccl->tileshift;
+	ccl->tilesy = (height + ccl->tilesize - 1) >> ccl->tileshift;
+	ccl->width = width;
+	ccl->height = height;
+	ccl->nids = 1;
+
+	ccl->mask = (unsigned char *)calloc(size, sizeof(unsigned char));
+	ccl->labels = (int *)calloc(size, sizeof(int));
+	ccl->work = (int *)malloc(size * sizeof(int));
+	ccl->region = (unsigned char *)malloc(ccl->tilesx * ccl->tilesy * sizeof(unsigned char));
+	ccl->queue = (int *)malloc(ccl->tilesx * ccl->tilesy * sizeof(int));
+
+	if ((ccl->mask == NULL) || (ccl->labels == NULL) || (ccl->work == NULL) || (ccl->region == NULL) || (ccl->queue == NULL))
+		return vc_ccl_free(ccl);
+
+	return ccl;
+}
+
+CCLVC *vc_ccl_free(CCLVC *ccl)
+{
+	if (ccl != NULL)
+	{
+		free(ccl->mask);
+		free(ccl->labels);
+		free(ccl->work);
+		free(ccl->region);
+		free(ccl->queue);
+		free(ccl->stats);
+		free(ccl->state);
+		free(ccl->freeids);
+		free(ccl->parent);
+		free(ccl);
+	}
+
+	return NULL;
+}
+
+// Garante espaço para pelo menos n etiquetas
+static int vc_ccl_reserve(CCLVC *ccl, int n)
+{
+	VCBLOBACC *stats;
+	unsigned char *state;
+	int *freeids;
+	int capacity;
+
+	if (n <= ccl->capacity)
+		return 1;
+
+	capacity = MY_MAX(n, 2 * ccl->capacity);
+	capacity = MY_MAX(capacity, 64);
+
+	stats = (VCBLOBACC *)realloc(ccl->stats, capacity * sizeof(VCBLOBACC));
+	if (stats == NULL)
+		return 0;
+	ccl->stats = stats;
+
+	state = (unsigned char *)realloc(ccl->state, capacity * sizeof(unsigned char));
+	if (state == NULL)
+		return 0;
+	memset(&state[ccl->capacity], VC_CCL_FREE, capacity - ccl->capacity);
+	ccl->state = state;
+
+	freeids = (int *)realloc(ccl->freeids, capacity * sizeof(int));
+	if (freeids == NULL)
+		return 0;
+	ccl->freeids = freeids;
+
+	ccl->capacity = capacity;
+
+	return 1;
+}
+
+// Nova etiqueta: a última libertada, ou a seguir à maior usada
+static int vc_ccl_alloc(CCLVC *ccl)
+{
+	int id;
+
+	if (ccl->nfree > 0)
+		id = ccl->freeids[--ccl->nfree];
+	else
+	{
+		if (!vc_ccl_reserve(ccl, ccl->nids + 1))
+			return 0;
+		id = ccl->nids++;
+	}
+
+	ccl->state[id] = VC_CCL_ALIVE;
+	vc_blob_acc_init(&ccl->stats[id], ccl->width, ccl->height);
+	ccl->nblobs++;
+
+	return id;
+}
+
+static void vc_ccl_release(CCLVC *ccl, int id)
+{
+	ccl->state[id] = VC_CCL_FREE;
+	ccl->freeids[ccl->nfree++] = id;
+	ccl->nblobs--;
+}
+
+// Pixel (x, y) dentro da região a re-etiquetar
+static __inline int vc_ccl_in_region(CCLVC *ccl, int x, int y)
+{
+	return ccl->region[(y >> ccl->tileshift) * ccl->tilesx + (x >> ccl->tileshift)];
+}
+
+// Marca os blocos alterados: dirty[tilesy * tilesx] = 1 se algum pixel do bloco passou de
+// fundo a objecto ou vice-versa em relação à última frame. Devolve o número de blocos alterados.
+int vc_ccl_dirty_tiles(CCLVC *ccl, IVC *src, unsigned char *dirty)
+{
+	int tx, ty, x, y, x1, y1, n = 0;
+	const unsigned char *ps, *pm;
+
+	// Verificação de erros
+	if ((ccl == NULL) || (src == NULL) || (src->data == NULL) || (dirty == NULL))
+		return 0;
+	if ((src->width != ccl->width) || (src->height != ccl->height) || (src->channels != 1))
+		return 0;
+
+	for (ty = 0; ty < ccl->tilesy; ty++)
+	{
+		y1 = MY_MIN((ty + 1) << ccl->tileshift, ccl->height);
+
+		for (tx = 0; tx < ccl->tilesx; tx++)
+		{
+			x1 = MY_MIN((tx + 1) << ccl->tileshift, ccl->width);
+			dirty[ty * ccl->tilesx + tx] = 0;
+
+			for (y = ty << ccl->tileshift; y < y1; y++)
+			{
+				ps = &src->data[y * src->bytesperline];
+				pm = &ccl->mask[y * ccl->width];
+
+				for (x = tx << ccl->tileshift; x < x1; x++)
+				{
+					if ((ps[x] != 0) != pm[x])
+						break;
+				}
+				if (x < x1)
+				{
+					dirty[ty * ccl->tilesx + tx] = 1;
+					n++;
+					break;
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+// Fecha a região: junta os blocos da bounding box de cada componente antigo que a toca
+static void vc_ccl_close_region(CCLVC *ccl)
+{
+	int nqueue = 0, t, tx, ty, x, y, x1, y1, id;
+	int tx0, tx1, ty0, ty1, i, j;
+	VCBLOBACC *st;
+
+	for (t = 0; t < ccl->tilesx * ccl->tilesy; t++)
+		if (ccl->region[t])
+			ccl->queue[nqueue++] = t;
+
+	while (nqueue > 0)
+	{
+		t = ccl->queue[--nqueue];
+		tx = t % ccl->tilesx;
+		ty = t / ccl->tilesx;
+		x1 = MY_MIN((tx + 1) << ccl->tileshift, ccl->width);
+		y1 = MY_MIN((ty + 1) << ccl->tileshift, ccl->height);
+
+		for (y = ty << ccl->tileshift; y < y1; y++)
+		{
+			for (x = tx << ccl->tileshift; x < x1; x++)
+			{
+				id = ccl->labels[y * ccl->width + x];
+				if ((id == 0) || (ccl->state[id] != VC_CCL_ALIVE))
+					continue;
+
+				ccl->state[id] = VC_CCL_STALE;
+				st = &ccl->stats[id];
+
+				tx0 = st->xmin >> ccl->tileshift;
+				tx1 = st->xmax >> ccl->tileshift;
+				ty0 = st->ymin >> ccl->tileshift;
+				ty1 = st->ymax >> ccl->tileshift;
+
+				for (j = ty0; j <= ty1; j++)
+				{
+					for (i = tx0; i <= tx1; i++)
+					{
+						if (!ccl->region[j * ccl->tilesx + i])
+						{
+							ccl->region[j * ccl->tilesx + i] = 1;
+							ccl->queue[nqueue++] = j * ccl->tilesx + i;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// Actualiza a etiquetagem com uma nova frame binária (1 canal, 0 = fundo).
+// dirty	: Blocos alterados (tilesy * tilesx), como os de vc_ccl_dirty_tiles. Os blocos não
+//			  marcados são considerados iguais aos da frame anterior. Se for NULL, os blocos
+//			  alterados são calculados. Na 1ª frame a imagem é toda etiquetada.
+int vc_ccl_update(CCLVC *ccl, IVC *src, unsigned char *dirty)
+{
+	int width, height, tiles, mask;
+	int x, y, tx, ty, x0, x1, y1, i, k;
+	int nclean, nprov, provcapacity, id, r;
+	int nb[8], inside[8];
+	long int pos;
+	int *parent, *assign;
+	VCBLOBACC *st;
+	const int dx[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+	const int dy[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+	// Verificação de erros
+	if ((ccl == NULL) || (src == NULL) || (src->data == NULL))
+		return 0;
+	if ((src->width != ccl->width) || (src->height != ccl->height) || (src->channels != 1))
+		return 0;
+
+	width = ccl->width;
+	height = ccl->height;
+	tiles = ccl->tilesx * ccl->tilesy;
+	mask = ccl->tilesize - 1;
+
+	// Região a re-etiquetar
+	if (ccl->frame == 0)
+		memset(ccl->region, 1, tiles);
+	else if (dirty != NULL)
+		memcpy(ccl->region, dirty, tiles);
+	else
+		vc_ccl_dirty_tiles(ccl, src, ccl->region);
+	ccl->frame++;
+
+	vc_ccl_close_region(ccl);
+
+	// Union-find: etiquetas actuais [0, nclean[, seguidas das provisórias da região. A união
+	// mantém a menor raiz, por isso um componente novo ligado a um antigo fica com a etiqueta deste.
+	nclean = ccl->nids;
+	provcapacity = ((width + 1) / 2) * ((height + 1) / 2) + 1;
+	if (ccl->parentcapacity < nclean + provcapacity)
+	{
+		parent = (int *)realloc(ccl->parent, (nclean + provcapacity) * sizeof(int));
+		if (parent == NULL)
+			return 0;
+		ccl->parent = parent;
+		ccl->parentcapacity = nclean + provcapacity;
+	}
+	parent = ccl->parent;
+	for (i = 0; i < nclean; i++)
+		parent[i] = i;
+	nprov = 0;
+	ccl->relabelled = 0;
+
+	// Passo 1: etiquetas provisórias na região (ordem raster restrita aos blocos da região)
+	for (ty = 0; ty < ccl->tilesy; ty++)
+	{
+		y1 = MY_MIN((ty + 1) << ccl->tileshift, height);
+
+		for (y = ty << ccl->tileshift; y < y1; y++)
+		{
+			for (tx = 0; tx < ccl->tilesx; tx++)
+			{
+				if (!ccl->region[ty * ccl->tilesx + tx])
+					continue;
+
+				x1 = MY_MIN((tx + 1) << ccl->tileshift, width);
+
+				for (x = tx << ccl->tileshift; x < x1; x++)
+				{
+					pos = y * width + x;
+					ccl->mask[pos] = (src->data[y * src->bytesperline + x] != 0);
+					ccl->work[pos] = 0;
+					ccl->relabelled++;
+
+					if (!ccl->mask[pos])
+						continue;
+
+					// Vizinhos: A B C / D X E / F G H. Na região contam A, B, C e D (já
+					// percorridos); fora da região conta qualquer vizinho de primeiro plano.
+					for (k = 0; k < 8; k++)
+					{
+						int xx = x + dx[k], yy = y + dy[k];
+
+						inside[k] = 0;
+						nb[k] = 0;
+						if ((xx < 0) || (xx >= width) || (yy < 0) || (yy >= height))
+							continue;
+
+						// Fora do rebordo do bloco os vizinhos estão no mesmo bloco
+						if (((x & mask) != 0) && ((x & mask) != mask) && ((y & mask) != 0) && ((y & mask) != mask))
+							inside[k] = 1;
+						else
+							inside[k] = vc_ccl_in_region(ccl, xx, yy);
+
+						if (inside[k])
+						{
+							if (k < 4)
+								nb[k] = ccl->work[yy * width + xx];
+						}
+						else if (ccl->mask[yy * width + xx])
+							nb[k] = ccl->labels[yy * width + xx];
+					}
+
+					// Etiqueta do 1º vizinho da região, ou uma provisória nova
+					for (k = 0, id = 0; (k < 4) && (id == 0); k++)
+						if (inside[k] && (nb[k] != 0))
+							id = nclean + nb[k] - 1;
+					if (id == 0)
+					{
+						id = nclean + nprov;
+						parent[id] = id;
+						nprov++;
+					}
+
+					for (k = 0; k < 8; k++)
+						if (nb[k] != 0)
+							vc_uf_union(parent, id, inside[k] ? nclean + nb[k] - 1 : nb[k]);
+
+					ccl->work[pos] = id - nclean + 1;
+				}
+			}
+		}
+	}
+
+	// Passo 2: componentes antigos de fora da região que foram ligados entre si são fundidos
+	// na menor etiqueta (reescreve-se só a bounding box dos que desaparecem)
+	for (i = 1; i < nclean; i++)
+	{
+		if (ccl->state[i] != VC_CCL_ALIVE)
+			continue;
+
+		r = vc_uf_find(parent, i);
+		if (r == i)
+			continue;
+
+		st = &ccl->stats[i];
+		for (y = st->ymin; y <= st->ymax; y++)
+			for (x = st->xmin; x <= st->xmax; x++)
+				if (ccl->labels[y * width + x] == i)
+					ccl->labels[y * width + x] = r;
+
+		vc_blob_acc_merge(&ccl->stats[r], st);
+		vc_ccl_release(ccl, i);
+	}
+
+	// Passo 3: etiquetas finais da região. Um componente ligado a um antigo fica com a
+	// etiqueta deste; os outros reaproveitam a etiqueta antiga do seu 1º pixel, se livre.
+	assign = (nprov > 0) ? (int *)calloc(nprov, sizeof(int)) : NULL;
+	if ((nprov > 0) && (assign == NULL))
+		return 0;
+
+	for (ty = 0; ty < ccl->tilesy; ty++)
+	{
+		y1 = MY_MIN((ty + 1) << ccl->tileshift, height);
+
+		for (y = ty << ccl->tileshift; y < y1; y++)
+		{
+			for (tx = 0; tx < ccl->tilesx; tx++)
+			{
+				if (!ccl->region[ty * ccl->tilesx + tx])
+					continue;
+
+				x1 = MY_MIN((tx + 1) << ccl->tileshift, width);
+
+				for (x = tx << ccl->tileshift; x < x1;)
+				{
+					pos = y * width + x;
+					if (ccl->work[pos] == 0)
+					{
+						ccl->labels[pos] = 0;
+						x++;
+						continue;
+					}
+
+					r = vc_uf_find(parent, nclean + ccl->work[pos] - 1);
+					if (r < nclean)
+						id = r;
+					else if (assign[r - nclean] != 0)
+						id = assign[r - nclean];
+					else
+					{
+						id = ccl->labels[pos];
+						if ((id > 0) && (id < nclean) && (ccl->state[id] == VC_CCL_STALE))
+						{
+							ccl->state[id] = VC_CCL_ALIVE;
+							vc_blob_acc_init(&ccl->stats[id], width, height);
+						}
+						else
+						{
+							id = vc_ccl_alloc(ccl);
+							if (id == 0)
+							{
+								free(assign);
+								return 0;
+							}
+						}
+						assign[r - nclean] = id;
+					}
+
+					// Run de pixéis do mesmo componente até ao fim do bloco
+					for (x0 = x; (x < x1) && (ccl->work[y * width + x] != 0) && (vc_uf_find(parent, nclean + ccl->work[y * width + x] - 1) == r); x++)
+						ccl->labels[y * width + x] = id;
+					vc_blob_acc_add_run(&ccl->stats[id], y, x0, x - 1);
+				}
+			}
+		}
+	}
+
+	free(assign);
+
+	// Componentes antigos da região que não foram reaproveitados
+	for (i = 1; i < nclean; i++)
+		if (ccl->state[i] == VC_CCL_STALE)
+			vc_ccl_release(ccl, i);
+
+	return 1;
+}
+
+// Lista de blobs (área, bounding box e centro de massa; perímetro a 0), por ordem de etiqueta.
+// Não percorre a imagem: o custo depende só do número de etiquetas.
+OVC *vc_ccl_blobs(CCLVC *ccl, int *nblobs)
+{
+	OVC *blobs;
+	int i, n;
+
+	*nblobs = 0;
+	if ((ccl == NULL) || (ccl->nblobs <= 0))
+		return NULL;
+
+	blobs = (OVC *)calloc(ccl->nblobs, sizeof(OVC));
+	if (blobs == NULL)
+		return NULL;
+
+	for (i = 1, n = 0; i < ccl->nids; i++)
+	{
+		if (ccl->state[i] != VC_CCL_ALIVE)
+			continue;
+
+		vc_blob_acc_to_ovc(&ccl->stats[i], &blobs[n]);
+		blobs[n].label = i;
+		n++;
+	}
+
+	*nblobs = n;
+
+	return blobs;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Contornos e descritores de forma
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Vizinhança-8 no sentido horário (com y a crescer para baixo):
+// 5 6 7
+// 4 X 0
+// 3 2 1
+static const int vc_contour_dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int vc_contour_dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// Segue o contorno exterior (Moore) do blob com etiqueta 'label', a partir do seu primeiro
+// pixel em ordem raster (xstart, ystart). O custo é proporcional ao comprimento do contorno.
+// Se contour != NULL, os pontos são guardados por ordem. Devolve o comprimento do contorno,
+// ou -1 em caso de erro de memória.
+static float vc_contour_trace(IVC *src, int label, int xstart, int ystart, CONTOURVC *contour)
+{
+	unsigned char *data = (unsigned char *)src->data;
+	int width = src->width;
+	int height = src->height;
+	int bytesperline = src->bytesperline;
+	int channels = src->channels;
+	int x = xstart, y = ystart;
+	int dir = 6; // Como se tivesse chegado a subir: a procura começa à esquerda (W)
+	int firstdir = -1;
+	int d, k, nx, ny;
+	long int steps = 0, maxsteps = 8L * width * height + 8;
+	int straight = 0, diagonal = 0;
+	POINTVC *points;
+
+	if (contour != NULL)
+	{
+		contour->npoints = 0;
+		if (contour->capacity < 1)
+			return -1.0f;
+		contour->points[contour->npoints].x = x;
+		contour->points[contour->npoints].y = y;
+		contour->npoints++;
+	}
+
+	while (steps++ < maxsteps)
+	{
+		// Procura, no sentido horário, o próximo pixel do blob, começando no vizinho seguinte
+		// ao pixel de fundo por onde se entrou
+		for (k = 0; k < 8; k++)
+		{
+			d = (dir + 6 + k) % 8;
+			nx = x + vc_contour_dx[d];
+			ny = y + vc_contour_dy[d];
+
+			if ((nx >= 0) && (nx < width) && (ny >= 0) && (ny < height) && (data[ny * bytesperline + nx * channels] == label))
+				break;
+		}
+
+		// Pixel isolado
+		if (k == 8)
+			break;
+
+		// Critério de paragem de Jacob: voltar ao início a sair na mesma direcção
+		if ((x == xstart) && (y == ystart) && (d == firstdir))
+			break;
+		if (firstdir < 0)
+			firstdir = d;
+
+		if (d & 1)
+			diagonal++;
+		else
+			straight++;
+
+		x = nx;
+		y = ny;
+		dir = d;
+
+		if (contour != NULL)
+		{
+			if (contour->npoints == contour->capacity)
+			{
+				points = (POINTVC *)realloc(contour->points, 2 * contour->capacity * sizeof(POINTVC));
+				if (points == NULL)
+					return -1.0f;
+				contour->points = points;
+				contour->capacity *= 2;
+			}
+			contour->points[contour->npoints].x = x;
+			contour->points[contour->npoints].y = y;
+			contour->npoints++;
+		}
+	}
+
+	// O último ponto guardado é o regresso ao ponto inicial
+	if ((contour != NULL) && (contour->npoints > 1))
+		contour->npoints--;
+
+	return (float)straight + (float)diagonal * 1.41421356f;
+}
+
+// Produto externo (a - o) x (b - o)
+static __inline long long vc_cross(POINTVC o, POINTVC a, POINTVC b)
+{
+	return (long long)(a.x - o.x) * (b.y - o.y) - (long long)(a.y - o.y) * (b.x - o.x);
+}
+
+// Invólucro convexo (cadeia monótona de Andrew). Os vértices do invólucro estão entre os
+// pontos mais à esquerda e mais à direita de cada linha do contorno, que já saem ordenados
+// por (y, x) sem ser necessário ordenar: custo O(npoints + altura).
+static int vc_contour_hull(CONTOURVC *contour, OVC *blob)
+{
+	int *xmin, *xmax;
+	POINTVC *pts, *hull;
+	int i, n = 0, h = 0, lower;
+	int height = blob->height;
+
+	xmin = (int *)malloc(height * sizeof(int));
+	xmax = (int *)malloc(height * sizeof(int));
+	pts = (POINTVC *)malloc(2 * height * sizeof(POINTVC));
+	hull = (POINTVC *)realloc(contour->hull, (2 * height + 1) * sizeof(POINTVC));
+	if ((xmin == NULL) || (xmax == NULL) || (pts == NULL) || (hull == NULL))
+	{
+		free(xmin);
+		free(xmax);
+		free(pts);
+		if (hull != NULL)
+			contour->hull = hull;
+		return 0;
+	}
+	contour->hull = hull;
+
+	for (i = 0; i < height; i++)
+	{
+		xmin[i] = blob->x + blob->width;
+		xmax[i] = blob->x - 1;
+	}
+	for (i = 0; i < contour->npoints; i++)
+	{
+		int r = contour->points[i].y - blob->y;
+
+		if ((r < 0) || (r >= height))
+			continue;
+		if (contour->points[i].x < xmin[r])
+			xmin[r] = contour->points[i].x;
+		if (contour->points[i].x > xmax[r])
+			xmax[r] = contour->points[i].x;
+	}
+	for (i = 0; i < height; i++)
+	{
+		if (xmin[i] > xmax[i])
+			continue;
+		pts[n].x = xmin[i];
+		pts[n].y = blob->y + i;
+		n++;
+		if (xmax[i] != xmin[i])
+		{
+			pts[n].x = xmax[i];
+			pts[n].y = blob->y + i;
+			n++;
+		}
+	}
+
+	if (n < 3)
+	{
+		for (i = 0; i < n; i++)
+			hull[i] = pts[i];
+		h = n;
+	}
+	else
+	{
+		// Cadeia inferior
+		for (i = 0; i < n; i++)
+		{
+			while ((h >= 2) && (vc_cross(hull[h - 2], hull[h - 1], pts[i]) <= 0))
+				h--;
+			hull[h++] = pts[i];
+		}
+		// Cadeia superior
+		for (i = n - 2, lower = h + 1; i >= 0; i--)
+		{
+			while ((h >= lower) && (vc_cross(hull[h - 2], hull[h - 1], pts[i]) <= 0))
+				h--;
+			hull[h++] = pts[i];
+		}
+		h--; // O último ponto repete o primeiro
+	}
+	contour->nhull = h;
+
+	// Área do invólucro (fórmula de Gauss)
+	contour->hull_area = 0.0f;
+	if (h >= 3)
+	{
+		long long a = 0;
+
+		for (i = 0; i < h; i++)
+			a += (long long)hull[i].x * hull[(i + 1) % h].y - (long long)hull[(i + 1) % h].x * hull[i].y;
+		contour->hull_area = (float)(a < 0 ? -a : a) / 2.0f;
+	}
+
+	free(xmin);
+	free(xmax);
+	free(pts);
+
+	return 1;
+}
+
+// Normaliza um ângulo em graus para [0, 180[
+static float vc_angle_normalize(float angle)
+{
+	while (angle < 0.0f)
+		angle += 180.0f;
+	while (angle >= 180.0f)
+		angle -= 180.0f;
+
+	return angle;
+}
+
+// Rectângulo de área mínima pelo método dos "rotating calipers" sobre o invólucro convexo:
+// um dos lados do rectângulo óptimo é colinear com uma aresta do invólucro. As dimensões são
+// medidas entre centros de pixéis.
+static void vc_contour_min_rect(CONTOURVC *contour)
+{
+	POINTVC *p = contour->hull;
+	int h = contour->nhull;
+	int i, r = 1, t = 1, l = 1;
+	double ux, uy, len, a, b, best = -1.0;
+	double pr, pl, pt;
+
+	contour->rect_cx = contour->rect_cy = 0.0f;
+	contour->rect_length = contour->rect_width = contour->rect_angle = 0.0f;
+
+	if (h == 0)
+		return;
+	if (h == 1)
+	{
+		contour->rect_cx = (float)p[0].x;
+		contour->rect_cy = (float)p[0].y;
+		return;
+	}
+	if (h == 2)
+	{
+		contour->rect_cx = (float)(p[0].x + p[1].x) / 2.0f;
+		contour->rect_cy = (float)(p[0].y + p[1].y) / 2.0f;
+		contour->rect_length = (float)sqrt((double)(p[1].x - p[0].x) * (p[1].x - p[0].x) + (double)(p[1].y - p[0].y) * (p[1].y - p[0].y));
+		contour->rect_angle = vc_angle_normalize((float)(atan2(p[1].y - p[0].y, p[1].x - p[0].x) * 180.0 / 3.14159265358979));
+		return;
+	}
+
+#define VC_DOT(k, vx, vy) ((p[(k) % h].x - p[i].x) * (vx) + (p[(k) % h].y - p[i].y) * (vy))
+
+	for (i = 0; i < h; i++)
+	{
+		ux = p[(i + 1) % h].x - p[i].x;
+		uy = p[(i + 1) % h].y - p[i].y;
+		len = sqrt(ux * ux + uy * uy);
+		if (len == 0.0)
+			continue;
+		ux /= len;
+		uy /= len;
+
+		// Os três calibres avançam sempre no mesmo sentido (custo total O(h))
+		if (i == 0)
+		{
+			r = 1;
+			while (VC_DOT(r + 1, ux, uy) > VC_DOT(r, ux, uy))
+				r++;
+			t = r;
+			while (VC_DOT(t + 1, -uy, ux) > VC_DOT(t, -uy, ux))
+				t++;
+			l = t;
+			while (VC_DOT(l + 1, ux, uy) < VC_DOT(l, ux, uy))
+				l++;
+		}
+		else
+		{
+			while (VC_DOT(r + 1, ux, uy) > VC_DOT(r, ux, uy))
+				r++;
+			while (VC_DOT(t + 1, -uy, ux) > VC_DOT(t, -uy, ux))
+				t++;
+			while (VC_DOT(l + 1, ux, uy) < VC_DOT(l, ux, uy))
+				l++;
+		}
+
+		pr = VC_DOT(r, ux, uy);
+		pl = VC_DOT(l, ux, uy);
+		pt = VC_DOT(t, -uy, ux);
+
+		// Normal (-uy, ux) aponta para o interior se o invólucro estiver no sentido positivo
+		if (pt < 0)
+			pt = -pt;
+
+		a = (pr - pl) * pt;
+		if ((best < 0.0) || (a < best))
+		{
+			best = a;
+			a = pr - pl;
+			b = pt;
+			contour->rect_cx = (float)(p[i].x + ux * (pr + pl) / 2.0 - uy * VC_DOT(t, -uy, ux) / 2.0);
+			contour->rect_cy = (float)(p[i].y + uy * (pr + pl) / 2.0 + ux * VC_DOT(t, -uy, ux) / 2.0);
+			if (a >= b)
+			{
+				contour->rect_length = (float)a;
+				contour->rect_width = (float)b;
+				contour->rect_angle = vc_angle_normalize((float)(atan2(uy, ux) * 180.0 / 3.14159265358979));
+			}
+			else
+			{
+				contour->rect_length = (float)b;
+				contour->rect_width = (float)a;
+				contour->rect_angle = vc_angle_normalize((float)(atan2(uy, ux) * 180.0 / 3.14159265358979) + 90.0f);
+			}
+		}
+	}
+
+#undef VC_DOT
+}
+
+// Orientação do eixo maior a partir dos momentos de 2ª ordem do polígono do contorno
+// (teorema de Green: só percorre os pontos do contorno)
+static void vc_contour_orientation(CONTOURVC *contour)
+{
+	POINTVC *p = contour->points;
+	int n = contour->npoints;
+	int i, j;
+	double a, area = 0.0, cx = 0.0, cy = 0.0, m20 = 0.0, m02 = 0.0, m11 = 0.0;
+	double mu20, mu02, mu11;
+
+	for (i = 0; i < n; i++)
+	{
+		j = (i + 1) % n;
+		a = (double)p[i].x * p[j].y - (double)p[j].x * p[i].y;
+
+		area += a;
+		cx += (double)(p[i].x + p[j].x) * a;
+		cy += (double)(p[i].y + p[j].y) * a;
+		m20 += ((double)p[i].x * p[i].x + (double)p[i].x * p[j].x + (double)p[j].x * p[j].x) * a;
+		m02 += ((double)p[i].y * p[i].y + (double)p[i].y * p[j].y + (double)p[j].y * p[j].y) * a;
+		m11 += ((double)p[i].x * p[j].y + 2.0 * p[i].x * p[i].y + 2.0 * p[j].x * p[j].y + (double)p[j].x * p[i].y) * a;
+	}
+
+	area /= 2.0;
+
+	// Contornos sem área (linhas com 1 pixel de largura): usa o rectângulo mínimo
+	if ((area < 1.0) && (area > -1.0))
+	{
+		contour->angle = contour->rect_angle;
+		return;
+	}
+
+	cx /= 6.0 * area;
+	cy /= 6.0 * area;
+	m20 /= 12.0;
+	m02 /= 12.0;
+	m11 /= 24.0;
+
+	// O sentido de percurso troca o sinal de todos os momentos
+	if (area < 0.0)
+	{
+		area = -area;
+		m20 = -m20;
+		m02 = -m02;
+		m11 = -m11;
+	}
+
+	mu20 = m20 - area * cx * cx;
+	mu02 = m02 - area * cy * cy;
+	mu11 = m11 - area * cx * cy;
+
+	contour->angle = vc_angle_normalize((float)(0.5 * atan2(2.0 * mu11, mu20 - mu02) * 180.0 / 3.14159265358979));
+}
+
+// Alocar memória para um contorno
+CONTOURVC *vc_contour_new(void)
+{
+	CONTOURVC *contour = (CONTOURVC *)calloc(1, sizeof(CONTOURVC));
+
+	if (contour == NULL)
+		return NULL;
+
+	contour->capacity = 256;
+	contour->points = (POINTVC *)malloc(contour->capacity * sizeof(POINTVC));
+	if (contour->points == NULL)
+		return vc_contour_free(contour);
+
+	return contour;
+}
+
+// Libertar memória de um contorno
+CONTOURVC *vc_contour_free(CONTOURVC *contour)
+{
+	if (contour != NULL)
+	{
+		if (contour->points != NULL)
+			free(contour->points);
+		if (contour->hull != NULL)
+			free(contour->hull);
+
+		free(contour);
+		contour = NULL;
+	}
+
+	return contour;
+}
+
+// Extrai o contorno exterior de um blob e calcula os descritores de forma
+// src		: Imagem de etiquetas (1 canal), como a produzida por vc_binary_blob_labelling
+// blob		: Blob com a bounding box já calculada (vc_binary_blob_info ou vc_rle_blob_info)
+// contour	: Contorno de saída (pontos, invólucro convexo, perímetro, orientação e rectângulo mínimo)
+// O perímetro do blob é actualizado. O custo depende apenas do comprimento do contorno.
+int vc_binary_blob_contour(IVC *src, OVC *blob, CONTOURVC *contour)
+{
+	unsigned char *data = (unsigned char *)src->data;
+	int x, pos;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if (src->channels != 1)
+		return 0;
+	if ((blob == NULL) || (contour == NULL) || (blob->area <= 0))
+		return 0;
+	if ((blob->y < 0) || (blob->y >= src->height) || (blob->x < 0) || (blob->x + blob->width > src->width))
+		return 0;
+
+	// O primeiro pixel do blob em ordem raster está na linha de topo da bounding box
+	pos = blob->y * src->bytesperline;
+	for (x = blob->x; x < blob->x + blob->width; x++)
+	{
+		if (data[pos + x * src->channels] == blob->label)
+			break;
+	}
+	if (x == blob->x + blob->width)
+		return 0;
+
+	contour->perimeter = vc_contour_trace(src, blob->label, x, blob->y, contour);
+	if (contour->perimeter < 0.0f)
+		return 0;
+
+	blob->perimeter = (int)(contour->perimeter + 0.5f);
+
+	if (!vc_contour_hull(contour, blob))
+		return 0;
+
+	vc_contour_min_rect(contour);
+	vc_contour_orientation(contour);
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Processamento linha a linha (streaming)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Uma cadeia de estágios processa a imagem linha a linha: cada linha de entrada atravessa
+// todos os estágios logo que estes têm a vizinhança necessária, pelo que só é preciso
+// guardar (2 * raio + 1) linhas por estágio em vez de uma imagem intermédia completa.
+// A saída pode ser uma imagem e/ou um RLE, sobre o qual se faz depois a etiquetagem
+// (vc_rle_labelling).
+
+// Calcula a linha de saída de um estágio a partir das linhas em stage->window
+static void vc_stage_row(STAGEVC *stage, int width)
+{
+	unsigned char *in = stage->window[stage->radius];
+	unsigned char *out = stage->out;
+	unsigned char *tmp = stage->tmp;
+	unsigned char hsv[3];
+	int r = stage->radius;
+	int x, k, count;
+
+	switch (stage->type)
+	{
+	case VC_STAGE_RGB_TO_GRAY:
+		vc_gray_row(in, out, width, 3, VC_GRAY_WR, VC_GRAY_WG, VC_GRAY_WB);
+		break;
+
+	case VC_STAGE_HSV_SEGMENTATION:
+		for (x = 0; x < width; x++)
+		{
+			vc_rgb_pixel_to_hsv((float)in[x * 3], (float)in[x * 3 + 1], (float)in[x * 3 + 2], hsv);
+			out[x] = vc_hsv_pixel_in_range(hsv, stage->param[0], stage->param[1], stage->param[2],
+										   stage->param[3], stage->param[4], stage->param[5]) ? 255 : 0;
+		}
+		break;
+
+	case VC_STAGE_GRAY_TO_BINARY:
+		for (x = 0; x < width; x++)
+			out[x] = (in[x] > stage->param[0]) ? 255 : 0;
+		break;
+
+	case VC_STAGE_GRAY_NEGATIVE:
+		for (x = 0; x < width; x++)
+			out[x] = 255 - in[x];
+		break;
+
+	case VC_STAGE_BINARY_DILATE:
+		// Vertical: coluna a 255 se algum pixel da vizinhança for 255
+		memset(tmp, 0, width);
+		for (k = 0; k <= 2 * r; k++)
+		{
+			if (stage->window[k] == NULL)
+				continue;
+			for (x = 0; x < width; x++)
+				tmp[x] |= (stage->window[k][x] == 255);
+		}
+		// Horizontal: janela deslizante com contagem de colunas marcadas
+		for (x = 0, count = 0; (x < r) && (x < width); x++)
+			count += tmp[x];
+		for (x = 0; x < width; x++)
+		{
+			if (x + r < width)
+				count += tmp[x + r];
+			if (x - r - 1 >= 0)
+				count -= tmp[x - r - 1];
+			out[x] = (count > 0) ? 255 : 0;
+		}
+		break;
+
+	case VC_STAGE_BINARY_ERODE:
+		// Vertical: coluna marcada se algum pixel da vizinhança for 0
+		memset(tmp, 0, width);
+		for (k = 0; k <= 2 * r; k++)
+		{
+			if (stage->window[k] == NULL)
+				continue;
+			for (x = 0; x < width; x++)
+				tmp[x] |= (stage->window[k][x] == 0);
+		}
+		// Horizontal: janela deslizante com contagem de colunas com fundo
+		for (x = 0, count = 0; (x < r) && (x < width); x++)
+			count += tmp[x];
+		for (x = 0; x < width; x++)
+		{
+			if (x + r < width)
+				count += tmp[x + r];
+			if (x - r - 1 >= 0)
+				count -= tmp[x - r - 1];
+			out[x] = (count > 0) ? 0 : 255;
+		}
+		break;
+	}
+}
+
+// Entrega uma linha processada às saídas da cadeia
+static int vc_stream_sink(STREAMVC *stream, unsigned char *row, int channels)
+{
+	int y = stream->nrows_out++;
+
+	if (stream->dst != NULL)
+		memcpy(&stream->dst->data[y * stream->dst->bytesperline], row, stream->width * channels);
+
+	if (stream->rle != NULL)
+	{
+		if (!vc_rle_append_row(stream->rle, y, row))
+			return 0;
+	}
+
+	return 1;
+}
+
+// Entrega uma linha ao estágio s e propaga as linhas que ficarem prontas
+static int vc_stream_push(STREAMVC *stream, int s, unsigned char *row)
+{
+	STAGEVC *stage;
+	int width = stream->width;
+	int height = stream->height;
+	int nring, rowbytes, y, yy, k;
+
+	if (s == stream->nstages)
+		return vc_stream_sink(stream, row, (s > 0) ? stream->stages[s - 1].channels_out : stream->channels);
+
+	stage = &stream->stages[s];
+
+	// Operadores ponto a ponto: não precisam de guardar linhas
+	if (stage->radius == 0)
+	{
+		stage->window[0] = row;
+		vc_stage_row(stage, width);
+		stage->nrows_in++;
+		stage->nrows_out++;
+
+		return vc_stream_push(stream, s + 1, stage->out);
+	}
+
+	nring = 2 * stage->radius + 1;
+	rowbytes = width * stage->channels_in;
+
+	memcpy(&stage->ring[(stage->nrows_in % nring) * rowbytes], row, rowbytes);
+	stage->nrows_in++;
+
+	// A linha y fica pronta quando já se recebeu a linha y + raio (ou a última linha)
+	while ((stage->nrows_out < height) && (stage->nrows_in >= MY_MIN(stage->nrows_out + stage->radius + 1, height)))
+	{
+		y = stage->nrows_out;
+
+		for (k = 0; k < nring; k++)
+		{
+			yy = y - stage->radius + k;
+
+			if ((yy < 0) || (yy >= height))
+				stage->window[k] = NULL;
+			else
+				stage->window[k] = &stage->ring[(yy % nring) * rowbytes];
+		}
+
+		vc_stage_row(stage, width);
+		stage->nrows_out++;
+
+		if (!vc_stream_push(stream, s + 1, stage->out))
+			return 0;
+	}
+
+	return 1;
+}
+
+// Acrescenta um estágio à cadeia
+static int vc_stream_add(STREAMVC *stream, int type, int radius, int channels_in, int channels_out, const int *param, int nparam)
+{
+	STAGEVC *stage;
+	int width, i;
+
+	if ((stream == NULL) || (stream->nstages >= VC_STREAM_MAX_STAGES) || (radius < 0))
+		return 0;
+
+	// Os canais de entrada têm de coincidir com a saída do estágio anterior
+	if (channels_in != ((stream->nstages > 0) ? stream->stages[stream->nstages - 1].channels_out : stream->channels))
+		return 0;
+
+	width = stream->width;
+	stage = &stream->stages[stream->nstages];
+	memset(stage, 0, sizeof(STAGEVC));
+
+	stage->type = type;
+	stage->radius = radius;
+	stage->channels_in = channels_in;
+	stage->channels_out = channels_out;
+	for (i = 0; i < nparam; i++)
+		stage->param[i] = param[i];
+
+	stage->window = (unsigned char **)malloc((2 * radius + 1) * sizeof(unsigned char *));
+	stage->tmp = (unsigned char *)malloc(width);
+	stage->out = (unsigned char *)malloc(width * channels_out);
+	if (radius > 0)
+		stage->ring = (unsigned char *)malloc((2 * radius + 1) * width * channels_in);
+
+	if ((stage->window == NULL) || (stage->tmp == NULL) || (stage->out == NULL) || ((radius > 0) && (stage->ring == NULL)))
+	{
+		free(stage->window);
+		free(stage->out);
+		free(stage->ring);
+		free(stage->tmp);
+		memset(stage, 0, sizeof(STAGEVC));
+		return 0;
+	}
+
+	stream->nstages++;
+
+	return 1;
+}
+
+// Alocar memória para uma cadeia de processamento linha a linha
+STREAMVC *vc_stream_new(int width, int height, int channels)
+{
+	STREAMVC *stream;
+
+	if ((width <= 0) || (height <= 0) || (channels <= 0))
+		return NULL;
+
+	stream = (STREAMVC *)calloc(1, sizeof(STREAMVC));
+	if (stream == NULL)
+		return NULL;
+
+	stream->width = width;
+	stream->height = height;
+	stream->channels = channels;
+
+	return stream;
+}
+
+// Libertar memória de uma cadeia de processamento linha a linha
+STREAMVC *vc_stream_free(STREAMVC *stream)
+{
+	int i;
+
+	if (stream != NULL)
+	{
+		for (i = 0; i < stream->nstages; i++)
+		{
+			free(stream->stages[i].window);
+			free(stream->stages[i].ring);
+			free(stream->stages[i].tmp);
+			free(stream->stages[i].out);
+		}
+
+		free(stream);
+		stream = NULL;
+	}
+
+	return stream;
+}
+
+// Conversão para cinzentos (mesma fórmula de vc_3channels_to_1channel)
+int vc_stream_add_rgb_to_gray(STREAMVC *stream)
+{
+	return vc_stream_add(stream, VC_STAGE_RGB_TO_GRAY, 0, 3, 1, NULL, 0);
+}
+
+// Conversão RGB -> HSV seguida de segmentação (como vc_rgb_to_hsv + vc_hsv_segmentation),
+// com saída binária de 1 canal
+int vc_stream_add_hsv_segmentation(STREAMVC *stream, int hmin, int hmax, int smin, int smax, int vmin, int vmax)
+{
+	int param[6];
+
+	param[0] = hmin;
+	param[1] = hmax;
+	param[2] = smin;
+	param[3] = smax;
+	param[4] = vmin;
+	param[5] = vmax;
+
+	return vc_stream_add(stream, VC_STAGE_HSV_SEGMENTATION, 0, 3, 1, param, 6);
+}
+
+// Binarização por threshold global
+int vc_stream_add_gray_to_binary(STREAMVC *stream, int threshold)
+{
+	return vc_stream_add(stream, VC_STAGE_GRAY_TO_BINARY, 0, 1, 1, &threshold, 1);
+}
+
+// Negativo de uma imagem em cinzentos
+int vc_stream_add_gray_negative(STREAMVC *stream)
+{
+	return vc_stream_add(stream, VC_STAGE_GRAY_NEGATIVE, 0, 1, 1, NULL, 0);
+}
+
+// Dilatação binária (imagens 0/255), igual a vc_binary_dilate
+int vc_stream_add_binary_dilate(STREAMVC *stream, int kernel)
+{
+	return vc_stream_add(stream, VC_STAGE_BINARY_DILATE, (kernel - 1) / 2, 1, 1, NULL, 0);
+}
+
+// Erosão binária (imagens 0/255), igual a vc_binary_erode
+int vc_stream_add_binary_erode(STREAMVC *stream, int kernel)
+{
+	return vc_stream_add(stream, VC_STAGE_BINARY_ERODE, (kernel - 1) / 2, 1, 1, NULL, 0);
+}
+
+// Executa a cadeia sobre uma imagem
+// src	: Imagem de entrada (dimensões e canais da cadeia)
+// dst	: Imagem de saída (opcional, pode ser NULL)
+// rle	: Saída em runs (opcional, pode ser NULL; exige saída de 1 canal)
+int vc_stream_run(STREAMVC *stream, IVC *src, IVC *dst, RLEVC *rle)
+{
+	int channels_out;
+	int y, i, ok = 1;
+
+	// Verificação de erros
+	if (stream == NULL)
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
+		return 0;
+	if ((src->width != stream->width) || (src->height != stream->height) || (src->channels != stream->channels))
+		return 0;
+
+	channels_out = (stream->nstages > 0) ? stream->stages[stream->nstages - 1].channels_out : stream->channels;
+
+	if ((dst != NULL) && ((dst->width != src->width) || (dst->height != src->height) || (dst->channels != channels_out) || (dst->data == NULL)))
+		return 0;
+	if ((rle != NULL) && ((rle->width != src->width) || (rle->height != src->height) || (channels_out != 1)))
+		return 0;
+
+	for (i = 0; i < stream->nstages; i++)
+	{
+		stream->stages[i].nrows_in = 0;
+		stream->stages[i].nrows_out = 0;
+	}
+	stream->nrows_out = 0;
+	stream->dst = dst;
+	stream->rle = rle;
+	if (rle != NULL)
+		rle->nruns = 0;
+
+	for (y = 0; (y < src->height) && ok; y++)
+		ok = vc_stream_push(stream, 0, &src->data[y * src->bytesperline]);
+
+	stream->dst = NULL;
+	stream->rle = NULL;
+
+	return ok;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Grafo de operadores com fusão
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// O pipeline é descrito como um grafo (nós = operadores da biblioteca, arestas = imagens).
+// A compilação:
+//  1. elimina os nós cujo resultado não chega a nenhuma saída;
+//  2. funde cadeias de operadores ponto a ponto num só ciclo sobre a imagem
+//     (RGB->cinzentos seguido de binarização/negativo passa a uma tabela de 256 entradas;
+//      RGB->HSV seguido de segmentação passa a um só ciclo), sem imagens intermédias;
+//  3. atribui buffers às imagens intermédias por análise de tempo de vida, reutilizando
+//     os buffers que deixam de ser lidos (e a própria entrada, nos operadores ponto a ponto).
+
+// Formas de execução de um grupo
+#define VC_KERNEL_OPERATOR		0	// Chamada ao operador original
+#define VC_KERNEL_LUT			1	// Cinzentos -> tabela
+#define VC_KERNEL_GRAY_LUT		2	// RGB -> cinzentos -> tabela
+#define VC_KERNEL_HSV_SEG		3	// RGB -> HSV -> segmentação
+
+// Canais da imagem de saída de um operador (0 se os canais de entrada não forem válidos)
+static int vc_graph_op_channels(int op, int channels)
+{
+	switch (op)
+	{
+	case VC_OP_RGB_TO_GRAY:
+		return (channels == 3) ? 1 : 0;
+	case VC_OP_RGB_NEGATIVE:
+	case VC_OP_RGB_TO_HSV:
+	case VC_OP_HSV_SEGMENTATION:
+		return (channels == 3) ? 3 : 0;
+	case VC_OP_GRAY_TO_BINARY:
+	case VC_OP_GRAY_NEGATIVE:
+	case VC_OP_BINARY_DILATE:
+	case VC_OP_BINARY_ERODE:
+	case VC_OP_GRAY_DILATE:
+	case VC_OP_GRAY_ERODE:
+	case VC_OP_BINARY_SUBTRACT:
+		return (channels == 1) ? 1 : 0;
+	}
+
+	return 0;
+}
+
+// Operadores que só dependem do próprio pixel (podem ser fundidos e executados no local)
+static int vc_graph_op_pointwise(int op)
+{
+	return (op != VC_OP_BINARY_DILATE) && (op != VC_OP_BINARY_ERODE) && (op != VC_OP_GRAY_DILATE) && (op != VC_OP_GRAY_ERODE);
+}
+
+// Aplica à tabela o operador de cinzentos de um nó (composição)
+static void vc_graph_lut_compose(unsigned char *lut, NODEVC *node)
+{
+	unsigned char op[256];
+
+	if (node->op == VC_OP_GRAY_TO_BINARY)
+		vc_lut_threshold(op, node->param[0]);
+	else if (node->op == VC_OP_GRAY_NEGATIVE)
+		vc_lut_negative(op);
+	else
+		return;
+
+	vc_lut_compose(lut, lut, op);
+}
+
+// Copia os pixéis de src para dst (mesmas dimensões e canais)
+static void vc_graph_copy(IVC *src, IVC *dst)
+{
+	int y;
+
+	if (src->data == dst->data)
+		return;
+
+	for (y = 0; y < src->height; y++)
+		memcpy(&dst->data[y * dst->bytesperline], &src->data[y * src->bytesperline], src->width * src->channels);
+}
+
+// Alocar memória para um grafo
+GRAPHVC *vc_graph_new(int width, int height)
+{
+	GRAPHVC *graph;
+
+	if ((width <= 0) || (height <= 0))
+		return NULL;
+
+	graph = (GRAPHVC *)calloc(1, sizeof(GRAPHVC));
+	if (graph == NULL)
+		return NULL;
+
+	graph->width = width;
+	graph->height = height;
+
+	return graph;
+}
+
+// Libertar os buffers do programa compilado
+static void vc_graph_release(GRAPHVC *graph)
+{
+	int i;
+
+	for (i = 0; i < graph->nbuffers; i++)
+		graph->buffers[i] = vc_image_free(graph->buffers[i]);
+
+	graph->nbuffers = 0;
+	graph->ngroups = 0;
+	graph->compiled = 0;
+}
+
+// Libertar memória de um grafo
+GRAPHVC *vc_graph_free(GRAPHVC *graph)
+{
+	if (graph != NULL)
+	{
+		vc_graph_release(graph);
+		free(graph);
+		graph = NULL;
+	}
+
+	return graph;
+}
+
+// Declara uma imagem de entrada externa. Devolve o identificador da imagem, ou -1.
+int vc_graph_input(GRAPHVC *graph, int channels)
+{
+	int image;
+
+	if ((graph == NULL) || (graph->nimages >= VC_GRAPH_MAX_IMAGES) || (channels <= 0))
+		return -1;
+
+	image = graph->nimages++;
+	graph->channels[image] = channels;
+	graph->input[image] = graph->ninputs++;
+	graph->output[image] = -1;
+	graph->compiled = 0;
+
+	return image;
+}
+
+// Acrescenta um nó que lê as imagens src (e src2) e escreve uma imagem nova.
+// param pode ser NULL se o operador não tiver parâmetros.
+// Devolve o identificador da imagem de saída, ou -1.
+int vc_graph_node(GRAPHVC *graph, int op, int src, int src2, const int *param)
+{
+	NODEVC *node;
+	int channels, nparam, i;
+
+	if ((graph == NULL) || (graph->nnodes >= VC_GRAPH_MAX_NODES) || (graph->nimages >= VC_GRAPH_MAX_IMAGES))
+		return -1;
+	if ((src < 0) || (src >= graph->nimages))
+		return -1;
+
+	channels = vc_graph_op_channels(op, graph->channels[src]);
+	if (channels == 0)
+		return -1;
+
+	// A subtracção precisa de uma segunda imagem com os mesmos canais
+	if (op == VC_OP_BINARY_SUBTRACT)
+	{
+		if ((src2 < 0) || (src2 >= graph->nimages) || (graph->channels[src2] != graph->channels[src]))
+			return -1;
+	}
+	else
+		src2 = -1;
+
+	// Número de parâmetros lidos: 6 na segmentação, 1 (threshold ou kernel) na binarização e na morfologia
+	if (op == VC_OP_HSV_SEGMENTATION)
+		nparam = 6;
+	else if ((op == VC_OP_GRAY_TO_BINARY) || !vc_graph_op_pointwise(op))
+		nparam = 1;
+	else
+		nparam = 0;
+
+	if ((nparam > 0) && (param == NULL))
+		return -1;
+
+	node = &graph->nodes[graph->nnodes++];
+	node->op = op;
+	node->src = src;
+	node->src2 = src2;
+	node->dst = graph->nimages++;
+	for (i = 0; i < 6; i++)
+		node->param[i] = (i < nparam) ? param[i] : 0;
+
+	graph->channels[node->dst] = channels;
+	graph->input[node->dst] = -1;
+	graph->output[node->dst] = -1;
+	graph->compiled = 0;
+
+	return node->dst;
+}
+
+// Marca uma imagem como saída externa
+int vc_graph_output(GRAPHVC *graph, int image)
+{
+	if ((graph == NULL) || (image < 0) || (image >= graph->nimages))
+		return 0;
+	if ((graph->input[image] >= 0) || (graph->output[image] >= 0))
+		return 0;
+
+	graph->output[image] = graph->noutputs++;
+	graph->compiled = 0;
+
+	return 1;
+}
+
+// Compila o grafo num programa de grupos fundidos com buffers atribuídos
+int vc_graph_compile(GRAPHVC *graph)
+{
+	int live[VC_GRAPH_MAX_NODES];
+	int uses[VC_GRAPH_MAX_IMAGES];		// Nº de nós vivos que lêem cada imagem
+	int lastuse[VC_GRAPH_MAX_IMAGES];	// Último grupo que lê cada imagem
+	int group[VC_GRAPH_MAX_IMAGES];		// Grupo que produz cada imagem (-1 = entrada)
+	int busy[VC_GRAPH_MAX_IMAGES];		// Buffer ocupado
+	int needed[VC_GRAPH_MAX_IMAGES];
+	GROUPVC *g;
+	NODEVC *node;
+	int i, b, n, src;
+
+	if (graph == NULL)
+		return 0;
+
+	vc_graph_release(graph);
+
+	// 1. Eliminação de nós mortos (percurso do fim para o início)
+	for (i = 0; i < graph->nimages; i++)
+	{
+		needed[i] = (graph->output[i] >= 0);
+		uses[i] = 0;
+		group[i] = -1;
+		lastuse[i] = -1;
+		graph->buffer[i] = -1;
+	}
+	for (n = graph->nnodes - 1; n >= 0; n--)
+	{
+		node = &graph->nodes[n];
+		live[n] = needed[node->dst];
+		if (live[n])
+		{
+			needed[node->src] = 1;
+			uses[node->src]++;
+			if (node->src2 >= 0)
+			{
+				needed[node->src2] = 1;
+				uses[node->src2]++;
+			}
+		}
+	}
+
+	// 2. Fusão de operadores ponto a ponto
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		if (!live[n])
+			continue;
+
+		node = &graph->nodes[n];
+		src = node->src;
+
+		// Pode juntar-se ao grupo que produz a entrada, se for o seu único leitor e esta não for uma saída
+		if ((group[src] >= 0) && (uses[src] == 1) && (graph->output[src] < 0) && (node->src2 < 0))
+		{
+			g = &graph->groups[group[src]];
+
+			if (((g->kernel == VC_KERNEL_LUT) || (g->kernel == VC_KERNEL_GRAY_LUT)) &&
+				((node->op == VC_OP_GRAY_TO_BINARY) || (node->op == VC_OP_GRAY_NEGATIVE)))
+			{
+				vc_graph_lut_compose(g->lut, node);
+				g->last = n;
+				g->dst = node->dst;
+				group[node->dst] = group[src];
+				continue;
+			}
+			if ((g->kernel == VC_KERNEL_OPERATOR) && (g->first == g->last) && (graph->nodes[g->first].op == VC_OP_RGB_TO_HSV) && (node->op == VC_OP_HSV_SEGMENTATION))
+			{
+				g->kernel = VC_KERNEL_HSV_SEG;
+				g->last = n;
+				g->dst = node->dst;
+				group[node->dst] = group[src];
+				continue;
+			}
+		}
+
+		// Novo grupo
+		g = &graph->groups[graph->ngroups];
+		g->first = g->last = n;
+		g->src = node->src;
+		g->src2 = node->src2;
+		g->dst = node->dst;
+
+		vc_lut_identity(g->lut);
+
+		if (node->op == VC_OP_RGB_TO_GRAY)
+			g->kernel = VC_KERNEL_GRAY_LUT;
+		else if ((node->op == VC_OP_GRAY_TO_BINARY) || (node->op == VC_OP_GRAY_NEGATIVE))
+		{
+			g->kernel = VC_KERNEL_LUT;
+			vc_graph_lut_compose(g->lut, node);
+		}
+		else
+			g->kernel = VC_KERNEL_OPERATOR;
+
+		group[node->dst] = graph->ngroups;
+		graph->ngroups++;
+	}
+
+	// 3. Tempo de vida das imagens e atribuição de buffers
+	for (i = 0; i < graph->ngroups; i++)
+	{
+		lastuse[graph->groups[i].src] = i;
+		if (graph->groups[i].src2 >= 0)
+			lastuse[graph->groups[i].src2] = i;
+	}
+	for (b = 0; b < VC_GRAPH_MAX_IMAGES; b++)
+		busy[b] = 0;
+
+	for (i = 0; i < graph->ngroups; i++)
+	{
+		g = &graph->groups[i];
+
+		// As saídas são escritas directamente nas imagens externas
+		if (graph->output[g->dst] < 0)
+		{
+			b = -1;
+
+			// Operadores ponto a ponto podem escrever sobre a entrada que deixa de ser usada
+			if (vc_graph_op_pointwise(graph->nodes[g->first].op) && (lastuse[g->src] == i) && (graph->buffer[g->src] >= 0) &&
+				(graph->channels[g->src] == graph->channels[g->dst]) && (g->src2 < 0))
+			{
+				b = graph->buffer[g->src];
+			}
+
+			// Senão, reutiliza um buffer livre com o mesmo número de canais
+			for (n = 0; (b < 0) && (n < graph->nbuffers); n++)
+			{
+				if (!busy[n] && (graph->buffers[n]->channels == graph->channels[g->dst]))
+					b = n;
+			}
+
+			if (b < 0)
+			{
+				b = graph->nbuffers;
+				graph->buffers[b] = vc_image_new(graph->width, graph->height, graph->channels[g->dst], 255);
+				if (graph->buffers[b] == NULL)
+				{
+					vc_graph_release(graph);
+					return 0;
+				}
+				graph->nbuffers++;
+			}
+
+			busy[b] = 1;
+			graph->buffer[g->dst] = b;
+		}
+
+		// Liberta os buffers das entradas que já não são lidas
+		if ((lastuse[g->src] == i) && (graph->buffer[g->src] >= 0) && (graph->buffer[g->src] != graph->buffer[g->dst]))
+			busy[graph->buffer[g->src]] = 0;
+		if ((g->src2 >= 0) && (lastuse[g->src2] == i) && (graph->buffer[g->src2] >= 0) && (graph->buffer[g->src2] != graph->buffer[g->dst]))
+			busy[graph->buffer[g->src2]] = 0;
+	}
+
+	graph->compiled = 1;
+
+	return 1;
+}
+
+// Executa um grupo compilado
+static int vc_graph_exec(GRAPHVC *graph, GROUPVC *g, IVC *src, IVC *src2, IVC *dst)
+{
+	NODEVC *node = &graph->nodes[g->first];
+	unsigned char *ps, *pd;
+	int x, y;
+
+	switch (g->kernel)
+	{
+	case VC_KERNEL_LUT:
+		return vc_lut_apply(src, dst, g->lut);
+
+	case VC_KERNEL_GRAY_LUT:
+		for (y = 0; y < src->height; y++)
+		{
+			ps = &src->data[y * src->bytesperline];
+			pd = &dst->data[y * dst->bytesperline];
+			vc_gray_row(ps, pd, src->width, 3, VC_GRAY_WR, VC_GRAY_WG, VC_GRAY_WB);
+			vc_lut_row(pd, pd, src->width, g->lut);
+		}
+		return 1;
+
+	case VC_KERNEL_HSV_SEG:
+		node = &graph->nodes[g->last];
+		for (y = 0; y < src->height; y++)
+		{
+			unsigned char hsv[3];
+
+			ps = &src->data[y * src->bytesperline];
+			pd = &dst->data[y * dst->bytesperline];
+			for (x = 0; x < src->width; x++)
+			{
+				vc_rgb_pixel_to_hsv((float)ps[x * 3], (float)ps[x * 3 + 1], (float)ps[x * 3 + 2], hsv);
+				pd[x * 3] = pd[x * 3 + 1] = pd[x * 3 + 2] = vc_hsv_pixel_in_range(hsv, node->param[0], node->param[1], node->param[2],
+																			   node->param[3], node->param[4], node->param[5]) ? 255 : 0;
+			}
+		}
+		return 1;
+	}
+
+	switch (node->op)
+	{
+	case VC_OP_RGB_NEGATIVE:
+		vc_graph_copy(src, dst);
+		return vc_rgb_negative(dst);
+	case VC_OP_RGB_TO_HSV:
+		vc_graph_copy(src, dst);
+		return vc_rgb_to_hsv(dst);
+	case VC_OP_HSV_SEGMENTATION:
+		vc_graph_copy(src, dst);
+		return vc_hsv_segmentation(dst, node->param[0], node->param[1], node->param[2], node->param[3], node->param[4], node->param[5]);
+	case VC_OP_BINARY_DILATE:
+		return vc_binary_dilate(src, dst, node->param[0]);
+	case VC_OP_BINARY_ERODE:
+		return vc_binary_erode(src, dst, node->param[0]);
+	case VC_OP_GRAY_DILATE:
+		return vc_gray_dilate(src, dst, node->param[0]);
+	case VC_OP_GRAY_ERODE:
+		return vc_gray_erode(src, dst, node->param[0]);
+	case VC_OP_BINARY_SUBTRACT:
+		return vc_binary_subtract(src, src2, dst);
+	}
+
+	return 0;
+}
+
+// Executa o grafo (compila-o, se necessário)
+// inputs	: Imagens de entrada, pela ordem de vc_graph_input
+// outputs	: Imagens de saída, pela ordem de vc_graph_output
+int vc_graph_run(GRAPHVC *graph, IVC **inputs, IVC **outputs)
+{
+	IVC *images[VC_GRAPH_MAX_IMAGES];
+	IVC *img;
+	GROUPVC *g;
+	int i;
+
+	if (graph == NULL)
+		return 0;
+	if (!graph->compiled && !vc_graph_compile(graph))
+		return 0;
+
+	for (i = 0; i < graph->nimages; i++)
+	{
+		if (graph->input[i] >= 0)
+			img = inputs[graph->input[i]];
+		else if (graph->output[i] >= 0)
+			img = outputs[graph->output[i]];
+		else if (graph->buffer[i] >= 0)
+			img = graph->buffers[graph->buffer[i]];
+		else
+			img = NULL; // Imagem eliminada (fundida ou morta)
+
+		if ((graph->input[i] >= 0) || (graph->output[i] >= 0))
+		{
+			if ((img == NULL) || (img->data == NULL) || (img->width != graph->width) || (img->height != graph->height) || (img->channels != graph->channels[i]))
+				return 0;
+		}
+
+		images[i] = img;
+	}
+
+	for (i = 0; i < graph->ngroups; i++)
+	{
+		g = &graph->groups[i];
+
+		if (!vc_graph_exec(graph, g, images[g->src], (g->src2 >= 0) ? images[g->src2] : NULL, images[g->dst]))
+			return 0;
+	}
+
+	return 1;
+}
+
+// Mostra o programa compilado (grupos fundidos e buffers)
+void vc_graph_print(GRAPHVC *graph)
+{
+	static const char *kernels[] = {"operador", "tabela", "cinzentos+tabela", "hsv+segmentacao"};
+	GROUPVC *g;
+	int i;
+
+	if ((graph == NULL) || (!graph->compiled && !vc_graph_compile(graph)))
+		return;
+
+	printf("Grafo: %d nos, %d grupos, %d buffers internos\n", graph->nnodes, graph->ngroups, graph->nbuffers);
+
+	for (i = 0; i < graph->ngroups; i++)
+	{
+		g = &graph->groups[i];
+
+		printf("  grupo %d [%s]: nos %d..%d | img %d -> img %d (buffer %d)\n", i, kernels[g->kernel], g->first, g->last, g->src, g->dst, graph->buffer[g->dst]);
+	}
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Descodificação de resistências
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// O valor de uma resistência lê-se num perfil de cor 1-D, amostrado ao longo do eixo maior do
+// blob (rectângulo de área mínima do contorno): no máximo VC_RESISTOR_SAMPLES pontos, cada um a
+// média de alguns pixéis na perpendicular. Cada ponto é classificado por uma tabela de cores
+// pré-calculada (RGB com 5 bits por canal). A cor mais frequente do perfil é o corpo da
+// resistência; as bandas são os segmentos de outras cores entre o início e o fim do corpo.
+// O custo depende só do número de amostras, e não da resolução da imagem.
+
+#define VC_RESISTOR_SAMPLES	256	// Máximo de pontos no perfil
+#define VC_RESISTOR_ACROSS	5	// Pixéis por ponto, na perpendicular ao eixo
+
+// Classifica uma cor RGB numa cor de banda (VC_BAND_*)
+static int vc_resistor_classify(int r, int g, int b)
+{
+	int max = MY_MAX(r, MY_MAX(g, b));
+	int min = MY_MIN(r, MY_MIN(g, b));
+	float v = (float)max / 255.0f;
+	float s = (max > 0) ? (float)(max - min) / (float)max : 0.0f;
+	float h;
+
+	if (v < 0.18f)
+		return VC_BAND_BLACK;
+
+	// Cores pouco saturadas: branco, cinzento (ou prateado) e preto
+	if (s < 0.2f)
+	{
+		if (v > 0.8f)
+			return VC_BAND_WHITE;
+		if (v > 0.4f)
+			return VC_BAND_GREY;
+		return VC_BAND_BLACK;
+	}
+
+	// Matiz em graus [0, 360[
+	if (max == r)
+		h = 60.0f * (float)(g - b) / (float)(max - min);
+	else if (max == g)
+		h = 120.0f + 60.0f * (float)(b - r) / (float)(max - min);
+	else
+		h = 240.0f + 60.0f * (float)(r - g) / (float)(max - min);
+	if (h < 0.0f)
+		h += 360.0f;
+
+	if ((h < 12.0f) || (h >= 335.0f))
+		return (v < 0.45f) ? VC_BAND_BROWN : VC_BAND_RED;
+	if (h < 35.0f)
+		return (v < 0.55f) ? VC_BAND_BROWN : VC_BAND_ORANGE;
+	if (h < 55.0f)
+	{
+		// Bege (corpo), dourado (menos saturado e mais escuro) ou amarelo
+		if ((s < 0.5f) && (v >= 0.75f))
+			return VC_BAND_NONE;
+		if ((s < 0.75f) && (v < 0.8f))
+			return VC_BAND_GOLD;
+		return VC_BAND_YELLOW;
+	}
+	if (h < 70.0f)
+		return VC_BAND_YELLOW;
+	if (h < 165.0f)
+		return VC_BAND_GREEN;
+	if (h < 255.0f)
+		return VC_BAND_BLUE;
+
+	return VC_BAND_VIOLET;
+}
+
+// Preenche a tabela de cores (VC_RESISTOR_TABLE_SIZE entradas), indexada por VC_RESISTOR_INDEX
+void vc_resistor_color_table(unsigned char *table)
+{
+	int r, g, b;
+
+	for (r = 0; r < 32; r++)
+		for (g = 0; g < 32; g++)
+			for (b = 0; b < 32; b++)
+				table[(r << 10) | (g << 5) | b] = (unsigned char)vc_resistor_classify((r << 3) + 4, (g << 3) + 4, (b << 3) + 4);
+}
+
+// Classifica como 'band' as entradas da tabela cuja cor está no intervalo HSV dado (H em [0,360],
+// S e V em [0,100]), por cima da classificação de vc_resistor_color_table. Serve para afinar uma
+// cor para a iluminação de uma câmara sem recompilar.
+int vc_resistor_color_table_range(unsigned char *table, int band, int hmin, int hmax, int smin, int smax, int vmin, int vmax)
+{
+	unsigned char hsv[3];
+	int r, g, b;
+
+	// Verificação de erros
+	if ((table == NULL) || (band < 0) || (band > VC_BAND_NONE))
+		return 0;
+
+	for (r = 0; r < 32; r++)
+		for (g = 0; g < 32; g++)
+			for (b = 0; b < 32; b++)
+			{
+				vc_rgb_pixel_to_hsv((float)((r << 3) + 4), (float)((g << 3) + 4), (float)((b << 3) + 4), hsv);
+				if (vc_hsv_pixel_in_range(hsv, hmin, hmax, smin, smax, vmin, vmax))
+					table[(r << 10) | (g << 5) | b] = (unsigned char)band;
+			}
+
+	return 1;
+}
+
+const char *vc_resistor_band_name(int band)
+{
+	static const char *names[] = {"preto", "castanho", "vermelho", "laranja", "amarelo", "verde", "azul",
+								  "violeta", "cinzento", "branco", "dourado", "prateado", "nenhuma"};
+
+	if ((band < 0) || (band > VC_BAND_NONE))
+		return "?";
+
+	return names[band];
+}
+
+// Tolerância (%) de uma banda, ou < 0 se a cor não for de tolerância
+static float vc_resistor_tolerance(int band)
+{
+	switch (band)
+	{
+	case VC_BAND_BROWN:
+		return 1.0f;
+	case VC_BAND_RED:
+		return 2.0f;
+	case VC_BAND_GREEN:
+		return 0.5f;
+	case VC_BAND_BLUE:
+		return 0.25f;
+	case VC_BAND_VIOLET:
+		return 0.1f;
+	case VC_BAND_GREY:
+		return 10.0f; // Prateado: as duas cores não se distinguem
+	case VC_BAND_GOLD:
+		return 5.0f;
+	case VC_BAND_SILVER:
+		return 10.0f;
+	}
+
+	return -1.0f;
+}
+
+// Calcula o valor a partir das bandas (da 1ª à última). Devolve 0 se a sequência não for válida.
+static int vc_resistor_value(RESISTORVC *resistor)
+{
+	int *bands = resistor->bands;
+	int ndigits, i;
+	double value = 0.0;
+	int mult;
+
+	// 3 bandas: 2 dígitos + multiplicador (20%); 4: 2 dígitos + multiplicador + tolerância;
+	// 5: 3 dígitos + multiplicador + tolerância
+	if ((resistor->nbands < 3) || (resistor->nbands > 5))
+		return 0;
+
+	ndigits = (resistor->nbands == 5) ? 3 : 2;
+
+	for (i = 0; i < ndigits; i++)
+	{
+		if (bands[i] > VC_BAND_WHITE)
+			return 0;
+		value = value * 10.0 + bands[i];
+	}
+
+	// No multiplicador, o cinzento é lido como prateado
+	mult = bands[ndigits];
+	if (mult <= VC_BAND_VIOLET)
+		value *= pow(10.0, mult);
+	else if (mult == VC_BAND_GOLD)
+		value *= 0.1;
+	else if ((mult == VC_BAND_SILVER) || (mult == VC_BAND_GREY))
+		value *= 0.01;
+	else
+		return 0;
+
+	if (resistor->nbands == 3)
+		resistor->tolerance = 20.0f;
+	else
+	{
+		resistor->tolerance = vc_resistor_tolerance(bands[ndigits + 1]);
+		if (resistor->tolerance < 0.0f)
+			return 0;
+	}
+
+	resistor->value = value;
+
+	return 1;
+}
+
+// Descodifica uma resistência a partir do seu eixo maior
+// src		: Imagem de cor (3 ou 4 canais, na ordem 'order')
+// cx, cy	: Centro da resistência
+// angle	: Orientação do eixo maior, em graus (y a crescer para baixo)
+// length	: Comprimento ao longo do eixo; width: largura na perpendicular
+// table	: Tabela de vc_resistor_color_table
+int vc_resistor_decode_axis(IVC *src, int order, float cx, float cy, float angle, float length, float width,
+							const unsigned char *table, RESISTORVC *resistor)
+{
+	unsigned char classes[VC_RESISTOR_SAMPLES];
+	int start[VC_RESISTOR_SAMPLES], len[VC_RESISTOR_SAMPLES], cls[VC_RESISTOR_SAMPLES];
+	int count[VC_BAND_NONE + 1] = {0};
+	int ri, gi, bi, nch;
+	int n, i, j, k, nruns, minlen, body, first, last, tmp;
+	float ux, uy, t, o, px, py;
+	int x, y, r, g, b, m;
+	const unsigned char *p;
+
+	if (resistor == NULL)
+		return 0;
+	resistor->nbands = 0;
+	resistor->value = 0.0;
+	resistor->tolerance = 0.0f;
+	resistor->nsamples = 0;
+
+	// Verificação de erros
+	if (!vc_order_check(src, order) || (table == NULL))
+		return 0;
+	if ((length < 2.0f) || (width < 0.0f))
+		return 0;
+
+	nch = vc_order_layout(order, &ri, &gi, &bi);
+	ux = (float)cos(angle * 3.14159265358979 / 180.0);
+	uy = (float)sin(angle * 3.14159265358979 / 180.0);
+
+	// Perfil: n pontos ao longo do eixo, cada um com a média de VC_RESISTOR_ACROSS pixéis
+	// espalhados por metade da largura
+	n = MY_MIN((int)length, VC_RESISTOR_SAMPLES);
+	for (i = 0; i < n; i++)
+	{
+		t = ((float)i + 0.5f) * length / (float)n - length / 2.0f;
+		r = g = b = m = 0;
+
+		for (k = 0; k < VC_RESISTOR_ACROSS; k++)
+		{
+			o = width * 0.5f * ((float)k / (VC_RESISTOR_ACROSS - 1) - 0.5f);
+			px = cx + t * ux - o * uy;
+			py = cy + t * uy + o * ux;
+			x = (int)floor(px + 0.5f);
+			y = (int)floor(py + 0.5f);
+			if ((x < 0) || (x >= src->width) || (y < 0) || (y >= src->height))
+				continue;
+
+			p = &src->data[y * src->bytesperline + x * nch];
+			r += p[ri];
+			g += p[gi];
+			b += p[bi];
+			m++;
+		}
+
+		if (m == 0)
+			classes[i] = VC_BAND_NONE;
+		else
+			classes[i] = table[VC_RESISTOR_INDEX(r / m, g / m, b / m)];
+	}
+	resistor->nsamples = n;
+
+	// Segmentos de cor constante; os mais curtos do que minlen juntam-se ao anterior
+	minlen = MY_MAX(1, n / 40);
+	for (i = 0, nruns = 0; i < n; i = j)
+	{
+		for (j = i; (j < n) && (classes[j] == classes[i]); j++)
+			;
+
+		if ((nruns > 0) && ((j - i < minlen) || (cls[nruns - 1] == classes[i])))
+			len[nruns - 1] += j - i;
+		else
+		{
+			start[nruns] = i;
+			len[nruns] = j - i;
+			cls[nruns] = classes[i];
+			nruns++;
+		}
+	}
+
+	// O 1º segmento, se for curto, junta-se ao seguinte
+	if ((nruns > 1) && (len[0] < minlen))
+	{
+		start[1] = 0;
+		len[1] += len[0];
+		for (i = 1; i < nruns; i++)
+		{
+			start[i - 1] = start[i];
+			len[i - 1] = len[i];
+			cls[i - 1] = cls[i];
+		}
+		nruns--;
+	}
+
+	// Corpo: a cor com mais amostras
+	for (i = 0; i < nruns; i++)
+		count[cls[i]] += len[i];
+	for (i = 1, body = 0; i <= VC_BAND_NONE; i++)
+		if (count[i] > count[body])
+			body = i;
+
+	// Bandas: segmentos de outra cor entre o 1º e o último segmento do corpo
+	for (first = 0; (first < nruns) && (cls[first] != body); first++)
+		;
+	for (last = nruns - 1; (last >= 0) && (cls[last] != body); last--)
+		;
+
+	for (i = first + 1; i < last; i++)
+	{
+		if ((cls[i] == body) || (cls[i] == VC_BAND_NONE))
+			continue;
+		if (resistor->nbands == VC_RESISTOR_MAX_BANDS)
+			return 0;
+
+		resistor->bands[resistor->nbands] = cls[i];
+		resistor->nbands++;
+	}
+
+	if (resistor->nbands < 3)
+		return 0;
+
+	// Sentido de leitura: a banda dourada ou prateada (só pode ser tolerância) fica no fim; sem
+	// ela numa só das pontas, a 1ª banda é a que está mais perto da ponta do corpo
+	k = resistor->nbands - 1;
+	i = (resistor->bands[0] == VC_BAND_GOLD) || (resistor->bands[0] == VC_BAND_SILVER);
+	m = (resistor->bands[k] == VC_BAND_GOLD) || (resistor->bands[k] == VC_BAND_SILVER);
+	if (i != m)
+		j = i;
+	else
+	{
+		for (i = first + 1; (i < last) && ((cls[i] == body) || (cls[i] == VC_BAND_NONE)); i++)
+			;
+		for (m = last - 1; (m > first) && ((cls[m] == body) || (cls[m] == VC_BAND_NONE)); m--)
+			;
+		j = (start[i] - start[first]) > (start[last] + len[last] - (start[m] + len[m]));
+	}
+
+	if (j)
+	{
+		for (i = 0; i < resistor->nbands / 2; i++)
+		{
+			tmp = resistor->bands[i];
+			resistor->bands[i] = resistor->bands[k - i];
+			resistor->bands[k - i] = tmp;
+		}
+	}
+
+	// Na posição de tolerância, o cinzento é prateado
+	if ((resistor->nbands > 3) && (resistor->bands[k] == VC_BAND_GREY))
+		resistor->bands[k] = VC_BAND_SILVER;
+
+	return vc_resistor_value(resistor);
+}
+
+// Descodifica a resistência de um blob
+// src		: Imagem de cor (3 ou 4 canais, na ordem 'order')
+// labels	: Imagem de etiquetas de onde saiu o blob (o eixo vem do contorno, com custo
+//			  proporcional ao perímetro)
+int vc_resistor_decode(IVC *src, int order, IVC *labels, OVC *blob, const unsigned char *table, RESISTORVC *resistor)
+{
+	CONTOURVC *contour;
+	int ok;
+
+	if (resistor != NULL)
+		resistor->nbands = 0;
+
+	contour = vc_contour_new();
+	if (contour == NULL)
+		return 0;
+
+	ok = vc_binary_blob_contour(labels, blob, contour);
+	if (ok)
+		ok = vc_resistor_decode_axis(src, order, contour->rect_cx, contour->rect_cy, contour->rect_angle,
+									 contour->rect_length, contour->rect_width, table, resistor);
+
+	vc_contour_free(contour);
+
+	return ok;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Regiões orientadas (rotação e recorte)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Um recorte orientado é uma imagem dst em que o eixo x segue a orientação do objecto: o pixel
+// (u, v) de dst vem do ponto (cx, cy) + R(angle) * (u + 0.5 - W / 2, v + 0.5 - H / 2) de src,
+// interpolado bilinearmente. As coordenadas avançam em vírgula fixa 16.16 ao longo de cada
+// linha e os pesos da interpolação têm VC_WARP_BITS bits, por isso as versões escalar e SIMD
+// dão o mesmo resultado. Os pixéis de dst que caem fora de src ficam a 0.
+
+#define VC_WARP_BITS	6
+#define VC_WARP_ONE		(1 << VC_WARP_BITS)
+
+// Interpola um pixel com os 4 vizinhos dentro da imagem
+static __inline void vc_warp_pixel(const unsigned char *p00, int bytesperline, int nch, int fx, int fy, unsigned char *out)
+{
+	const unsigned char *p10 = p00 + bytesperline;
+	int c, top, bottom;
+
+	for (c = 0; c < nch; c++)
+	{
+		top = p00[c] * (VC_WARP_ONE - fx) + p00[c + nch] * fx;
+		bottom = p10[c] * (VC_WARP_ONE - fx) + p10[c + nch] * fx;
+		out[c] = (unsigned char)((top * (VC_WARP_ONE - fy) + bottom * fy + (1 << (2 * VC_WARP_BITS - 1))) >> (2 * VC_WARP_BITS));
+	}
+}
+
+// Interpola um pixel junto ao rebordo: os vizinhos fora da imagem valem 0
+static void vc_warp_pixel_border(IVC *src, int x0, int y0, int fx, int fy, unsigned char *out)
+{
+	int nch = src->channels;
+	int c, k, x, y, w, acc;
+
+	for (c = 0; c < nch; c++)
+	{
+		for (k = 0, acc = 0; k < 4; k++)
+		{
+			x = x0 + (k & 1);
+			y = y0 + (k >> 1);
+			if ((x < 0) || (x >= src->width) || (y < 0) || (y >= src->height))
+				continue;
+
+			w = ((k & 1) ? fx : VC_WARP_ONE - fx) * ((k >> 1) ? fy : VC_WARP_ONE - fy);
+			acc += src->data[y * src->bytesperline + x * nch + c] * w;
+		}
+		out[c] = (unsigned char)((acc + (1 << (2 * VC_WARP_BITS - 1))) >> (2 * VC_WARP_BITS));
+	}
+}
+
+// Recorte orientado de src (1, 3 ou 4 canais) para dst (mesmo número de canais; o tamanho de dst
+// é o tamanho do recorte)
+// cx, cy	: Centro do recorte em src (o centro do pixel (x, y) é (x, y))
+// angle	: Orientação do eixo x do recorte em src, em graus (y a crescer para baixo)
+int vc_warp_oriented_roi(IVC *src, IVC *dst, float cx, float cy, float angle)
+{
+	int nch, u, v, x0, y0, fx, fy;
+	int sx, sy, dxu, dyu;
+	double ca, sa, du, dv;
+	unsigned char *out;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((src->width <= 0) || (src->height <= 0) || (dst->width <= 0) || (dst->height <= 0))
+		return 0;
+	if (src->channels != dst->channels)
+		return 0;
+	if ((src->channels != 1) && (src->channels != 3) && (src->channels != 4))
+		return 0;
+	if (src->data == dst->data)
+		return 0;
+
+	nch = src->channels;
+	ca = cos(angle * 3.14159265358979 / 180.0);
+	sa = sin(angle * 3.14159265358979 / 180.0);
+
+	// Incremento das coordenadas de src por cada pixel de uma linha de dst (16.16)
+	dxu = (int)floor(ca * 65536.0 + 0.5);
+	dyu = (int)floor(sa * 65536.0 + 0.5);
+
+#if defined(VC_USE_SSSE3)
+	// Pares (p[c], p[c + nch]) da linha de cima nos 8 bytes baixos e da linha de baixo nos altos.
+	// Com 1 canal a versão escalar é tão rápida como a SIMD, que só é usada com 3 e 4 canais.
+	const __m128i pairs = (nch == 3) ? _mm_setr_epi8(0, 3, 1, 4, 2, 5, -1, -1, 8, 11, 9, 12, 10, 13, -1, -1)
+									 : _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+	const __m128i round = _mm_set1_epi32(1 << (2 * VC_WARP_BITS - 1));
+	const unsigned char *end = src->data + (long int)src->bytesperline * src->height;
+#endif
+
+	for (v = 0; v < dst->height; v++)
+	{
+		// Coordenadas em src do 1º pixel da linha
+		du = 0.5 - dst->width / 2.0;
+		dv = v + 0.5 - dst->height / 2.0;
+		sx = (int)floor((cx + du * ca - dv * sa) * 65536.0 + 0.5);
+		sy = (int)floor((cy + du * sa + dv * ca) * 65536.0 + 0.5);
+		out = &dst->data[v * dst->bytesperline];
+
+		for (u = 0; u < dst->width; u++, sx += dxu, sy += dyu, out += nch)
+		{
+			x0 = sx >> 16;
+			y0 = sy >> 16;
+			fx = (sx >> (16 - VC_WARP_BITS)) & (VC_WARP_ONE - 1);
+			fy = (sy >> (16 - VC_WARP_BITS)) & (VC_WARP_ONE - 1);
+
+			// Fora da imagem
+			if ((x0 < -1) || (x0 >= src->width) || (y0 < -1) || (y0 >= src->height))
+			{
+				memset(out, 0, nch);
+				continue;
+			}
+
+			// Rebordo
+			if ((x0 < 0) || (x0 >= src->width - 1) || (y0 < 0) || (y0 >= src->height - 1))
+			{
+				vc_warp_pixel_border(src, x0, y0, fx, fy, out);
+				continue;
+			}
+
+#if defined(VC_USE_SSSE3)
+			{
+				const unsigned char *p00 = &src->data[y0 * src->bytesperline + x0 * nch];
+
+				// As leituras de 8 bytes não podem passar o fim da imagem
+				if ((nch != 1) && (p00 + src->bytesperline + 8 <= end))
+				{
+					__m128i px, h, w;
+					int r;
+
+					px = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)p00), _mm_loadl_epi64((const __m128i *)(p00 + src->bytesperline)));
+
+					// Horizontal: p[c] * (1 - fx) + p[c + nch] * fx, 8 valores de 16 bits
+					h = _mm_maddubs_epi16(_mm_shuffle_epi8(px, pairs), _mm_set1_epi16((short)((fx << 8) | (VC_WARP_ONE - fx))));
+
+					// Vertical: cima * (1 - fy) + baixo * fy, 4 valores de 32 bits
+					w = _mm_madd_epi16(_mm_unpacklo_epi16(h, _mm_srli_si128(h, 8)), _mm_set1_epi32((fy << 16) | (VC_WARP_ONE - fy)));
+					w = _mm_srli_epi32(_mm_add_epi32(w, round), 2 * VC_WARP_BITS);
+					w = _mm_packs_epi32(w, w);
+					w = _mm_packus_epi16(w, w);
+
+					r = _mm_cvtsi128_si32(w);
+					memcpy(out, &r, nch);
+					continue;
+				}
+			}
+#endif
+
+			vc_warp_pixel(&src->data[y0 * src->bytesperline + x0 * nch], src->bytesperline, nch, fx, fy, out);
+		}
+	}
+
+	return 1;
+}
+
+// Recorte orientado de um blob: dst fica com o eixo maior na horizontal, centrado no centro de
+// massa sem arredondamento (cx, cy). Usa a orientação calculada com as estatísticas do blob (vc_binary_blob_info,
+// vc_rle_blob_info, ...), sem voltar a percorrer a imagem. O tamanho do recorte é o de dst
+// (por exemplo, blob->major x blob->minor).
+int vc_blob_oriented_roi(IVC *src, OVC *blob, IVC *dst)
+{
+	if ((blob == NULL) || (blob->area <= 0))
+		return 0;
+
+	return vc_warp_oriented_roi(src, dst, blob->cx, blob->cy, blob->angle);
+}
+
+// Descodifica uma resistência num recorte orientado (eixo maior na horizontal, a ocupar o recorte)
+int vc_resistor_decode_strip(IVC *strip, int order, const unsigned char *table, RESISTORVC *resistor)
+{
+	if (strip == NULL)
+		return 0;
+
+	return vc_resistor_decode_axis(strip, order, (strip->width - 1) / 2.0f, (strip->height - 1) / 2.0f, 0.0f,
+								   (float)strip->width, (float)strip->height, table, resistor);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Escalonador com orçamento por frame
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// O escalonador mede a duração de cada etapa e de cada frame. Quando uma frame passa o
+// orçamento, ou a média recente se aproxima dele (VC_SCHED_RISK), o nível de degradação sobe
+// um degrau; o nível só volta a descer depois de VC_SCHED_RELAX frames seguidas abaixo de
+// VC_SCHED_SLACK do orçamento, para não oscilar entre níveis a cada frame.
+// Degraus: 1 kernels menores, 2 + só regiões seguidas, 3 metade da resolução e só regiões
+// seguidas (os kernels já são reduzidos com a imagem), 4 + saltar uma frame em cada duas.
+
+#define VC_SCHED_RISK	0.9		// Fracção do orçamento a partir da qual a média está em risco
+#define VC_SCHED_SLACK	0.5		// Fracção do orçamento abaixo da qual há folga
+#define VC_SCHED_RELAX	30		// Frames seguidas com folga para descer um nível
+#define VC_SCHED_ALPHA	0.2		// Peso da última frame nas médias exponenciais
+
+static const int vc_sched_level_flags[VC_SCHED_LEVELS] = {
+	0,
+	VC_DEGRADE_KERNEL,
+	VC_DEGRADE_KERNEL | VC_DEGRADE_ROI,
+	VC_DEGRADE_ROI | VC_DEGRADE_PYRAMID,
+	VC_DEGRADE_ROI | VC_DEGRADE_PYRAMID | VC_DEGRADE_SKIP};
+
+// budget	: Orçamento por frame, em segundos (por exemplo 1.0 / 60.0)
+void vc_sched_init(SCHEDVC *sched, double budget)
+{
+	memset(sched, 0, sizeof(SCHEDVC));
+	sched->budget = budget;
+}
+
+// Início de uma frame: devolve as degradações a aplicar (VC_DEGRADE_*).
+// Com VC_DEGRADE_SKIP a frame não deve ser processada (mas vc_sched_end_frame é chamada na mesma).
+int vc_sched_begin_frame(SCHEDVC *sched)
+{
+	int i;
+
+	if (sched == NULL)
+		return 0;
+
+	sched->flags = vc_sched_level_flags[sched->level];
+
+	// No último nível só se salta uma frame em cada duas
+	if ((sched->flags & VC_DEGRADE_SKIP) && (sched->frame % 2 == 0))
+		sched->flags &= ~VC_DEGRADE_SKIP;
+
+	for (i = 0; i < VC_SCHED_STAGES; i++)
+		sched->stage[i] = 0.0;
+
+	sched->tstart = sched->tmark = VC_SECONDS();
+
+	return sched->flags;
+}
+
+// Fim de uma etapa: o tempo desde o fim da etapa anterior (ou do início da frame) é somado a 'stage'
+void vc_sched_stage_end(SCHEDVC *sched, int stage)
+{
+	double now;
+
+	if ((sched == NULL) || (stage < 0) || (stage >= VC_SCHED_STAGES))
+		return;
+
+	now = VC_SECONDS();
+	sched->stage[stage] += now - sched->tmark;
+	sched->tmark = now;
+}
+
+// Fim de uma frame: actualiza as médias e escolhe o nível de degradação da frame seguinte
+void vc_sched_end_frame(SCHEDVC *sched)
+{
+	int i;
+
+	if (sched == NULL)
+		return;
+
+	for (i = 0; i < VC_DEGRADE_COUNT; i++)
+		if (sched->flags & (1 << i))
+			sched->count[i]++;
+	sched->frame++;
+
+	// Frame saltada: não há tempos novos
+	if (sched->flags & VC_DEGRADE_SKIP)
+		return;
+
+	sched->total = VC_SECONDS() - sched->tstart;
+
+	for (i = 0; i < VC_SCHED_STAGES; i++)
+		sched->average[i] += VC_SCHED_ALPHA * (sched->stage[i] - sched->average[i]);
+
+	if (sched->predicted == 0.0)
+		sched->predicted = sched->total;
+	else
+		sched->predicted += VC_SCHED_ALPHA * (sched->total - sched->predicted);
+
+	if (sched->total > sched->budget)
+		sched->overruns++;
+
+	// Em risco: sobe um nível e recomeça a média (a duração muda com o nível)
+	if ((sched->total > sched->budget) || (sched->predicted > VC_SCHED_RISK * sched->budget))
+	{
+		sched->calm = 0;
+		if (sched->level < VC_SCHED_LEVELS - 1)
+		{
+			sched->level++;
+			sched->predicted = 0.0;
+		}
+	}
+	else if (sched->predicted < VC_SCHED_SLACK * sched->budget)
+	{
+		if ((++sched->calm >= VC_SCHED_RELAX) && (sched->level > 0))
+		{
+			sched->level--;
+			sched->predicted = 0.0;
+			sched->calm = 0;
+		}
+	}
+	else
+		sched->calm = 0;
+}
+
+// Mostra a última frame: duração, etapas e degradações aplicadas
+void vc_sched_print(SCHEDVC *sched)
+{
+	static const char *stages[VC_SCHED_STAGES] = {"segmentacao", "morfologia", "etiquetagem", "descodificacao"};
+	static const char *degrades[VC_DEGRADE_COUNT] = {"kernel", "roi", "piramide", "salto"};
+	int i;
+
+	if ((sched == NULL) || (sched->frame == 0))
+		return;
+
+	printf("Frame %d: ", sched->frame - 1);
+
+	if (sched->flags & VC_DEGRADE_SKIP)
+		printf("saltada");
+	else
+	{
+		printf("%.2f ms (orcamento %.2f ms) |", sched->total * 1000.0, sched->budget * 1000.0);
+		for (i = 0; i < VC_SCHED_STAGES; i++)
+			printf(" %s %.2f", stages[i], sched->stage[i] * 1000.0);
+	}
+
+	printf(" | degradacoes:");
+	if (sched->flags == 0)
+		printf(" nenhuma");
+	for (i = 0; i < VC_DEGRADE_COUNT; i++)
+		if (sched->flags & (1 << i))
+			printf(" %s", degrades[i]);
+	printf("\n");
+}
+
+// Mostra o resumo de todas as frames
+void vc_sched_summary(SCHEDVC *sched)
+{
+	static const char *degrades[VC_DEGRADE_COUNT] = {"kernel", "roi", "piramide", "salto"};
+	int i;
+
+	if (sched == NULL)
+		return;
+
+	printf("Escalonador: %d frames, %d acima do orcamento, nivel final %d\n", sched->frame, sched->overruns, sched->level);
+	for (i = 0; i < VC_DEGRADE_COUNT; i++)
+		printf("  %s: %d frames\n", degrades[i], sched->count[i]);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Pipeline de resistências
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Segmentação do corpo (HSV) -> fecho -> etiquetagem com filtro -> descodificação das bandas ao
+// longo do eixo maior de cada blob (orientação e eixos dos momentos, sem seguir o contorno).
+// As degradações do escalonador mudam o trabalho de cada frame sem mudar a interface: com
+// VC_DEGRADE_PYRAMID as três primeiras etapas correm a metade da resolução (os blobs são
+// devolvidos em coordenadas da frame e a descodificação amostra sempre a frame original); com
+// VC_DEGRADE_ROI só se processam as bounding boxes dos blobs da frame anterior, alargadas de
+// 'margin' pixéis, e a frame completa de 'refresh' em 'refresh' frames (para apanhar objectos
+// novos; refresh <= 0 nunca processa a frame completa).
+
+// Reduz src para metade da resolução (média de cada bloco 2x2)
+// dst		: Mesmo número de canais, com width = src->width / 2 e height = src->height / 2
+int vc_image_pyramid_down(IVC *src, IVC *dst)
+{
+	unsigned char *p0, *p1, *pd;
+	int x, y, c, nch;
+
+	// Verificação de erros
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return 0;
+	if ((dst->width != src->width / 2) || (dst->height != src->height / 2) || (dst->channels != src->channels))
+		return 0;
+
+	nch = src->channels;
+
+#ifdef _OPENMP
+#pragma omp parallel for private(x, c, p0, p1, pd)
+#endif
+	for (y = 0; y < dst->height; y++)
+	{
+		p0 = &src->data[2 * y * src->bytesperline];
+		p1 = p0 + src->bytesperline;
+		pd = &dst->data[y * dst->bytesperline];
+
+		for (x = 0; x < dst->width; x++, p0 += nch, p1 += nch)
+		{
+			for (c = 0; c < nch; c++, p0++, p1++)
+				*pd++ = (unsigned char)((p0[0] + p0[nch] + p1[0] + p1[nch] + 2) >> 2);
+		}
+	}
+
+	return 1;
+}
+
+RESISTORPIPEVC *vc_resistor_pipe_new(int width, int height)
+{
+	RESISTORPIPEVC *pipe;
+	int i, w, h;
+
+	// Verificação de erros
+	if ((width < 2) || (height < 2))
+		return NULL;
+
+	pipe = (RESISTORPIPEVC *)calloc(1, sizeof(RESISTORPIPEVC));
+	if (pipe == NULL)
+		return NULL;
+
+	pipe->hmin = 15;
+	pipe->hmax = 50;
+	pipe->smin = 15;
+	pipe->smax = 60;
+	pipe->vmin = 45;
+	pipe->vmax = 100;
+	pipe->closesize = 9;
+	vc_blob_filter_init(&pipe->filter);
+	pipe->filter.minarea = 1000;
+	pipe->margin = 32;
+	pipe->refresh = 8;
+
+	pipe->width = width;
+	pipe->height = height;
+	pipe->half = vc_image_new(width / 2, height / 2, 3, 255);
+	pipe->table = (unsigned char *)malloc(VC_RESISTOR_TABLE_SIZE);
+
+	for (i = 0; i < 2; i++)
+	{
+		w = (i == 0) ? width : width / 2;
+		h = (i == 0) ? height : height / 2;
+		pipe->mask[i] = vc_image_new(w, h, 1, 255);
+		pipe->tmp[i] = vc_image_new(w, h, 1, 255);
+		pipe->labels[i] = vc_image_new(w, h, 1, 255);
+		if ((pipe->mask[i] == NULL) || (pipe->tmp[i] == NULL) || (pipe->labels[i] == NULL))
+			return vc_resistor_pipe_free(pipe);
+	}
+
+	if ((pipe->half == NULL) || (pipe->table == NULL))
+		return vc_resistor_pipe_free(pipe);
+
+	vc_resistor_color_table(pipe->table);
+
+	return pipe;
+}
+
+RESISTORPIPEVC *vc_resistor_pipe_free(RESISTORPIPEVC *pipe)
+{
+	int i;
+
+	if (pipe != NULL)
+	{
+		for (i = 0; i < 2; i++)
+		{
+			vc_image_free(pipe->mask[i]);
+			vc_image_free(pipe->tmp[i]);
+			vc_image_free(pipe->labels[i]);
+		}
+		vc_image_free(pipe->half);
+		free(pipe->table);
+		free(pipe);
+	}
+
+	return NULL;
+}
+
+// Altera um parâmetro do pipeline a partir de texto (linha de comandos ou ficheiro de configuração)
+// key		: Nome do campo (hmin, hmax, smin, smax, vmin, vmax, closesize, minarea, maxarea,
+//			  minaspect, maxaspect, minfill, maxfill, margin, refresh), "hsv" (os 6 limites do
+//			  corpo), "roi" (x y largura altura do filtro) ou "band.<cor>" (intervalo HSV de uma cor
+//			  de banda, com os nomes de vc_resistor_band_name, por exemplo "band.vermelho")
+// value	: Valores separados por espaços
+// Devolve 0 se a chave não existir ou o valor for inválido (o pipeline fica como estava).
+int vc_resistor_pipe_set(RESISTORPIPEVC *pipe, const char *key, const char *value)
+{
+	// Campos por deslocamento em RESISTORPIPEVC: as tabelas não dependem de 'pipe' (que pode ser NULL)
+	static const struct
+	{
+		const char *name;
+		size_t offset;
+	} ints[] = {{"hmin", offsetof(RESISTORPIPEVC, hmin)}, {"hmax", offsetof(RESISTORPIPEVC, hmax)},
+				{"smin", offsetof(RESISTORPIPEVC, smin)}, {"smax", offsetof(RESISTORPIPEVC, smax)},
+				{"vmin", offsetof(RESISTORPIPEVC, vmin)}, {"vmax", offsetof(RESISTORPIPEVC, vmax)},
+				{"closesize", offsetof(RESISTORPIPEVC, closesize)},
+				{"minarea", offsetof(RESISTORPIPEVC, filter.minarea)}, {"maxarea", offsetof(RESISTORPIPEVC, filter.maxarea)},
+				{"margin", offsetof(RESISTORPIPEVC, margin)}, {"refresh", offsetof(RESISTORPIPEVC, refresh)}},
+	  floats[] = {{"minaspect", offsetof(RESISTORPIPEVC, filter.minaspect)}, {"maxaspect", offsetof(RESISTORPIPEVC, filter.maxaspect)},
+				  {"minfill", offsetof(RESISTORPIPEVC, filter.minfill)}, {"maxfill", offsetof(RESISTORPIPEVC, filter.maxfill)}};
+	int v[6], i;
+	char end;
+	float f;
+
+	// Verificação de erros
+	if ((pipe == NULL) || (key == NULL) || (value == NULL))
+		return 0;
+
+	for (i = 0; i < (int)(sizeof(ints) / sizeof(ints[0])); i++)
+	{
+		if (strcmp(key, ints[i].name) == 0)
+		{
+			if ((sscanf(value, "%d %c", &v[0], &end) != 1) || (v[0] < 0))
+				return 0;
+			*(int *)((char *)pipe + ints[i].offset) = v[0];
+			return 1;
+		}
+	}
+
+	for (i = 0; i < (int)(sizeof(floats) / sizeof(floats[0])); i++)
+	{
+		if (strcmp(key, floats[i].name) == 0)
+		{
+			if ((sscanf(value, "%f %c", &f, &end) != 1) || (f < 0.0f))
+				return 0;
+			*(float *)((char *)pipe + floats[i].offset) = f;
+			return 1;
+		}
+	}
+
+	if (strcmp(key, "hsv") == 0)
+	{
+		if (sscanf(value, "%d %d %d %d %d %d %c", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &end) != 6)
+			return 0;
+		pipe->hmin = v[0];
+		pipe->hmax = v[1];
+		pipe->smin = v[2];
+		pipe->smax = v[3];
+		pipe->vmin = v[4];
+		pipe->vmax = v[5];
+		return 1;
+	}
+
+	if (strcmp(key, "roi") == 0)
+	{
+		if ((sscanf(value, "%d %d %d %d %c", &v[0], &v[1], &v[2], &v[3], &end) != 4) || (v[2] < 0) || (v[3] < 0))
+			return 0;
+		pipe->filter.roi_x = v[0];
+		pipe->filter.roi_y = v[1];
+		pipe->filter.roi_width = v[2];
+		pipe->filter.roi_height = v[3];
+		return 1;
+	}
+
+	if (strncmp(key, "band.", 5) == 0)
+	{
+		for (i = 0; i <= VC_BAND_NONE; i++)
+			if (strcmp(key + 5, vc_resistor_band_name(i)) == 0)
+				break;
+		if ((i > VC_BAND_NONE) || (sscanf(value, "%d %d %d %d %d %d %c", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &end) != 6))
+			return 0;
+		return vc_resistor_color_table_range(pipe->table, i, v[0], v[1], v[2], v[3], v[4], v[5]);
+	}
+
+	return 0;
+}
+
+// Vista de uma região de uma imagem (partilha os dados; bytesperline é o da imagem)
+static IVC vc_image_view(IVC *image, int x, int y, int width, int height)
+{
+	IVC view = *image;
+
+	view.data = &image->data[y * image->bytesperline + x * image->channels];
+	view.width = width;
+	view.height = height;
+
+	return view;
+}
+
+// Regiões dos blobs seguidos, na escala da imagem (coordenadas da frame reduzidas por 'shift').
+// As regiões que se sobrepõem são juntadas, para nenhum pixel ser processado duas vezes.
+// rects	: x0, y0, x1, y1 de cada região (no máximo VC_RESISTOR_PIPE_MAX)
+static int vc_resistor_pipe_rois(RESISTORPIPEVC *pipe, IVC *image, int shift, int *rects)
+{
+	OVC *b;
+	int i, j, n, *r, *q;
+
+	for (i = 0, n = 0; i < pipe->nfound; i++)
+	{
+		b = &pipe->blobs[i];
+		r = &rects[4 * n];
+		r[0] = MY_MAX((b->x - pipe->margin) >> shift, 0);
+		r[1] = MY_MAX((b->y - pipe->margin) >> shift, 0);
+		r[2] = MY_MIN((b->x + b->width + pipe->margin) >> shift, image->width);
+		r[3] = MY_MIN((b->y + b->height + pipe->margin) >> shift, image->height);
+		if ((r[2] <= r[0]) || (r[3] <= r[1]))
+			continue;
+
+		// Junta com as regiões anteriores; a união pode tocar noutras, por isso recomeça
+		for (j = 0; j < n;)
+		{
+			q = &rects[4 * j];
+			if ((q[0] < r[2]) && (r[0] < q[2]) && (q[1] < r[3]) && (r[1] < q[3]))
+			{
+				r[0] = MY_MIN(r[0], q[0]);
+				r[1] = MY_MIN(r[1], q[1]);
+				r[2] = MY_MAX(r[2], q[2]);
+				r[3] = MY_MAX(r[3], q[3]);
+				memmove(q, &rects[4 * (n - 1)], 4 * sizeof(int));
+				memcpy(&rects[4 * (n - 1)], r, 4 * sizeof(int));
+				r = &rects[4 * (n - 1)];
+				n--;
+				j = 0;
+			}
+			else
+				j++;
+		}
+		n++;
+	}
+
+	return n;
+}
+
+// Processa uma frame (3 ou 4 canais, na ordem 'order', com o tamanho dado a vc_resistor_pipe_new)
+// sched	: Escalonador (NULL = qualidade máxima, sem medições)
+// Os resultados ficam em pipe->nfound, pipe->blobs e pipe->resistors. Se falhar depois de
+// começar a frame, devolve 0 com pipe->nfound = 0 e a frame é terminada no escalonador.
+int vc_resistor_pipe_run(RESISTORPIPEVC *pipe, IVC *frame, int order, SCHEDVC *sched)
+{
+	BLOBFILTERVC filter;
+	IVC *src, *mask, *tmp, *labels;
+	IVC vs, vm, vt;
+	OVC *blobs, *b;
+	int rects[4 * VC_RESISTOR_PIPE_MAX];
+	int flags, shift, kernel, nrects, i, n, *r;
+	float scale;
+
+	// Verificação de erros
+	if ((pipe == NULL) || !vc_order_check(frame, order))
+		return 0;
+	if ((frame->width != pipe->width) || (frame->height != pipe->height))
+		return 0;
+
+	flags = vc_sched_begin_frame(sched);
+	if (flags & VC_DEGRADE_SKIP)
+	{
+		vc_sched_end_frame(sched);
+		return 1;
+	}
+
+	shift = (flags & VC_DEGRADE_PYRAMID) ? 1 : 0;
+	src = frame;
+	mask = pipe->mask[shift];
+	tmp = pipe->tmp[shift];
+	labels = pipe->labels[shift];
+
+	// Segmentação do corpo
+	if (shift)
+	{
+		if (pipe->half->channels != frame->channels)
+		{
+			vc_image_free(pipe->half);
+			if ((pipe->half = vc_image_new(frame->width / 2, frame->height / 2, frame->channels, 255)) == NULL)
+			{
+				pipe->nfound = 0;
+				vc_sched_end_frame(sched);
+				return 0;
+			}
+		}
+		src = pipe->half;
+		vc_image_pyramid_down(frame, src);
+	}
+
+	// Fora do modo ROI, a frame inteira é uma região
+	nrects = 1;
+	rects[0] = rects[1] = 0;
+	rects[2] = src->width;
+	rects[3] = src->height;
+	if ((flags & VC_DEGRADE_ROI) && ((pipe->refresh <= 0) || (pipe->frame % pipe->refresh != 0)))
+	{
+		memset(mask->data, 0, mask->bytesperline * mask->height);
+		nrects = vc_resistor_pipe_rois(pipe, src, shift, rects);
+	}
+
+	for (i = 0; i < nrects; i++)
+	{
+		r = &rects[4 * i];
+		vs = vc_image_view(src, r[0], r[1], r[2] - r[0], r[3] - r[1]);
+		vm = vc_image_view(mask, r[0], r[1], r[2] - r[0], r[3] - r[1]);
+		if (!vc_color_hsv_segmentation(&vs, &vm, order, pipe->hmin, pipe->hmax, pipe->smin, pipe->smax, pipe->vmin, pipe->vmax))
+		{
+			pipe->nfound = 0;
+			vc_sched_end_frame(sched);
+			return 0;
+		}
+	}
+	vc_sched_stage_end(sched, VC_SCHED_SEGMENT);
+
+	// Fecho (dilatação seguida de erosão). O kernel é reduzido com a imagem e, com
+	// VC_DEGRADE_KERNEL, passa ao tamanho ímpar anterior. As regiões são faixas de linhas
+	// completas (o caminho genérico da erosão copia linhas inteiras).
+	kernel = (pipe->closesize >> shift) | 1;
+	if ((flags & VC_DEGRADE_KERNEL) && (kernel > 3))
+		kernel -= 2;
+	for (i = 0; (i < nrects) && (pipe->closesize > 1); i++)
+	{
+		r = &rects[4 * i];
+		vm = vc_image_view(mask, 0, r[1], mask->width, r[3] - r[1]);
+		vt = vc_image_view(tmp, 0, r[1], tmp->width, r[3] - r[1]);
+		vc_binary_dilate(&vm, &vt, kernel);
+		vc_binary_erode(&vt, &vm, kernel);
+	}
+	vc_sched_stage_end(sched, VC_SCHED_MORPH);
+
+	// Etiquetagem com o filtro na escala da imagem etiquetada
+	filter = pipe->filter;
+	filter.minarea >>= 2 * shift;
+	filter.maxarea >>= 2 * shift;
+	filter.roi_x >>= shift;
+	filter.roi_y >>= shift;
+	filter.roi_width >>= shift;
+	filter.roi_height >>= shift;
+
+	blobs = vc_binary_blob_labelling_filtered(mask, labels, &n, &filter);
+	pipe->nfound = MY_MIN(n, VC_RESISTOR_PIPE_MAX);
+	scale = (float)(1 << shift);
+	for (i = 0; i < pipe->nfound; i++)
+	{
+		b = &pipe->blobs[i];
+		*b = blobs[i];
+		b->x <<= shift;
+		b->y <<= shift;
+		b->width <<= shift;
+		b->height <<= shift;
+		b->xc <<= shift;
+		b->yc <<= shift;
+		b->cx *= scale;
+		b->cy *= scale;
+		b->area <<= 2 * shift;
+		b->perimeter <<= shift;
+		b->mu20 *= scale * scale;
+		b->mu02 *= scale * scale;
+		b->mu11 *= scale * scale;
+		b->major *= scale;
+		b->minor *= scale;
+	}
+	free(blobs);
+	vc_sched_stage_end(sched, VC_SCHED_LABEL);
+
+	// Bandas: comprimento e largura do rectângulo com os mesmos momentos (sqrt(12 * l) = major * sqrt(3) / 2)
+	for (i = 0; i < pipe->nfound; i++)
+	{
+		b = &pipe->blobs[i];
+		vc_resistor_decode_axis(frame, order, (float)b->xc, (float)b->yc, b->angle, b->major * 0.866f, b->minor * 0.866f,
+								pipe->table, &pipe->resistors[i]);
+	}
+	vc_sched_stage_end(sched, VC_SCHED_DECODE);
+
+	pipe->frame++;
+	vc_sched_end_frame(sched);
+
+	return 1;
+}
+
+// Processa uma frame em cada um de n pipelines (fontes de vídeo independentes), em paralelo.
+// Cada pipeline tem o seu estado (buffers, blobs seguidos) e o seu escalonador, por isso as
+// fontes não partilham nada além das threads. As fontes são distribuídas uma a uma pelas
+// threads livres (schedule dynamic) e a primeira fonte de cada ronda roda ('first'), para que,
+// com mais fontes do que threads, nenhuma fique sempre para o fim. Dentro de cada pipeline os
+// ciclos OpenMP correm em série (paralelismo encaixado desligado), sem disputa pelas threads.
+// frames	: frames[i] == NULL salta a fonte i nesta ronda (por exemplo, vídeo terminado)
+// scheds	: Escalonador de cada fonte (NULL, ou scheds[i] == NULL, para qualidade máxima)
+// Devolve o número de frames processadas (-1 se algum pipeline falhar).
+int vc_resistor_pipe_run_many(RESISTORPIPEVC **pipes, IVC **frames, int order, SCHEDVC **scheds, int n, int first)
+{
+	int k, i, done = 0, failed = 0;
+
+	// Verificação de erros
+	if ((pipes == NULL) || (frames == NULL) || (n <= 0))
+		return 0;
+
+	first = ((first % n) + n) % n;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) private(i) reduction(+ : done, failed)
+#endif
+	for (k = 0; k < n; k++)
+	{
+		i = (first + k) % n;
+		if ((pipes[i] == NULL) || (frames[i] == NULL))
+			continue;
+
+		if (vc_resistor_pipe_run(pipes[i], frames[i], order, (scheds != NULL) ? scheds[i] : NULL))
+			done++;
+		else
+			failed++;
+	}
+
+	return failed ? -1 : done;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Avaliação do pipeline (anotações e desempenho)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Ficheiro de anotações (ground truth): uma resistência por linha,
+//		frame x y largura altura [valor]
+// com o número da frame a começar em 1 (o de CAP_PROP_POS_FRAMES depois de ler a frame), a
+// bounding box em pixéis e o valor em ohms (0 ou ausente = não avaliado). Linhas vazias e
+// começadas por '#' são ignoradas.
+
+#define VC_SCORE_IOU	0.5f	// Sobreposição mínima (intersecção / união) para uma detecção contar
+
+// Ordena as anotações por frame
+static int vc_annotation_compare(const void *a, const void *b)
+{
+	return ((const ANNOTVC *)a)->frame - ((const ANNOTVC *)b)->frame;
+}
+
+// Lê um ficheiro de anotações; devolve o vector (ordenado por frame, libertar com free) ou NULL
+ANNOTVC *vc_annotations_read(const char *filename, int *nannotations)
+{
+	FILE *file;
+	ANNOTVC *annotations = NULL, *tmp, a;
+	char line[256];
+	int n = 0, capacity = 0, nline = 0, k;
+
+	*nannotations = 0;
+
+	if ((file = fopen(filename, "r")) == NULL)
+		return NULL;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		nline++;
+		a.value = 0.0;
+		k = sscanf(line, "%d %d %d %d %d %lf", &a.frame, &a.x, &a.y, &a.width, &a.height, &a.value);
+		if (k <= 0)
+			continue; // Linha vazia ou comentário
+		if ((k < 5) || (a.width <= 0) || (a.height <= 0))
+		{
+#ifdef VC_DEBUG
+			printf("ERROR -> vc_annotations_read():\n\t%s:%d: anotação inválida.\n", filename, nline);
+#endif
+			free(annotations);
+			fclose(file);
+			return NULL;
+		}
+
+		if (n == capacity)
+		{
+			capacity = (capacity == 0) ? 64 : 2 * capacity;
+			tmp = (ANNOTVC *)realloc(annotations, capacity * sizeof(ANNOTVC));
+			if (tmp == NULL)
+			{
+				free(annotations);
+				fclose(file);
+				return NULL;
+			}
+			annotations = tmp;
+		}
+		annotations[n++] = a;
+	}
+
+	fclose(file);
+
+	if (n > 0)
+		qsort(annotations, n, sizeof(ANNOTVC), vc_annotation_compare);
+
+	*nannotations = n;
+
+	return annotations;
+}
+
+void vc_score_init(SCOREVC *score)
+{
+	memset(score, 0, sizeof(SCOREVC));
+}
+
+void vc_score_free(SCOREVC *score)
+{
+	free(score->latency);
+	vc_score_init(score);
+}
+
+// Intersecção / união de duas bounding boxes
+static float vc_score_iou(int ax, int ay, int aw, int ah, int bx, int by, int bw, int bh)
+{
+	int w = MY_MIN(ax + aw, bx + bw) - MY_MAX(ax, bx);
+	int h = MY_MIN(ay + ah, by + bh) - MY_MAX(ay, by);
+	float inter;
+
+	if ((w <= 0) || (h <= 0))
+		return 0.0f;
+
+	inter = (float)w * (float)h;
+
+	return inter / ((float)aw * ah + (float)bw * bh - inter);
+}
+
+// Acumula uma frame: compara os resultados do pipeline com as anotações dessa frame e guarda a
+// latência. Cada anotação fica com a detecção livre de maior sobreposição (>= VC_SCORE_IOU);
+// detecções sem anotação são falsos positivos e anotações sem detecção são falsos negativos.
+// annotations	: Vector de vc_annotations_read (NULL = só latência e número de detecções)
+// latency		: Duração do processamento da frame, em segundos
+int vc_score_frame(SCOREVC *score, RESISTORPIPEVC *pipe, int frame, const ANNOTVC *annotations, int nannotations, double latency)
+{
+	unsigned char used[VC_RESISTOR_PIPE_MAX] = {0};
+	const ANNOTVC *a;
+	OVC *b;
+	double *tmp;
+	float iou, best;
+	int i, j, k, first;
+
+	// Verificação de erros
+	if ((score == NULL) || (pipe == NULL))
+		return 0;
+
+	if (score->nframes == score->capacity)
+	{
+		score->capacity = (score->capacity == 0) ? 256 : 2 * score->capacity;
+		tmp = (double *)realloc(score->latency, score->capacity * sizeof(double));
+		if (tmp == NULL)
+			return 0;
+		score->latency = tmp;
+	}
+	score->latency[score->nframes++] = latency;
+	score->total += latency;
+	score->detections += pipe->nfound;
+
+	if (annotations == NULL)
+		return 1;
+
+	// Primeira anotação da frame (o vector está ordenado por frame)
+	for (i = 0, j = nannotations; i < j;)
+	{
+		k = (i + j) / 2;
+		if (annotations[k].frame < frame)
+			i = k + 1;
+		else
+			j = k;
+	}
+	first = i;
+
+	for (i = first; (i < nannotations) && (annotations[i].frame == frame); i++)
+	{
+		a = &annotations[i];
+
+		for (j = 0, k = -1, best = VC_SCORE_IOU; j < pipe->nfound; j++)
+		{
+			b = &pipe->blobs[j];
+			if (used[j])
+				continue;
+
+			iou = vc_score_iou(a->x, a->y, a->width, a->height, b->x, b->y, b->width, b->height);
+			if (iou >= best)
+			{
+				best = iou;
+				k = j;
+			}
+		}
+
+		if (k < 0)
+		{
+			score->fn++;
+			continue;
+		}
+
+		used[k] = 1;
+		score->tp++;
+		if (a->value > 0.0)
+		{
+			score->valued++;
+			if (fabs(pipe->resistors[k].value - a->value) <= 1e-6 * a->value)
+				score->correct++;
+		}
+	}
+
+	score->fp += pipe->nfound;
+	for (j = 0; j < pipe->nfound; j++)
+		score->fp -= used[j];
+
+	return 1;
+}
+
+static int vc_score_compare(const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+
+	return (da > db) - (da < db);
+}
+
+// Percentil p (em [0, 100]) da latência das frames acumuladas, em segundos (nearest-rank)
+double vc_score_percentile(SCOREVC *score, double p)
+{
+	double *sorted, value;
+	int k;
+
+	if ((score == NULL) || (score->nframes == 0))
+		return 0.0;
+
+	sorted = (double *)malloc(score->nframes * sizeof(double));
+	if (sorted == NULL)
+		return 0.0;
+	memcpy(sorted, score->latency, score->nframes * sizeof(double));
+	qsort(sorted, score->nframes, sizeof(double), vc_score_compare);
+
+	k = (int)ceil(p / 100.0 * score->nframes) - 1;
+	value = sorted[MY_MIN(MY_MAX(k, 0), score->nframes - 1)];
+	free(sorted);
+
+	return value;
+}
+
+// F1 das detecções (média harmónica da precisão e da cobertura)
+double vc_score_f1(SCOREVC *score)
+{
+	int d = 2 * score->tp + score->fp + score->fn;
+
+	return (d > 0) ? 2.0 * score->tp / d : 0.0;
+}
+
+// Fronteira de Pareto de n pontos, maximizando x e y: front[i] = 1 se nenhum outro ponto for
+// pelo menos tão bom nas duas coordenadas e melhor numa delas
+// Devolve o número de pontos na fronteira.
+int vc_pareto_front(const double *x, const double *y, int n, int *front)
+{
+	int i, j, count = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		front[i] = 1;
+		for (j = 0; (j < n) && front[i]; j++)
+		{
+			if ((x[j] >= x[i]) && (y[j] >= y[i]) && ((x[j] > x[i]) || (y[j] > y[i])))
+				front[i] = 0;
+		}
+		count += front[i];
+	}
+
+	return count;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Arquivo de frames descodificadas (raw)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Ficheiro com as frames de um vídeo já descodificadas, para as repetir sem voltar a
+// descodificar o vídeo. Cabeçalho fixo de VC_FRAMES_HEADER bytes:
+//		"VCFRAMES" | versão | largura | altura | canais | fps | número de frames | 0 ...
+// (inteiros de 32 bits little-endian), seguido das frames, contíguas e sem padding por linha
+// (largura * altura * canais bytes cada, na ordem de canais da fonte; BGR no OpenCV).
+// Na leitura o ficheiro é mapeado em memória (mmap / MapViewOfFile): as frames são lidas do
+// disco (ou da cache do sistema) à medida que são usadas, sem cópias, e abrir um arquivo de
+// vários GB é imediato. O mapeamento é só de leitura (as páginas ficam na cache do sistema e
+// não crescem com o uso): para desenhar numa frame, copia-a primeiro. Se não for possível
+// mapear o ficheiro, as frames são lidas para memória.
+
+#define VC_FRAMES_MAGIC		"VCFRAMES"
+#define VC_FRAMES_VERSION	1
+
+static void vc_frames_put_int(unsigned char *p, int v)
+{
+	p[0] = (unsigned char)(v & 0xff);
+	p[1] = (unsigned char)((v >> 8) & 0xff);
+	p[2] = (unsigned char)((v >> 16) & 0xff);
+	p[3] = (unsigned char)((v >> 24) & 0xff);
+}
+
+static int vc_frames_get_int(const unsigned char *p)
+{
+	return (int)((unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+// Escreve o cabeçalho no início do ficheiro
+static int vc_frames_write_header(FILE *file, FRAMESVC *frames)
+{
+	unsigned char header[VC_FRAMES_HEADER] = {0};
+
+	memcpy(header, VC_FRAMES_MAGIC, 8);
+	vc_frames_put_int(&header[8], VC_FRAMES_VERSION);
+	vc_frames_put_int(&header[12], frames->width);
+	vc_frames_put_int(&header[16], frames->height);
+	vc_frames_put_int(&header[20], frames->channels);
+	vc_frames_put_int(&header[24], frames->fps);
+	vc_frames_put_int(&header[28], frames->nframes);
+
+	return (fseek(file, 0, SEEK_SET) == 0) && (fwrite(header, 1, VC_FRAMES_HEADER, file) == VC_FRAMES_HEADER);
+}
+
+// Cria um arquivo para escrita (as frames são acrescentadas com vc_frames_append)
+FRAMESVC *vc_frames_create(const char *filename, int width, int height, int channels, int fps)
+{
+	FRAMESVC *frames;
+	FILE *file;
+
+	// Verificação de erros
+	if ((width <= 0) || (height <= 0) || (channels <= 0) || (channels > 4))
+		return NULL;
+
+	if ((file = fopen(filename, "wb")) == NULL)
+		return NULL;
+
+	frames = (FRAMESVC *)calloc(1, sizeof(FRAMESVC));
+	if (frames == NULL)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	frames->width = width;
+	frames->height = height;
+	frames->channels = channels;
+	frames->fps = fps;
+	frames->framesize = width * height * channels;
+	frames->file = file;
+
+	if (!vc_frames_write_header(file, frames))
+		return vc_frames_close(frames);
+
+	return frames;
+}
+
+// Acrescenta uma frame (com as dimensões e os canais do arquivo) ao fim do arquivo
+int vc_frames_append(FRAMESVC *frames, IVC *frame)
+{
+	int y, rowsize;
+
+	// Verificação de erros
+	if ((frames == NULL) || (frames->file == NULL) || (frame == NULL) || (frame->data == NULL))
+		return 0;
+	if ((frame->width != frames->width) || (frame->height != frames->height) || (frame->channels != frames->channels))
+		return 0;
+
+	rowsize = frame->width * frame->channels;
+	for (y = 0; y < frame->height; y++)
+		if (fwrite(&frame->data[y * frame->bytesperline], 1, rowsize, (FILE *)frames->file) != (size_t)rowsize)
+			return 0;
+
+	frames->nframes++;
+
+	return 1;
+}
+
+// Mapeia o ficheiro todo em memória, só para leitura.
+// Devolve o endereço do início do ficheiro, ou NULL.
+static unsigned char *vc_frames_map(const char *filename, size_t *size)
+{
+	unsigned char *base = NULL;
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER length;
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (GetFileSizeEx(file, &length) && (length.QuadPart > 0))
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL)
+		{
+			base = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			*size = (size_t)length.QuadPart;
+		}
+	}
+	CloseHandle(file);
+#else
+	struct stat st;
+	void *p;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0)
+		return NULL;
+
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	{
+		p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			base = (unsigned char *)p;
+			*size = (size_t)st.st_size;
+#ifdef MADV_SEQUENTIAL
+			madvise(p, *size, MADV_SEQUENTIAL);
+#endif
+		}
+	}
+	close(fd);
+#endif
+
+	return base;
+}
+
+static void vc_frames_unmap(unsigned char *base, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(base);
+#else
+	munmap(base, size);
+#endif
+}
+
+// Lê os campos do cabeçalho. Devolve 0 se não for um arquivo válido.
+static int vc_frames_read_header(const unsigned char *header, FRAMESVC *frames)
+{
+	if ((memcmp(header, VC_FRAMES_MAGIC, 8) != 0) || (vc_frames_get_int(&header[8]) != VC_FRAMES_VERSION))
+		return 0;
+
+	frames->width = vc_frames_get_int(&header[12]);
+	frames->height = vc_frames_get_int(&header[16]);
+	frames->channels = vc_frames_get_int(&header[20]);
+	frames->fps = vc_frames_get_int(&header[24]);
+	frames->nframes = vc_frames_get_int(&header[28]);
+	frames->framesize = frames->width * frames->height * frames->channels;
+
+	return (frames->width > 0) && (frames->height > 0) && (frames->channels > 0) && (frames->nframes >= 0);
+}
+
+// Abre um arquivo para leitura (mapeado em memória, ou lido todo para memória)
+FRAMESVC *vc_frames_open(const char *filename)
+{
+	unsigned char header[VC_FRAMES_HEADER];
+	FRAMESVC *frames;
+	FILE *file;
+	size_t size, mapsize = 0;
+	unsigned char *base;
+
+	frames = (FRAMESVC *)calloc(1, sizeof(FRAMESVC));
+	if (frames == NULL)
+		return NULL;
+
+	// Mapeamento: o ficheiro tem de ter todas as frames indicadas no cabeçalho
+	base = vc_frames_map(filename, &mapsize);
+	if (base != NULL)
+	{
+		if ((mapsize < VC_FRAMES_HEADER) || !vc_frames_read_header(base, frames) ||
+			(mapsize - VC_FRAMES_HEADER < (size_t)frames->framesize * frames->nframes))
+		{
+			vc_frames_unmap(base, mapsize);
+			free(frames);
+			return NULL;
+		}
+
+		frames->map = base;
+		frames->mapsize = (long long)mapsize;
+		frames->data = base + VC_FRAMES_HEADER;
+
+		return frames;
+	}
+
+	// Sem mapeamento: lê as frames todas
+	if ((file = fopen(filename, "rb")) == NULL)
+	{
+		free(frames);
+		return NULL;
+	}
+
+	if ((fread(header, 1, VC_FRAMES_HEADER, file) != VC_FRAMES_HEADER) || !vc_frames_read_header(header, frames))
+	{
+		free(frames);
+		fclose(file);
+		return NULL;
+	}
+
+	size = (size_t)frames->framesize * frames->nframes;
+	if (((frames->data = (unsigned char *)malloc(size > 0 ? size : 1)) == NULL) || (fread(frames->data, 1, size, file) != size))
+	{
+		fclose(file);
+		return vc_frames_close(frames);
+	}
+
+	fclose(file);
+
+	return frames;
+}
+
+// Fecha um arquivo: na escrita actualiza o número de frames no cabeçalho; na leitura liberta as frames
+FRAMESVC *vc_frames_close(FRAMESVC *frames)
+{
+	if (frames != NULL)
+	{
+		if (frames->file != NULL)
+		{
+			vc_frames_write_header((FILE *)frames->file, frames);
+			fclose((FILE *)frames->file);
+		}
+		if (frames->map != NULL)
+			vc_frames_unmap((unsigned char *)frames->map, (size_t)frames->mapsize);
+		else
+			free(frames->data);
+		free(frames);
+	}
+
+	return NULL;
+}
+
+// Vista (sem cópia) da frame 'index' de um arquivo aberto para leitura (a frame não pode ser alterada)
+int vc_frames_get(FRAMESVC *frames, int index, IVC *frame)
+{
+	// Verificação de erros
+	if ((frames == NULL) || (frames->data == NULL) || (frame == NULL) || (index < 0) || (index >= frames->nframes))
+		return 0;
+
+	frame->data = &frames->data[(size_t)index * frames->framesize];
+	frame->width = frames->width;
+	frame->height = frames->height;
+	frame->channels = frames->channels;
+	frame->levels = 255;
+	frame->bytesperline = frames->width * frames->channels;
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Regressão com checksums de referência
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// vc_regress_frame corre os operadores da biblioteca e o pipeline completo sobre uma frame e
+// devolve um checksum (FNV-1a) do resultado de cada verificação. Gravados uma vez com a versão
+// de referência (escalar, uma thread), os checksums permitem validar bit a bit as versões SIMD,
+// paralelas e fundidas, que têm de dar exactamente os mesmos valores. Nas imagens só entram os
+// pixéis (não o padding das linhas); nos blobs e resistências só os campos inteiros e os
+// valores reais arredondados, que não dependem da contracção de operações em vírgula flutuante.
+// Uma verificação cujo operador falhe tem checksum 0.
+
+#define VC_FNV_BASIS	2166136261u
+#define VC_FNV_PRIME	16777619u
+
+static const char *vc_regress_names[] = {
+	"rgb_to_gray", "rgb_to_hsv", "rgb_negative", "hsv_segmentation",
+	"gray_to_binary", "otsu", "triangle", "niblack", "histogram", "equalization", "clahe", "lut_false_color",
+	"binary_dilate_3", "binary_dilate_11", "binary_erode_5", "binary_close_9", "gray_erode_5", "gray_dilate_5",
+	"distance_euclidean", "distance_chamfer", "close_disc_4", "pyramid_down", "warp_oriented",
+	"labelling", "labelling_stripes_1", "labelling_stripes_4", "labelling_filtered", "rle_labelling", "rle_dilate_5",
+	"ccl_incremental", "stream", "graph", "pipeline"};
+
+#define VC_REGRESS_CHECKS	((int)(sizeof(vc_regress_names) / sizeof(vc_regress_names[0])))
+
+// Acumula 'size' bytes num checksum FNV-1a (hash = VC_FNV_BASIS no início)
+unsigned int vc_checksum(const void *data, int size, unsigned int hash)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	int i;
+
+	for (i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= VC_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+// Checksum dos pixéis de uma imagem (o padding das linhas é ignorado)
+unsigned int vc_image_checksum(IVC *image)
+{
+	unsigned int hash = VC_FNV_BASIS;
+	int y;
+
+	if ((image == NULL) || (image->data == NULL))
+		return 0;
+
+	for (y = 0; y < image->height; y++)
+		hash = vc_checksum(&image->data[y * image->bytesperline], image->width * image->channels, hash);
+
+	return hash;
+}
+
+int vc_regress_count(void)
+{
+	return VC_REGRESS_CHECKS;
+}
+
+const char *vc_regress_name(int check)
+{
+	if ((check < 0) || (check >= VC_REGRESS_CHECKS))
+		return "?";
+
+	return vc_regress_names[check];
+}
+
+static unsigned int vc_regress_int(int v, unsigned int hash)
+{
+	return vc_checksum(&v, sizeof(int), hash);
+}
+
+// Campos inteiros dos blobs (e a orientação em centésimos de grau)
+static unsigned int vc_regress_blobs(OVC *blobs, int n, unsigned int hash)
+{
+	int i;
+
+	hash = vc_regress_int(n, hash);
+	for (i = 0; (i < n) && (blobs != NULL); i++)
+	{
+		hash = vc_regress_int(blobs[i].x, hash);
+		hash = vc_regress_int(blobs[i].y, hash);
+		hash = vc_regress_int(blobs[i].width, hash);
+		hash = vc_regress_int(blobs[i].height, hash);
+		hash = vc_regress_int(blobs[i].area, hash);
+		hash = vc_regress_int(blobs[i].xc, hash);
+		hash = vc_regress_int(blobs[i].yc, hash);
+		hash = vc_regress_int(blobs[i].perimeter, hash);
+		hash = vc_regress_int(blobs[i].label, hash);
+		hash = vc_regress_int((int)floor(blobs[i].angle * 100.0f + 0.5f), hash);
+	}
+
+	return hash;
+}
+
+// Copia as linhas de src para dst (mesmas dimensões e canais)
+static void vc_regress_copy(IVC *src, IVC *dst)
+{
+	int y;
+
+	for (y = 0; y < src->height; y++)
+		memcpy(&dst->data[y * dst->bytesperline], &src->data[y * src->bytesperline], src->width * src->channels);
+}
+
+// Corre todas as verificações sobre uma frame de 3 canais (na ordem 'order')
+// checksums	: vc_regress_count() valores
+// Devolve o número de verificações feitas (0 se a frame não for válida).
+int vc_regress_frame(IVC *frame, int order, unsigned int *checksums)
+{
+	unsigned char lut3[768];
+	int hist[256];
+	IVC *gray, *mask, *closed, *bin, *tmp, *img3, *labels, *half, *strip;
+	OVC *blobs;
+	RLEVC *rle, *rle2;
+	CCLVC *ccl;
+	STREAMVC *stream;
+	GRAPHVC *graph;
+	RESISTORPIPEVC *pipe;
+	BLOBFILTERVC filter;
+	IVC *ins[1], *outs[1];
+	int *dist;
+	int w, h, n, i, ok, node, threshold = 128;
+	unsigned int hash;
+
+	// Verificação de erros
+	if ((frame == NULL) || (frame->channels != 3) || (frame->width < 2) || (frame->height < 2) || (checksums == NULL))
+		return 0;
+
+	w = frame->width;
+	h = frame->height;
+	gray = vc_image_new(w, h, 1, 255);
+	mask = vc_image_new(w, h, 1, 255);
+	closed = vc_image_new(w, h, 1, 255);
+	bin = vc_image_new(w, h, 1, 255);
+	tmp = vc_image_new(w, h, 1, 255);
+	labels = vc_image_new(w, h, 1, 255);
+	img3 = vc_image_new(w, h, 3, 255);
+	half = vc_image_new(w / 2, h / 2, 3, 255);
+	strip = vc_image_new(96, 24, 3, 255);
+	dist = (int *)malloc(w * h * sizeof(int));
+	rle = vc_rle_new(w, h, 0);
+	rle2 = vc_rle_new(w, h, 0);
+	if ((gray == NULL) || (mask == NULL) || (closed == NULL) || (bin == NULL) || (tmp == NULL) || (labels == NULL) ||
+		(img3 == NULL) || (half == NULL) || (strip == NULL) || (dist == NULL) || (rle == NULL) || (rle2 == NULL))
+	{
+		n = 0;
+		goto end;
+	}
+
+	n = 0;
+#define VC_REGRESS_IMAGE(call, image) checksums[n++] = (call) ? vc_image_checksum(image) : 0
+
+	// Cor
+	VC_REGRESS_IMAGE(vc_rgb_to_gray(frame, gray, order), gray);
+	vc_regress_copy(frame, img3);
+	VC_REGRESS_IMAGE(vc_rgb_to_hsv_order(img3, order), img3);
+	vc_regress_copy(frame, img3);
+	VC_REGRESS_IMAGE(vc_rgb_negative_order(img3, order), img3);
+	VC_REGRESS_IMAGE(vc_color_hsv_segmentation(frame, mask, order, 15, 50, 15, 60, 45, 100), mask);
+
+	// Limiares, histograma e tabelas
+	VC_REGRESS_IMAGE(vc_gray_to_binary_src_dst(gray, bin, 128), bin);
+	VC_REGRESS_IMAGE(vc_gray_to_binary_otsu(gray, bin), bin);
+	VC_REGRESS_IMAGE(vc_gray_to_binary_triangle(gray, bin), bin);
+	VC_REGRESS_IMAGE(vc_gray_to_binary_niblack(gray, bin, 7, -0.2f), bin);
+	ok = vc_gray_histogram(gray, hist);
+	checksums[n++] = ok ? vc_checksum(hist, sizeof(hist), VC_FNV_BASIS) : 0;
+	VC_REGRESS_IMAGE(vc_gray_histogram_equalization(gray, tmp), tmp);
+	VC_REGRESS_IMAGE(vc_gray_clahe(gray, tmp, 8, 8, 2.0f), tmp);
+	vc_lut_false_color(lut3);
+	VC_REGRESS_IMAGE(vc_lut_gray_to_rgb(gray, img3, lut3), img3);
+
+	// Morfologia (kernels especializados e caminho genérico)
+	VC_REGRESS_IMAGE(vc_binary_dilate(mask, tmp, 3), tmp);
+	VC_REGRESS_IMAGE(vc_binary_dilate(mask, tmp, 11), tmp);
+	VC_REGRESS_IMAGE(vc_binary_erode(mask, tmp, 5), tmp);
+	VC_REGRESS_IMAGE(vc_binary_close(mask, closed, 9, 9), closed);
+	VC_REGRESS_IMAGE(vc_gray_erode(gray, tmp, 5), tmp);
+	VC_REGRESS_IMAGE(vc_gray_dilate(gray, tmp, 5), tmp);
+	ok = vc_binary_distance_transform(mask, dist, VC_DIST_EUCLIDEAN);
+	checksums[n++] = ok ? vc_checksum(dist, w * h * sizeof(int), VC_FNV_BASIS) : 0;
+	ok = vc_binary_distance_transform(mask, dist, VC_DIST_CHAMFER34);
+	checksums[n++] = ok ? vc_checksum(dist, w * h * sizeof(int), VC_FNV_BASIS) : 0;
+	VC_REGRESS_IMAGE(vc_binary_close_disc(mask, tmp, 4), tmp);
+
+	// Geometria
+	VC_REGRESS_IMAGE(vc_image_pyramid_down(frame, half), half);
+	VC_REGRESS_IMAGE(vc_warp_oriented_roi(frame, strip, w / 2.0f, h / 2.0f, 30.0f), strip);
+
+	// Etiquetagem (sobre o fecho da segmentação). A versão série e a versão por faixas dão as
+	// mesmas etiquetas e devolvem NULL nos mesmos casos (mais de 254 etiquetas provisórias).
+	blobs = vc_binary_blob_labelling(closed, labels, &ok);
+	if (blobs != NULL)
+		vc_binary_blob_info(labels, blobs, ok);
+	hash = vc_image_checksum(labels);
+	checksums[n++] = vc_regress_blobs(blobs, (blobs != NULL) ? ok : 0, hash);
+	free(blobs);
+	for (i = 1; i <= 4; i += 3)
+	{
+		blobs = vc_binary_blob_labelling_parallel(closed, labels, &ok, i);
+		if (blobs != NULL)
+			vc_binary_blob_info(labels, blobs, ok);
+		hash = vc_image_checksum(labels);
+		checksums[n++] = vc_regress_blobs(blobs, (blobs != NULL) ? ok : 0, hash);
+		free(blobs);
+	}
+	vc_blob_filter_init(&filter);
+	filter.minarea = 1000;
+	blobs = vc_binary_blob_labelling_filtered(closed, labels, &ok, &filter);
+	checksums[n++] = vc_regress_blobs(blobs, (blobs != NULL) ? ok : 0, vc_image_checksum(labels));
+	free(blobs);
+
+	ok = vc_rle_from_image(closed, rle);
+	blobs = ok ? vc_rle_labelling(rle, &ok) : NULL;
+	if (blobs != NULL)
+		vc_rle_blob_info(rle, blobs, ok);
+	VC_REGRESS_IMAGE(vc_rle_to_image(rle, labels, 1), labels);
+	checksums[n - 1] = vc_regress_blobs(blobs, (blobs != NULL) ? ok : 0, checksums[n - 1]);
+	free(blobs);
+	ok = vc_rle_from_image(mask, rle) && vc_rle_dilate(rle, rle2, 5);
+	VC_REGRESS_IMAGE(ok && vc_rle_to_image(rle2, tmp, 0), tmp);
+
+	ccl = vc_ccl_new(w, h, 32);
+	ok = (ccl != NULL) && vc_ccl_update(ccl, closed, NULL);
+	checksums[n++] = ok ? vc_checksum(ccl->labels, w * h * sizeof(int), vc_regress_int(ccl->nblobs, VC_FNV_BASIS)) : 0;
+	vc_ccl_free(ccl);
+
+	// Streaming e grafo (vc_3channels_to_1channel -> negativo -> binário)
+	stream = vc_stream_new(w, h, 3);
+	ok = (stream != NULL) && vc_stream_add_rgb_to_gray(stream) && vc_stream_add_gray_to_binary(stream, 128) &&
+		 vc_stream_add_binary_dilate(stream, 3);
+	VC_REGRESS_IMAGE(ok && vc_stream_run(stream, frame, tmp, NULL), tmp);
+	vc_stream_free(stream);
+
+	graph = vc_graph_new(w, h);
+	ok = 0;
+	if (graph != NULL)
+	{
+		node = vc_graph_input(graph, 3);
+		node = vc_graph_node(graph, VC_OP_RGB_TO_GRAY, node, -1, NULL);
+		node = vc_graph_node(graph, VC_OP_GRAY_NEGATIVE, node, -1, NULL);
+		node = vc_graph_node(graph, VC_OP_GRAY_TO_BINARY, node, -1, &threshold);
+		ins[0] = frame;
+		outs[0] = tmp;
+		ok = vc_graph_output(graph, node) && vc_graph_compile(graph) && vc_graph_run(graph, ins, outs);
+	}
+	VC_REGRESS_IMAGE(ok, tmp);
+	vc_graph_free(graph);
+
+	// Pipeline completo, em qualidade máxima
+	pipe = vc_resistor_pipe_new(w, h);
+	ok = (pipe != NULL) && vc_resistor_pipe_run(pipe, frame, order, NULL);
+	hash = 0;
+	if (ok)
+	{
+		hash = vc_regress_blobs(pipe->blobs, pipe->nfound, VC_FNV_BASIS);
+		for (i = 0; i < pipe->nfound; i++)
+		{
+			// O valor chega a ~1e10 ohm: em centésimos não cabe num int
+			long long value = llround(pipe->resistors[i].value * 100.0);
+
+			hash = vc_checksum(pipe->resistors[i].bands, pipe->resistors[i].nbands * sizeof(int), vc_regress_int(pipe->resistors[i].nbands, hash));
+			hash = vc_checksum(&value, sizeof(value), hash);
+			hash = vc_regress_int((int)floor(pipe->resistors[i].tolerance * 100.0f + 0.5f), hash);
+		}
+	}
+	checksums[n++] = hash;
+	vc_resistor_pipe_free(pipe);
+
+#undef VC_REGRESS_IMAGE
+
+end:
+	vc_image_free(gray);
+	vc_image_free(mask);
+	vc_image_free(closed);
+	vc_image_free(bin);
+	vc_image_free(tmp);
+	vc_image_free(labels);
+	vc_image_free(img3);
+	vc_image_free(half);
+	vc_image_free(strip);
+	free(dist);
+	vc_rle_free(rle);
+	vc_rle_free(rle2);
+
+	return n;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            FUNÇÕES: Testes diferenciais aleatórios (fuzzing)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// vc_fuzz gera casos aleatórios (dimensões, bytes por linha, canais e conteúdo) e compara cada
+// versão optimizada (SIMD, kernels especializados, streaming, grafo, RLE, etiquetagem por faixas
+// e incremental) com uma referência escalar simples, escrita aqui pixel a pixel com verificação
+// de limites. O padding das linhas é preenchido com lixo, para que uma leitura fora da linha
+// dê um resultado diferente. Cada verificação mostra só a primeira diferença encontrada.
+// Os casos dependem apenas da semente (gerador xorshift próprio), por isso uma diferença
+// repete-se com a mesma semente em qualquer plataforma.
+
+static const char *vc_fuzz_names[] = {
+	"rgb_to_gray", "stream_gray", "rgb_to_hsv", "hsv_segmentation", "stream_hsv", "graph_hsv", "gray_to_binary",
+	"binary_dilate", "binary_dilate2", "binary_erode", "gray_dilate", "gray_erode", "niblack",
+	"stream_morph", "graph_morph", "rle_morph", "labelling", "labelling_stripes", "labelling_rle", "ccl_incremental",
+	"distance_euclidean", "distance_chamfer"};
+
+#define VC_FUZZ_CHECKS	((int)(sizeof(vc_fuzz_names) / sizeof(vc_fuzz_names[0])))
+
+enum
+{
+	VC_FUZZ_GRAY, VC_FUZZ_STREAM_GRAY, VC_FUZZ_HSV, VC_FUZZ_HSV_SEG, VC_FUZZ_STREAM_HSV, VC_FUZZ_GRAPH_HSV, VC_FUZZ_BINARY,
+	VC_FUZZ_DILATE, VC_FUZZ_DILATE2, VC_FUZZ_ERODE, VC_FUZZ_GRAY_DILATE, VC_FUZZ_GRAY_ERODE, VC_FUZZ_NIBLACK,
+	VC_FUZZ_STREAM_MORPH, VC_FUZZ_GRAPH_MORPH, VC_FUZZ_RLE_MORPH, VC_FUZZ_LABEL, VC_FUZZ_LABEL_STRIPES, VC_FUZZ_LABEL_RLE,
+	VC_FUZZ_CCL, VC_FUZZ_DIST_EUCLIDEAN, VC_FUZZ_DIST_CHAMFER
+};
+
+typedef struct
+{
+	unsigned int state;		// Gerador do caso actual
+	unsigned int seed;
+	int iteration;
+	int verbose;
+	int failed[VC_FUZZ_CHECKS];	// Comparações com diferenças, por verificação
+	int tested[VC_FUZZ_CHECKS];	// Comparações feitas, por verificação
+} VCFUZZ;
+
+// Estatísticas de um componente da etiquetagem de referência
+typedef struct
+{
+	int area;
+	int xmin, ymin, xmax, ymax;
+} VCFUZZBLOB;
+
+// xorshift32
+static unsigned int vc_fuzz_rand(VCFUZZ *fz)
+{
+	fz->state ^= fz->state << 13;
+	fz->state ^= fz->state >> 17;
+	fz->state ^= fz->state << 5;
+
+	return fz->state;
+}
+
+// Inteiro em [lo, hi]
+static int vc_fuzz_range(VCFUZZ *fz, int lo, int hi)
+{
+	return lo + (int)(vc_fuzz_rand(fz) % (unsigned int)(hi - lo + 1));
+}
+
+// Imagem com 'pad' bytes de padding no fim de cada linha (ou, em metade dos casos, com um
+// padding diferente do das outras imagens), toda preenchida com lixo
+static IVC *vc_fuzz_image(VCFUZZ *fz, int width, int height, int channels, int pad)
+{
+	IVC *image = (IVC *)malloc(sizeof(IVC));
+	long int i, size;
+
+	if (image == NULL)
+		return NULL;
+
+	if (vc_fuzz_rand(fz) & 1)
+		pad = vc_fuzz_range(fz, 0, 40);
+
+	image->width = width;
+	image->height = height;
+	image->channels = channels;
+	image->levels = 255;
+	image->bytesperline = width * channels + pad;
+	size = (long int)image->bytesperline * height;
+	image->data = (unsigned char *)malloc(size);
+	if (image->data == NULL)
+		return vc_image_free(image);
+
+	for (i = 0; i < size; i++)
+		image->data[i] = (unsigned char)vc_fuzz_rand(fz);
+
+	return image;
+}
+
+// Preenche os pixéis (não o padding) com um padrão aleatório:
+// 0 = bytes aleatórios, 1 = poucos valores (extremos e iguais entre canais), 2 = rectângulos,
+// 3 = binária (0/255) com densidade aleatória, 4 = binária com rectângulos e ruído
+static void vc_fuzz_fill(VCFUZZ *fz, IVC *image, int kind)
+{
+	static const unsigned char palette[] = {0, 1, 2, 127, 128, 200, 254, 255};
+	int x, y, c, i, n, x0, y0, x1, y1, density, value;
+	unsigned char *p;
+
+	density = vc_fuzz_range(fz, 1, 99);
+	for (y = 0; y < image->height; y++)
+	{
+		p = &image->data[y * image->bytesperline];
+		for (x = 0; x < image->width * image->channels; x += image->channels)
+		{
+			value = palette[vc_fuzz_rand(fz) & 7];
+			for (c = 0; c < image->channels; c++)
+			{
+				if (kind == 0)
+					p[x + c] = (unsigned char)vc_fuzz_rand(fz);
+				else if (kind == 1)
+					p[x + c] = ((vc_fuzz_rand(fz) & 3) == 0) ? palette[vc_fuzz_rand(fz) & 7] : (unsigned char)value;
+				else if (kind == 3)
+					p[x + c] = ((int)(vc_fuzz_rand(fz) % 100) < density) ? 255 : 0;
+				else
+					p[x + c] = 0;
+			}
+		}
+	}
+
+	if ((kind != 2) && (kind != 4))
+		return;
+
+	n = vc_fuzz_range(fz, 1, 12);
+	for (i = 0; i < n; i++)
+	{
+		x0 = vc_fuzz_range(fz, 0, image->width - 1);
+		y0 = vc_fuzz_range(fz, 0, image->height - 1);
+		x1 = x0 + vc_fuzz_range(fz, 0, image->width / 2);
+		y1 = y0 + vc_fuzz_range(fz, 0, image->height / 2);
+		x1 = MY_MIN(x1, image->width - 1);
+		y1 = MY_MIN(y1, image->height - 1);
+		value = (kind == 4) ? ((i & 3) ? 255 : 0) : (int)(vc_fuzz_rand(fz) & 255);
+		for (y = y0; y <= y1; y++)
+			for (x = x0; x <= x1; x++)
+				for (c = 0; c < image->channels; c++)
+					image->data[y * image->bytesperline + x * image->channels + c] = (unsigned char)((kind == 4) ? value : value ^ (c * 85));
+	}
+
+	// Ruído de um pixel
+	if (kind == 4)
+	{
+		n = (image->width * image->height) / vc_fuzz_range(fz, 8, 200);
+		for (i = 0; i < n; i++)
+		{
+			x = vc_fuzz_range(fz, 0, image->width - 1);
+			y = vc_fuzz_range(fz, 0, image->height - 1);
+			image->data[y * image->bytesperline + x] ^= 255;
+		}
+	}
+}
+
+// Mostra a primeira diferença de uma verificação (as seguintes só são contadas)
+static void vc_fuzz_report(VCFUZZ *fz, int check, IVC *image, int x, int y, int got, int expected, const char *what)
+{
+	if ((fz->failed[check]++ > 0) || !fz->verbose)
+		return;
+
+	printf("vc_fuzz: %s diferente (semente %u, caso %d): ", vc_fuzz_names[check], fz->seed, fz->iteration);
+	if (image != NULL)
+		printf("%dx%d, %d canais, %d bytes por linha, ", image->width, image->height, image->channels, image->bytesperline);
+	printf("%s (%d,%d): %d em vez de %d\n", what, x, y, got, expected);
+}
+
+// Compara os pixéis de duas imagens (o padding não conta). Devolve 1 se forem iguais.
+static int vc_fuzz_compare(VCFUZZ *fz, int check, IVC *got, IVC *expected)
+{
+	int x, y, n = got->width * got->channels;
+	unsigned char *pg, *pe;
+
+	fz->tested[check]++;
+
+	for (y = 0; y < got->height; y++)
+	{
+		pg = &got->data[y * got->bytesperline];
+		pe = &expected->data[y * expected->bytesperline];
+
+		for (x = 0; x < n; x++)
+		{
+			if (pg[x] != pe[x])
+			{
+				vc_fuzz_report(fz, check, got, x / got->channels, y, pg[x], pe[x], "pixel");
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+// Assinala uma função que falhou (devolveu 0 ou NULL) num caso válido
+static void vc_fuzz_failed_call(VCFUZZ *fz, int check, IVC *image)
+{
+	fz->tested[check]++;
+	vc_fuzz_report(fz, check, image, 0, 0, 0, 1, "a função falhou no pixel");
+}
+
+//            Referências escalares
+
+static void vc_fuzz_ref_gray(IVC *src, IVC *dst, int ri, int gi, int bi)
+{
+	unsigned char *p;
+	int x, y;
+
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			p = &src->data[y * src->bytesperline + x * src->channels];
+			dst->data[y * dst->bytesperline + x] = (unsigned char)((p[ri] * VC_GRAY_WR + p[gi] * VC_GRAY_WG + p[bi] * VC_GRAY_WB) >> 15);
+		}
+	}
+}
 
-    // Aplica a equalização aos pixels da imagem de entrada
-    for (y = 0; y < height; y++)
-    {
-        for (x = 0; x < width; x++)
-        {
-            pos = y * bytesperline + x * channels;
-            data_dst[pos] = equalization[data_src[pos]];
-        }
-    }
+static void vc_fuzz_ref_hsv_seg(IVC *src, IVC *dst, int ri, int gi, int bi, const int *range)
+{
+	unsigned char hsv[3], *p;
+	int x, y, c;
 
-    return 1;
-}
\ No newline at end of file
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			p = &src->data[y * src->bytesperline + x * src->channels];
+			vc_rgb_pixel_to_hsv((float)p[ri], (float)p[gi], (float)p[bi], hsv);
+			for (c = 0; c < dst->channels; c++)
+				dst->data[y * dst->bytesperline + x * dst->channels + c] =
+					vc_hsv_pixel_in_range(hsv, range[0], range[1], range[2], range[3], range[4], range[5]) ? 255 : 0;
+		}
+	}
+}
+
+// Operadores de vizinhança kernel x kernel (os vizinhos fora da imagem são ignorados)
+// op: 0 = dilatação binária, 1 = erosão binária, 2 = máximo, 3 = mínimo
+static void vc_fuzz_ref_morph(IVC *src, IVC *dst, int kernel, int op)
+{
+	int offset = (kernel - 1) / 2;
+	int x, y, kx, ky, a, v;
+
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			a = (op == 0) ? 0 : (op == 1) ? 1 : (op == 2) ? 0 : 255;
+
+			for (ky = y - offset; ky <= y + offset; ky++)
+			{
+				for (kx = x - offset; kx <= x + offset; kx++)
+				{
+					if ((ky < 0) || (ky >= src->height) || (kx < 0) || (kx >= src->width))
+						continue;
+
+					v = src->data[ky * src->bytesperline + kx];
+					if (op == 0)
+						a |= (v == 255);
+					else if (op == 1)
+						a &= (v == 255);
+					else if (op == 2)
+						a = MY_MAX(a, v);
+					else
+						a = MY_MIN(a, v);
+				}
+			}
+
+			dst->data[y * dst->bytesperline + x] = (unsigned char)((op < 2) ? (a ? 255 : 0) : a);
+		}
+	}
+}
+
+// Limiar: 255 acima de threshold
+static void vc_fuzz_ref_threshold(IVC *src, IVC *dst, int threshold)
+{
+	int x, y;
+
+	for (y = 0; y < src->height; y++)
+		for (x = 0; x < src->width; x++)
+			dst->data[y * dst->bytesperline + x] = (src->data[y * src->bytesperline + x] > threshold) ? 255 : 0;
+}
+
+// Niblack com as mesmas operações em vírgula flutuante do caminho genérico de vc.c
+static void vc_fuzz_ref_niblack(IVC *src, IVC *dst, int kernel, float k)
+{
+	int offset = (kernel - 1) / 2;
+	int x, y, kx, ky;
+	float mean, stdDev, threshold;
+
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			mean = 0.0f;
+			stdDev = 0.0f;
+
+			for (ky = y - offset; ky <= y + offset; ky++)
+				for (kx = x - offset; kx <= x + offset; kx++)
+					if ((ky >= 0) && (ky < src->height) && (kx >= 0) && (kx < src->width))
+						mean += src->data[ky * src->bytesperline + kx];
+
+			mean = mean / (kernel * kernel);
+
+			for (ky = y - offset; ky <= y + offset; ky++)
+				for (kx = x - offset; kx <= x + offset; kx++)
+					if ((ky >= 0) && (ky < src->height) && (kx >= 0) && (kx < src->width))
+						stdDev += pow(src->data[ky * src->bytesperline + kx] - mean, 2);
+
+			stdDev = sqrt(stdDev / (kernel * kernel));
+			threshold = mean + k * stdDev;
+
+			dst->data[y * dst->bytesperline + x] = (src->data[y * src->bytesperline + x] <= threshold) ? 0 : 255;
+		}
+	}
+}
+
+// Etiquetagem de referência (vizinhança-8, por pesquisa em largura), com etiquetas pela ordem
+// raster do 1º pixel. Com clearborder os pixéis do rebordo contam como fundo, como em
+// vc_binary_blob_labelling. Devolve o número de componentes (-1 se faltar memória).
+static int vc_fuzz_ref_labelling(IVC *src, int clearborder, int *labels, VCFUZZBLOB **stats)
+{
+	int width = src->width, height = src->height;
+	int x, y, i, n = 0, head, tail, px, py, kx, ky, capacity = 64;
+	int *queue = (int *)malloc(width * height * sizeof(int));
+	VCFUZZBLOB *blobs = (VCFUZZBLOB *)malloc(capacity * sizeof(VCFUZZBLOB)), *grow, *b;
+
+	*stats = NULL;
+	if ((queue == NULL) || (blobs == NULL))
+	{
+		free(queue);
+		free(blobs);
+		return -1;
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			i = y * width + x;
+			labels[i] = (src->data[y * src->bytesperline + x] != 0) ? -1 : 0;
+			if (clearborder && ((x == 0) || (y == 0) || (x == width - 1) || (y == height - 1)))
+				labels[i] = 0;
+		}
+	}
+
+	for (i = 0; i < width * height; i++)
+	{
+		if (labels[i] != -1)
+			continue;
+
+		if (n + 1 >= capacity)
+		{
+			capacity *= 2;
+			grow = (VCFUZZBLOB *)realloc(blobs, capacity * sizeof(VCFUZZBLOB));
+			if (grow == NULL)
+			{
+				free(queue);
+				free(blobs);
+				return -1;
+			}
+			blobs = grow;
+		}
+
+		b = &blobs[++n];
+		b->area = 0;
+		b->xmin = b->xmax = i % width;
+		b->ymin = b->ymax = i / width;
+		labels[i] = n;
+		queue[0] = i;
+		for (head = 0, tail = 1; head < tail; head++)
+		{
+			px = queue[head] % width;
+			py = queue[head] / width;
+			b->area++;
+			b->xmin = MY_MIN(b->xmin, px);
+			b->xmax = MY_MAX(b->xmax, px);
+			b->ymin = MY_MIN(b->ymin, py);
+			b->ymax = MY_MAX(b->ymax, py);
+
+			for (ky = MY_MAX(py - 1, 0); ky <= MY_MIN(py + 1, height - 1); ky++)
+			{
+				for (kx = MY_MAX(px - 1, 0); kx <= MY_MIN(px + 1, width - 1); kx++)
+				{
+					if (labels[ky * width + kx] == -1)
+					{
+						labels[ky * width + kx] = n;
+						queue[tail++] = ky * width + kx;
+					}
+				}
+			}
+		}
+	}
+
+	free(queue);
+	*stats = blobs;
+
+	return n;
+}
+
+// Verifica se duas etiquetagens definem a mesma partição (as etiquetas podem ser diferentes) e
+// se os blobs têm a área e a bounding box da referência. Devolve 1 se forem iguais.
+static int vc_fuzz_compare_labels(VCFUZZ *fz, int check, IVC *image, const int *expected, int nexpected, VCFUZZBLOB *stats,
+								  const int *got, int ngot, OVC *blobs)
+{
+	int size = image->width * image->height;
+	int i, maxgot = 0, ok = 1, e, *tognt, *toexp;
+
+	fz->tested[check]++;
+
+	if (ngot != nexpected)
+	{
+		vc_fuzz_report(fz, check, image, 0, 0, ngot, nexpected, "número de blobs no pixel");
+		return 0;
+	}
+
+	for (i = 0; i < size; i++)
+		maxgot = MY_MAX(maxgot, got[i]);
+	tognt = (int *)malloc((nexpected + 1) * sizeof(int));
+	toexp = (int *)malloc((maxgot + 1) * sizeof(int));
+	if ((tognt == NULL) || (toexp == NULL))
+	{
+		free(tognt);
+		free(toexp);
+		return 1;
+	}
+	for (i = 0; i <= nexpected; i++)
+		tognt[i] = -1;
+	for (i = 0; i <= maxgot; i++)
+		toexp[i] = -1;
+	tognt[0] = 0;
+	toexp[0] = 0;
+
+	for (i = 0; (i < size) && ok; i++)
+	{
+		if (got[i] < 0)
+			ok = 0;
+		else if ((tognt[expected[i]] == -1) && (toexp[got[i]] == -1))
+		{
+			tognt[expected[i]] = got[i];
+			toexp[got[i]] = expected[i];
+		}
+		else
+			ok = (tognt[expected[i]] == got[i]) && (toexp[got[i]] == expected[i]);
+
+		if (!ok)
+			vc_fuzz_report(fz, check, image, i % image->width, i / image->width, got[i], tognt[expected[i]], "etiqueta");
+	}
+
+	for (i = 0; (i < ngot) && (blobs != NULL) && ok; i++)
+	{
+		e = ((blobs[i].label >= 0) && (blobs[i].label <= maxgot)) ? toexp[blobs[i].label] : -1;
+		if (e <= 0)
+		{
+			vc_fuzz_report(fz, check, image, blobs[i].x, blobs[i].y, blobs[i].label, 0, "etiqueta do blob no pixel");
+			ok = 0;
+		}
+		else if ((blobs[i].area != stats[e].area) || (blobs[i].x != stats[e].xmin) || (blobs[i].y != stats[e].ymin) ||
+				 (blobs[i].width != stats[e].xmax - stats[e].xmin + 1) || (blobs[i].height != stats[e].ymax - stats[e].ymin + 1))
+		{
+			vc_fuzz_report(fz, check, image, blobs[i].x, blobs[i].y, blobs[i].area, stats[e].area, "área do blob no pixel");
+			ok = 0;
+		}
+	}
+
+	free(tognt);
+	free(toexp);
+
+	return ok;
+}
+
+// Distância euclidiana ao quadrado por força bruta
+static void vc_fuzz_ref_euclidean(IVC *src, int *dist)
+{
+	int x, y, bx, by, d;
+
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			d = (src->data[y * src->bytesperline + x] == 0) ? 0 : VC_DIST_INF;
+
+			for (by = 0; (by < src->height) && (d > 0); by++)
+				for (bx = 0; bx < src->width; bx++)
+					if (src->data[by * src->bytesperline + bx] == 0)
+						d = MY_MIN(d, (x - bx) * (x - bx) + (y - by) * (y - by));
+
+			dist[y * src->width + x] = d;
+		}
+	}
+}
+
+// Distância chanfrada 3-4: caminho mais curto no grafo de vizinhança-8, por relaxação até estabilizar
+static void vc_fuzz_ref_chamfer(IVC *src, int *dist)
+{
+	int width = src->width, height = src->height;
+	int x, y, kx, ky, d, changed = 1;
+
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			dist[y * width + x] = (src->data[y * src->bytesperline + x] == 0) ? 0 : VC_DIST_INF;
+
+	while (changed)
+	{
+		changed = 0;
+		for (y = 0; y < height; y++)
+		{
+			for (x = 0; x < width; x++)
+			{
+				for (ky = MY_MAX(y - 1, 0); ky <= MY_MIN(y + 1, height - 1); ky++)
+				{
+					for (kx = MY_MAX(x - 1, 0); kx <= MY_MIN(x + 1, width - 1); kx++)
+					{
+						d = dist[ky * width + kx] + (((kx != x) && (ky != y)) ? 4 : 3);
+						if (d < dist[y * width + x])
+						{
+							dist[y * width + x] = d;
+							changed = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+//            Verificações
+
+// Conversões de cor: SIMD (vc_gray_row), streaming e grafo, em RGB, BGR e BGRA
+static void vc_fuzz_color(VCFUZZ *fz, int width, int height, int pad)
+{
+	static const int orders[3] = {VC_ORDER_RGB, VC_ORDER_BGR, VC_ORDER_BGRA};
+	int order = orders[vc_fuzz_range(fz, 0, 2)];
+	int nch = (order == VC_ORDER_BGRA) ? 4 : 3;
+	int ri = (order == VC_ORDER_RGB) ? 0 : 2, bi = 2 - ri;
+	int range[6], x, y, c;
+	IVC *src = vc_fuzz_image(fz, width, height, nch, pad);
+	IVC *src3 = vc_fuzz_image(fz, width, height, 3, pad);
+	IVC *got = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *expected = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *got3 = vc_fuzz_image(fz, width, height, 3, pad);
+	IVC *expected3 = vc_fuzz_image(fz, width, height, 3, pad);
+	STREAMVC *stream = NULL;
+	GRAPHVC *graph = NULL;
+	IVC *ins[1], *outs[1];
+	unsigned char hsv[3], *p;
+	int node;
+
+	if ((src == NULL) || (src3 == NULL) || (got == NULL) || (expected == NULL) || (got3 == NULL) || (expected3 == NULL))
+		goto end;
+
+	vc_fuzz_fill(fz, src, vc_fuzz_range(fz, 0, 2));
+	vc_fuzz_fill(fz, src3, vc_fuzz_range(fz, 0, 2));
+
+	// Cinzentos
+	vc_fuzz_ref_gray(src, expected, ri, 1, bi);
+	if (vc_rgb_to_gray(src, got, order))
+		vc_fuzz_compare(fz, VC_FUZZ_GRAY, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_GRAY, src);
+
+	vc_fuzz_ref_gray(src3, expected, 0, 1, 2);
+	stream = vc_stream_new(width, height, 3);
+	if ((stream != NULL) && vc_stream_add_rgb_to_gray(stream) && vc_stream_run(stream, src3, got, NULL))
+		vc_fuzz_compare(fz, VC_FUZZ_STREAM_GRAY, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_STREAM_GRAY, src3);
+	stream = vc_stream_free(stream);
+
+	// HSV: conversão no local, pixel a pixel com a conversão da referência
+	if (nch == 3)
+	{
+		for (y = 0; y < height; y++)
+		{
+			for (x = 0; x < width; x++)
+			{
+				p = &src->data[y * src->bytesperline + x * 3];
+				vc_rgb_pixel_to_hsv((float)p[ri], (float)p[1], (float)p[bi], hsv);
+				for (c = 0; c < 3; c++)
+					expected3->data[y * expected3->bytesperline + x * 3 + c] = hsv[c];
+			}
+		}
+		for (y = 0; y < height; y++)
+			memcpy(&got3->data[y * got3->bytesperline], &src->data[y * src->bytesperline], width * 3);
+		if (vc_rgb_to_hsv_order(got3, order))
+			vc_fuzz_compare(fz, VC_FUZZ_HSV, got3, expected3);
+		else
+			vc_fuzz_failed_call(fz, VC_FUZZ_HSV, src);
+	}
+
+	// Segmentação HSV: directa, streaming e grafo (RGB -> HSV -> segmentação fundidos)
+	range[0] = vc_fuzz_range(fz, 0, 360);
+	range[1] = vc_fuzz_range(fz, range[0], 360);
+	range[2] = vc_fuzz_range(fz, 0, 100);
+	range[3] = vc_fuzz_range(fz, range[2], 100);
+	range[4] = vc_fuzz_range(fz, 0, 100);
+	range[5] = vc_fuzz_range(fz, range[4], 100);
+
+	vc_fuzz_ref_hsv_seg(src, expected, ri, 1, bi, range);
+	if (vc_color_hsv_segmentation(src, got, order, range[0], range[1], range[2], range[3], range[4], range[5]))
+		vc_fuzz_compare(fz, VC_FUZZ_HSV_SEG, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_HSV_SEG, src);
+
+	vc_fuzz_ref_hsv_seg(src3, expected, 0, 1, 2, range);
+	stream = vc_stream_new(width, height, 3);
+	if ((stream != NULL) && vc_stream_add_hsv_segmentation(stream, range[0], range[1], range[2], range[3], range[4], range[5]) &&
+		vc_stream_run(stream, src3, got, NULL))
+		vc_fuzz_compare(fz, VC_FUZZ_STREAM_HSV, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_STREAM_HSV, src3);
+	stream = vc_stream_free(stream);
+
+	vc_fuzz_ref_hsv_seg(src3, expected3, 0, 1, 2, range);
+	graph = vc_graph_new(width, height);
+	if (graph != NULL)
+	{
+		node = vc_graph_input(graph, 3);
+		node = vc_graph_node(graph, VC_OP_RGB_TO_HSV, node, -1, NULL);
+		node = vc_graph_node(graph, VC_OP_HSV_SEGMENTATION, node, -1, range);
+		ins[0] = src3;
+		outs[0] = got3;
+		if (vc_graph_output(graph, node) && vc_graph_compile(graph) && vc_graph_run(graph, ins, outs))
+			vc_fuzz_compare(fz, VC_FUZZ_GRAPH_HSV, got3, expected3);
+		else
+			vc_fuzz_failed_call(fz, VC_FUZZ_GRAPH_HSV, src3);
+	}
+	graph = vc_graph_free(graph);
+
+end:
+	vc_image_free(src);
+	vc_image_free(src3);
+	vc_image_free(got);
+	vc_image_free(expected);
+	vc_image_free(got3);
+	vc_image_free(expected3);
+}
+
+// Limiar e operadores de vizinhança: kernels especializados (3 a 9), caminho genérico
+// (restantes tamanhos), streaming, grafo e RLE
+static void vc_fuzz_morph(VCFUZZ *fz, int width, int height, int pad)
+{
+	int kernel = 2 * vc_fuzz_range(fz, 0, 7) + 1;
+	int kernel2 = 2 * vc_fuzz_range(fz, 0, 4) + 1;
+	int threshold = vc_fuzz_range(fz, -1, 255);
+	float k = (float)vc_fuzz_range(fz, -100, 100) / 100.0f;
+	IVC *gray = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *bin = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *got = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *expected = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *tmp = vc_fuzz_image(fz, width, height, 1, pad);
+	STREAMVC *stream = NULL;
+	GRAPHVC *graph = NULL;
+	RLEVC *rle = vc_rle_new(width, height, 0), *rle2 = vc_rle_new(width, height, 0);
+	IVC *ins[1], *outs[1];
+	int node, param;
+
+	if ((gray == NULL) || (bin == NULL) || (got == NULL) || (expected == NULL) || (tmp == NULL) || (rle == NULL) || (rle2 == NULL))
+		goto end;
+
+	vc_fuzz_fill(fz, gray, vc_fuzz_range(fz, 0, 2));
+	vc_fuzz_fill(fz, bin, vc_fuzz_range(fz, 3, 4));
+
+	vc_fuzz_ref_threshold(gray, expected, threshold);
+	if (vc_gray_to_binary_src_dst(gray, got, threshold))
+		vc_fuzz_compare(fz, VC_FUZZ_BINARY, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_BINARY, gray);
+
+	vc_fuzz_ref_morph(bin, expected, kernel, 0);
+	if (vc_binary_dilate(bin, got, kernel))
+		vc_fuzz_compare(fz, VC_FUZZ_DILATE, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_DILATE, bin);
+	if (vc_binary_dilate2(bin, got, kernel))
+		vc_fuzz_compare(fz, VC_FUZZ_DILATE2, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_DILATE2, bin);
+
+	vc_fuzz_ref_morph(bin, expected, kernel, 1);
+	if (vc_binary_erode(bin, got, kernel))
+		vc_fuzz_compare(fz, VC_FUZZ_ERODE, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_ERODE, bin);
+
+	vc_fuzz_ref_morph(gray, expected, kernel, 2);
+	if (vc_gray_dilate(gray, got, kernel))
+		vc_fuzz_compare(fz, VC_FUZZ_GRAY_DILATE, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_GRAY_DILATE, gray);
+
+	vc_fuzz_ref_morph(gray, expected, kernel, 3);
+	if (vc_gray_erode(gray, got, kernel))
+		vc_fuzz_compare(fz, VC_FUZZ_GRAY_ERODE, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_GRAY_ERODE, gray);
+
+	vc_fuzz_ref_niblack(gray, expected, kernel, k);
+	if (vc_gray_to_binary_niblack(gray, got, kernel, k))
+		vc_fuzz_compare(fz, VC_FUZZ_NIBLACK, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_NIBLACK, gray);
+
+	// Limiar -> dilatação -> erosão, por streaming e pelo grafo
+	vc_fuzz_ref_threshold(gray, tmp, threshold);
+	vc_fuzz_ref_morph(tmp, got, kernel, 0);
+	vc_fuzz_ref_morph(got, expected, kernel2, 1);
+
+	stream = vc_stream_new(width, height, 1);
+	if ((stream != NULL) && vc_stream_add_gray_to_binary(stream, threshold) && vc_stream_add_binary_dilate(stream, kernel) &&
+		vc_stream_add_binary_erode(stream, kernel2) && vc_stream_run(stream, gray, got, NULL))
+		vc_fuzz_compare(fz, VC_FUZZ_STREAM_MORPH, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_STREAM_MORPH, gray);
+	stream = vc_stream_free(stream);
+
+	graph = vc_graph_new(width, height);
+	if (graph != NULL)
+	{
+		node = vc_graph_input(graph, 1);
+		node = vc_graph_node(graph, VC_OP_GRAY_TO_BINARY, node, -1, &threshold);
+		node = vc_graph_node(graph, VC_OP_BINARY_DILATE, node, -1, &kernel);
+		node = vc_graph_node(graph, VC_OP_BINARY_ERODE, node, -1, &kernel2);
+		ins[0] = gray;
+		outs[0] = got;
+		if (vc_graph_output(graph, node) && vc_graph_compile(graph) && vc_graph_run(graph, ins, outs))
+			vc_fuzz_compare(fz, VC_FUZZ_GRAPH_MORPH, got, expected);
+		else
+			vc_fuzz_failed_call(fz, VC_FUZZ_GRAPH_MORPH, gray);
+	}
+	graph = vc_graph_free(graph);
+
+	// Dilatação -> erosão sobre runs
+	vc_fuzz_ref_morph(bin, tmp, kernel, 0);
+	vc_fuzz_ref_morph(tmp, expected, kernel2, 1);
+	param = vc_rle_from_image(bin, rle) && vc_rle_dilate(rle, rle2, kernel) && vc_rle_erode(rle2, rle, kernel2) && vc_rle_to_image(rle, got, 0);
+	if (param)
+		vc_fuzz_compare(fz, VC_FUZZ_RLE_MORPH, got, expected);
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_RLE_MORPH, bin);
+
+end:
+	vc_image_free(gray);
+	vc_image_free(bin);
+	vc_image_free(got);
+	vc_image_free(expected);
+	vc_image_free(tmp);
+	vc_rle_free(rle);
+	vc_rle_free(rle2);
+}
+
+// Falhas previstas da etiquetagem série e por faixas: as duas têm de devolver NULL exactamente
+// quando o varrimento série precisa de mais de 254 etiquetas provisórias ('overflow'), e só
+// nesse caso (ou sem blobs). Devolve 1 se houver etiquetas para comparar.
+static int vc_fuzz_labelling_result(VCFUZZ *fz, int check, IVC *bin, OVC *blobs, int n, int nexpected, int overflow)
+{
+	if (overflow)
+	{
+		fz->tested[check]++;
+		if (blobs != NULL)
+			vc_fuzz_report(fz, check, bin, 0, 0, n, 0, "blobs devolvidos com mais de 254 etiquetas provisórias, no pixel");
+		return 0;
+	}
+	if ((blobs == NULL) && (nexpected > 0))
+	{
+		vc_fuzz_failed_call(fz, check, bin);
+		return 0;
+	}
+
+	return 1;
+}
+
+// Etiquetagem: série, por faixas, RLE e incremental (com uma 2ª frame alterada por rectângulos)
+// e transformadas de distância
+static void vc_fuzz_labelling(VCFUZZ *fz, int width, int height, int pad)
+{
+	IVC *bin = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *bin2 = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *dst = vc_fuzz_image(fz, width, height, 1, pad);
+	IVC *dst2 = vc_fuzz_image(fz, width, height, 1, pad);
+	int *expected = (int *)malloc(width * height * sizeof(int));
+	int *got = (int *)malloc(width * height * sizeof(int));
+	RLEVC *rle = vc_rle_new(width, height, 0);
+	CCLVC *ccl = NULL;
+	VCFUZZBLOB *stats = NULL;
+	OVC *blobs = NULL, *blobs2 = NULL;
+	int nexpected, n, n2, x, y, i, nprov;
+	unsigned char *p;
+
+	if ((bin == NULL) || (bin2 == NULL) || (dst == NULL) || (dst2 == NULL) || (expected == NULL) || (got == NULL) || (rle == NULL))
+		goto end;
+
+	vc_fuzz_fill(fz, bin, vc_fuzz_range(fz, 1, 4));
+
+	// Com o rebordo apagado: vc_binary_blob_labelling e a versão por faixas
+	nexpected = vc_fuzz_ref_labelling(bin, 1, expected, &stats);
+	if (nexpected < 0)
+		goto end;
+
+	// Etiquetas provisórias do varrimento série: pixéis marcados sem vizinhos marcados acima
+	// nem à esquerda (os rebordos apagados contam como fundo)
+	for (y = 1, nprov = 0; y < height - 1; y++)
+	{
+		for (x = 1; x < width - 1; x++)
+		{
+			p = &bin->data[y * bin->bytesperline + x];
+			nprov += (p[0] != 0) && ((x == 1) || (p[-1] == 0)) &&
+					 ((y == 1) || (((x == 1) || (p[-bin->bytesperline - 1] == 0)) && (p[-bin->bytesperline] == 0) &&
+								   ((x == width - 2) || (p[-bin->bytesperline + 1] == 0))));
+		}
+	}
+
+	n = 0;
+	blobs = vc_binary_blob_labelling(bin, dst, &n);
+	if (vc_fuzz_labelling_result(fz, VC_FUZZ_LABEL, bin, blobs, n, nexpected, nprov > 254))
+	{
+		vc_binary_blob_info(dst, blobs, n);
+		for (i = 0; i < width * height; i++)
+			got[i] = dst->data[(i / width) * dst->bytesperline + i % width];
+		vc_fuzz_compare_labels(fz, VC_FUZZ_LABEL, bin, expected, nexpected, stats, got, n, blobs);
+	}
+
+	// A versão por faixas falha nos mesmos casos
+	n2 = 0;
+	blobs2 = vc_binary_blob_labelling_parallel(bin, dst2, &n2, vc_fuzz_range(fz, 1, 8));
+	if (vc_fuzz_labelling_result(fz, VC_FUZZ_LABEL_STRIPES, bin, blobs2, n2, nexpected, nprov > 254))
+	{
+		vc_binary_blob_info(dst2, blobs2, n2);
+		for (i = 0; i < width * height; i++)
+			got[i] = dst2->data[(i / width) * dst2->bytesperline + i % width];
+		if (vc_fuzz_compare_labels(fz, VC_FUZZ_LABEL_STRIPES, bin, expected, nexpected, stats, got, n2, blobs2) && (blobs != NULL))
+		{
+			// Tem de ser igual à versão série, etiqueta a etiqueta
+			for (i = 0; i < n; i++)
+				if ((blobs[i].label != blobs2[i].label) || (blobs[i].xc != blobs2[i].xc) || (blobs[i].yc != blobs2[i].yc) ||
+					(blobs[i].perimeter != blobs2[i].perimeter))
+					break;
+			if (i < n)
+				vc_fuzz_report(fz, VC_FUZZ_LABEL_STRIPES, bin, blobs2[i].x, blobs2[i].y, blobs2[i].label, blobs[i].label, "blob diferente da versão série no pixel");
+			for (i = 0; i < width * height; i++)
+				if (got[i] != dst->data[(i / width) * dst->bytesperline + i % width])
+					break;
+			if (i < width * height)
+				vc_fuzz_report(fz, VC_FUZZ_LABEL_STRIPES, bin, i % width, i / width, got[i], dst->data[(i / width) * dst->bytesperline + i % width],
+							   "etiqueta diferente da versão série no pixel");
+		}
+	}
+	free(stats);
+	stats = NULL;
+	free(blobs);
+	blobs = NULL;
+	free(blobs2);
+	blobs2 = NULL;
+
+	// Sem apagar o rebordo: RLE e etiquetagem incremental
+	nexpected = vc_fuzz_ref_labelling(bin, 0, expected, &stats);
+	if (nexpected < 0)
+		goto end;
+
+	n = 0;
+	blobs = vc_rle_from_image(bin, rle) ? vc_rle_labelling(rle, &n) : NULL;
+	if ((blobs != NULL) || (nexpected == 0))
+	{
+		vc_rle_blob_info(rle, blobs, n);
+		memset(got, 0, width * height * sizeof(int));
+		for (y = 0; y < height; y++)
+			for (i = rle->rowstart[y]; i < rle->rowstart[y + 1]; i++)
+				for (x = rle->runs[i].x0; x <= rle->runs[i].x1; x++)
+					got[y * width + x] = rle->runs[i].label;
+		vc_fuzz_compare_labels(fz, VC_FUZZ_LABEL_RLE, bin, expected, nexpected, stats, got, n, blobs);
+	}
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_LABEL_RLE, bin);
+	free(blobs);
+	blobs = NULL;
+
+	ccl = vc_ccl_new(width, height, 1 << vc_fuzz_range(fz, 2, 5));
+	if ((ccl != NULL) && vc_ccl_update(ccl, bin, NULL))
+	{
+		blobs = vc_ccl_blobs(ccl, &n);
+		vc_fuzz_compare_labels(fz, VC_FUZZ_CCL, bin, expected, nexpected, stats, ccl->labels, n, blobs);
+		free(blobs);
+		blobs = NULL;
+		free(stats);
+		stats = NULL;
+
+		// 2ª frame: rectângulos pintados por cima da 1ª
+		for (y = 0; y < height; y++)
+			memcpy(&bin2->data[y * bin2->bytesperline], &bin->data[y * bin->bytesperline], width);
+		vc_fuzz_fill(fz, dst, 4);
+		for (i = vc_fuzz_range(fz, 1, 3); i > 0; i--)
+		{
+			int x0 = vc_fuzz_range(fz, 0, width - 1), y0 = vc_fuzz_range(fz, 0, height - 1);
+			int x1 = x0 + vc_fuzz_range(fz, 0, width / 3), y1 = y0 + vc_fuzz_range(fz, 0, height / 3);
+
+			x1 = MY_MIN(x1, width - 1);
+			y1 = MY_MIN(y1, height - 1);
+
+			for (y = y0; y <= y1; y++)
+				for (x = x0; x <= x1; x++)
+					bin2->data[y * bin2->bytesperline + x] = dst->data[y * dst->bytesperline + x];
+		}
+
+		nexpected = vc_fuzz_ref_labelling(bin2, 0, expected, &stats);
+		if ((nexpected >= 0) && vc_ccl_update(ccl, bin2, NULL))
+		{
+			blobs = vc_ccl_blobs(ccl, &n);
+			vc_fuzz_compare_labels(fz, VC_FUZZ_CCL, bin2, expected, nexpected, stats, ccl->labels, n, blobs);
+		}
+		else if (nexpected >= 0)
+			vc_fuzz_failed_call(fz, VC_FUZZ_CCL, bin2);
+	}
+	else
+		vc_fuzz_failed_call(fz, VC_FUZZ_CCL, bin);
+
+	// Transformadas de distância (referências quadráticas: só em imagens pequenas)
+	if (width * height <= 2048)
+	{
+		vc_fuzz_ref_euclidean(bin, expected);
+		fz->tested[VC_FUZZ_DIST_EUCLIDEAN]++;
+		if (!vc_binary_distance_transform(bin, got, VC_DIST_EUCLIDEAN))
+			vc_fuzz_failed_call(fz, VC_FUZZ_DIST_EUCLIDEAN, bin);
+		else
+			for (i = 0; i < width * height; i++)
+				if (got[i] != expected[i])
+				{
+					vc_fuzz_report(fz, VC_FUZZ_DIST_EUCLIDEAN, bin, i % width, i / width, got[i], expected[i], "distância no pixel");
+					break;
+				}
+
+		vc_fuzz_ref_chamfer(bin, expected);
+		fz->tested[VC_FUZZ_DIST_CHAMFER]++;
+		if (!vc_binary_distance_transform(bin, got, VC_DIST_CHAMFER34))
+			vc_fuzz_failed_call(fz, VC_FUZZ_DIST_CHAMFER, bin);
+		else
+			for (i = 0; i < width * height; i++)
+				if (got[i] != expected[i])
+				{
+					vc_fuzz_report(fz, VC_FUZZ_DIST_CHAMFER, bin, i % width, i / width, got[i], expected[i], "distância no pixel");
+					break;
+				}
+	}
+
+end:
+	vc_image_free(bin);
+	vc_image_free(bin2);
+	vc_image_free(dst);
+	vc_image_free(dst2);
+	free(expected);
+	free(got);
+	free(stats);
+	free(blobs);
+	free(blobs2);
+	vc_rle_free(rle);
+	vc_ccl_free(ccl);
+}
+
+// Corre 'iterations' casos aleatórios a partir de 'seed'. Com verbose, mostra a primeira
+// diferença de cada verificação e, no fim, o resumo. Devolve o número de comparações com diferenças.
+int vc_fuzz(int iterations, unsigned int seed, int verbose)
+{
+	VCFUZZ fz;
+	int i, width, height, pad, size, total = 0;
+
+	memset(&fz, 0, sizeof(fz));
+	fz.seed = seed;
+	fz.verbose = verbose;
+
+	for (fz.iteration = 0; fz.iteration < iterations; fz.iteration++)
+	{
+		// Cada caso tem o seu estado, para se poder repetir isoladamente
+		fz.state = vc_checksum(&fz.iteration, sizeof(int), vc_checksum(&seed, sizeof(seed), VC_FNV_BASIS)) | 1;
+
+		// Tamanhos pequenos (rebordos, kernels maiores do que a imagem) e maiores (ciclos SIMD)
+		size = vc_fuzz_range(&fz, 0, 3);
+		width = vc_fuzz_range(&fz, 1, (size == 0) ? 8 : (size == 3) ? 160 : 70);
+		height = vc_fuzz_range(&fz, 1, (size == 0) ? 8 : 48);
+		pad = (vc_fuzz_range(&fz, 0, 3) == 0) ? 0 : vc_fuzz_range(&fz, 1, 40);
+
+		vc_fuzz_color(&fz, width, height, pad);
+		vc_fuzz_morph(&fz, width, height, pad);
+		vc_fuzz_labelling(&fz, width, height, pad);
+	}
+
+	for (i = 0; i < VC_FUZZ_CHECKS; i++)
+	{
+		total += fz.failed[i];
+		if (verbose)
+			printf("  %-20s %6d comparacoes, %6d diferentes\n", vc_fuzz_names[i], fz.tested[i], fz.failed[i]);
+	}
+
+	return total;
+}
@@ -45,7 +45,12 @@ typedef struct {
 	int x, y, width, height;	// Caixa Delimitadora (Bounding Box)
 	int area;					// �rea
 	int xc, yc;					// Centro-de-massa
+	float cx, cy;				// Centro-de-massa sem arredondamento (soma / área)
 	int perimeter;				// Per�metro
+	float mu20, mu02, mu11;		// Momentos centrais de 2ª ordem (divididos pela área)
+	float angle;				// Orientação do eixo maior, em graus [0, 180[
+	float major, minor;			// Eixos da elipse com os mesmos momentos
+	float eccentricity;			// Excentricidade dessa elipse [0, 1[
 	int label;					// Etiqueta
 } OVC;
 
@@ -56,6 +61,542 @@ typedef struct {
 
 OVC* vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels);
 int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs);
+OVC *vc_binary_blob_labelling_parallel(IVC *src, IVC *dst, int *nlabels, int nstripes);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                  FILTRO DE BLOBS (OBJECTOS)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Limites a 0 não são aplicados
+typedef struct {
+	int minarea, maxarea;				// Área
+	float minaspect, maxaspect;			// Largura / altura da bounding box
+	float minfill, maxfill;				// Área / área da bounding box
+	int roi_x, roi_y;					// Região onde tem de estar o centro de massa
+	int roi_width, roi_height;
+} BLOBFILTERVC;
+
+void vc_blob_filter_init(BLOBFILTERVC *filter);
+int vc_blob_filter_match(BLOBFILTERVC *filter, OVC *blob);
+int vc_blob_filter(OVC *blobs, int nblobs, BLOBFILTERVC *filter);
+OVC *vc_binary_blob_labelling_filtered(IVC *src, IVC *dst, int *nlabels, BLOBFILTERVC *filter);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            ESTRUTURA DE UMA ETIQUETAGEM INCREMENTAL
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+typedef struct {
+	int width, height;
+	int tilesize;				// Lado dos blocos (potência de 2)
+	int tileshift;				// log2(tilesize)
+	int tilesx, tilesy;
+	int frame;					// Número de frames processadas
+	unsigned char *mask;		// Imagem binária da última frame (0/1)
+	int *labels;				// Etiqueta de cada pixel (0 = fundo)
+	int *work;					// Etiquetas provisórias da região re-etiquetada
+	unsigned char *region;		// Blocos re-etiquetados na última frame
+	int *queue;					// Blocos por visitar ao fechar a região
+	int relabelled;				// Pixéis re-etiquetados na última frame
+	int nids;					// Etiquetas usadas: [1, nids[
+	int capacity;				// Etiquetas alocadas
+	int nblobs;					// Componentes actuais
+	struct vcblobacc *stats;	// Estatísticas de cada etiqueta (interno)
+	unsigned char *state;		// Estado de cada etiqueta (interno)
+	int *freeids;				// Etiquetas livres
+	int nfree;
+	int *parent;				// Union-find (interno)
+	int parentcapacity;
+} CCLVC;
+
+CCLVC *vc_ccl_new(int width, int height, int tilesize);
+CCLVC *vc_ccl_free(CCLVC *ccl);
+int vc_ccl_dirty_tiles(CCLVC *ccl, IVC *src, unsigned char *dirty);
+int vc_ccl_update(CCLVC *ccl, IVC *src, unsigned char *dirty);
+OVC *vc_ccl_blobs(CCLVC *ccl, int *nblobs);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           ESTRUTURA DE UMA IMAGEM BINÁRIA EM RUN-LENGTH
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+typedef struct {
+	int x0, x1;					// Coluna inicial e final do run (inclusive)
+	int label;					// Etiqueta (0 = sem etiqueta)
+} RUNVC;
+
+typedef struct {
+	int width, height;
+	int nruns;					// Número de runs
+	int capacity;				// Número de runs alocados
+	RUNVC *runs;				// Runs ordenados por linha e por coluna
+	int *rowstart;				// Índice do 1º run de cada linha (height + 1 entradas)
+} RLEVC;
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    PROTÓTIPOS DE FUNÇÕES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// FUNÇÕES: ALOCAR, LIBERTAR E CONVERTER UMA IMAGEM RLE
+RLEVC *vc_rle_new(int width, int height, int capacity);
+RLEVC *vc_rle_free(RLEVC *rle);
+int vc_rle_from_image(IVC *src, RLEVC *rle);
+int vc_rle_to_image(RLEVC *rle, IVC *dst, int uselabels);
+
+// FUNÇÕES: ETIQUETAGEM E MORFOLOGIA SOBRE RUNS
+OVC *vc_rle_labelling(RLEVC *rle, int *nlabels);
+int vc_rle_blob_info(RLEVC *rle, OVC *blobs, int nblobs);
+int vc_rle_dilate(RLEVC *src, RLEVC *dst, int kernel);
+int vc_rle_erode(RLEVC *src, RLEVC *dst, int kernel);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                   ESTRUTURA DE UM CONTORNO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+typedef struct {
+	int x, y;
+} POINTVC;
+
+typedef struct {
+	POINTVC *points;			// Contorno exterior ordenado (pixéis de fronteira)
+	int npoints;
+	int capacity;				// Número de pontos alocados
+	POINTVC *hull;				// Invólucro convexo (vértices por ordem)
+	int nhull;
+	float perimeter;			// Comprimento do contorno (passo recto = 1, diagonal = sqrt(2))
+	float hull_area;			// Área do invólucro convexo
+	float angle;				// Orientação do eixo maior, em graus [0, 180[
+	float rect_cx, rect_cy;		// Rectângulo de área mínima: centro
+	float rect_length;			// Rectângulo de área mínima: lado maior
+	float rect_width;			// Rectângulo de área mínima: lado menor
+	float rect_angle;			// Rectângulo de área mínima: orientação do lado maior, em graus [0, 180[
+} CONTOURVC;
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    PROTÓTIPOS DE FUNÇÕES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+CONTOURVC *vc_contour_new(void);
+CONTOURVC *vc_contour_free(CONTOURVC *contour);
+int vc_binary_blob_contour(IVC *src, OVC *blob, CONTOURVC *contour);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           ESTRUTURA DE UM PROCESSAMENTO LINHA A LINHA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_STREAM_MAX_STAGES	16
+
+// Operadores disponíveis num estágio
+#define VC_STAGE_RGB_TO_GRAY		1	// 3 canais -> 1 canal
+#define VC_STAGE_HSV_SEGMENTATION	2	// 3 canais (RGB) -> 1 canal (0/255)
+#define VC_STAGE_GRAY_TO_BINARY		3	// 1 canal -> 1 canal
+#define VC_STAGE_GRAY_NEGATIVE		4	// 1 canal -> 1 canal
+#define VC_STAGE_BINARY_DILATE		5	// 1 canal -> 1 canal, vizinhança kernel x kernel
+#define VC_STAGE_BINARY_ERODE		6	// 1 canal -> 1 canal, vizinhança kernel x kernel
+
+typedef struct {
+	int type;					// Operador (VC_STAGE_*)
+	int param[6];				// Parâmetros do operador
+	int radius;					// Linhas de vizinhança necessárias acima e abaixo
+	int channels_in, channels_out;
+	unsigned char *ring;		// Buffer circular com (2 * radius + 1) linhas de entrada
+	unsigned char **window;		// Linhas da vizinhança da linha a processar (NULL fora da imagem)
+	unsigned char *tmp;			// Linha auxiliar
+	unsigned char *out;			// Linha de saída
+	int nrows_in;				// Linhas de entrada recebidas
+	int nrows_out;				// Linhas de saída produzidas
+} STAGEVC;
+
+typedef struct {
+	int width, height;
+	int channels;				// Canais da imagem de entrada
+	int nstages;
+	STAGEVC stages[VC_STREAM_MAX_STAGES];
+	IVC *dst;					// Saída opcional (imagem)
+	RLEVC *rle;					// Saída opcional (runs, para etiquetagem)
+	int nrows_out;				// Linhas entregues às saídas
+} STREAMVC;
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    PROTÓTIPOS DE FUNÇÕES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+STREAMVC *vc_stream_new(int width, int height, int channels);
+STREAMVC *vc_stream_free(STREAMVC *stream);
+int vc_stream_add_rgb_to_gray(STREAMVC *stream);
+int vc_stream_add_hsv_segmentation(STREAMVC *stream, int hmin, int hmax, int smin, int smax, int vmin, int vmax);
+int vc_stream_add_gray_to_binary(STREAMVC *stream, int threshold);
+int vc_stream_add_gray_negative(STREAMVC *stream);
+int vc_stream_add_binary_dilate(STREAMVC *stream, int kernel);
+int vc_stream_add_binary_erode(STREAMVC *stream, int kernel);
+int vc_stream_run(STREAMVC *stream, IVC *src, IVC *dst, RLEVC *rle);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           ESTRUTURA DE UM GRAFO DE OPERADORES (PIPELINE)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_GRAPH_MAX_NODES		32
+#define VC_GRAPH_MAX_IMAGES		(VC_GRAPH_MAX_NODES + 8)
+
+// Operadores (nós do grafo). Cada nó lê 1 ou 2 imagens e escreve uma imagem nova.
+#define VC_OP_RGB_TO_GRAY		1	// vc_3channels_to_1channel
+#define VC_OP_GRAY_TO_BINARY	2	// vc_gray_to_binary_src_dst (param[0] = threshold)
+#define VC_OP_GRAY_NEGATIVE		3	// vc_gray_negative
+#define VC_OP_RGB_NEGATIVE		4	// vc_rgb_negative
+#define VC_OP_RGB_TO_HSV		5	// vc_rgb_to_hsv
+#define VC_OP_HSV_SEGMENTATION	6	// vc_hsv_segmentation (param[0..5] = hmin, hmax, smin, smax, vmin, vmax)
+#define VC_OP_BINARY_DILATE		7	// vc_binary_dilate (param[0] = kernel)
+#define VC_OP_BINARY_ERODE		8	// vc_binary_erode (param[0] = kernel)
+#define VC_OP_GRAY_DILATE		9	// vc_gray_dilate (param[0] = kernel)
+#define VC_OP_GRAY_ERODE		10	// vc_gray_erode (param[0] = kernel)
+#define VC_OP_BINARY_SUBTRACT	11	// vc_binary_subtract (src - src2)
+
+typedef struct {
+	int op;						// Operador (VC_OP_*)
+	int src, src2;				// Imagens de entrada (-1 = não usada)
+	int dst;					// Imagem de saída
+	int param[6];				// Parâmetros do operador
+} NODEVC;
+
+typedef struct {
+	int first, last;			// Nós fundidos neste grupo (índices em nodes, por ordem)
+	int src, src2, dst;			// Imagens lidas e escrita pelo grupo
+	int kernel;					// Forma de execução (VC_KERNEL_*, interno)
+	unsigned char lut[256];		// Tabela composta dos operadores ponto a ponto em cinzentos
+} GROUPVC;
+
+typedef struct {
+	int width, height;
+	int nimages;
+	int channels[VC_GRAPH_MAX_IMAGES];
+	int input[VC_GRAPH_MAX_IMAGES];		// Ordem da entrada externa (-1 = não é entrada)
+	int output[VC_GRAPH_MAX_IMAGES];	// Ordem da saída externa (-1 = não é saída)
+	int ninputs, noutputs;
+	int nnodes;
+	NODEVC nodes[VC_GRAPH_MAX_NODES];
+	// Programa compilado
+	int compiled;
+	int ngroups;
+	GROUPVC groups[VC_GRAPH_MAX_NODES];
+	int buffer[VC_GRAPH_MAX_IMAGES];	// Buffer interno de cada imagem (-1 = externa ou eliminada)
+	int nbuffers;
+	IVC *buffers[VC_GRAPH_MAX_IMAGES];
+} GRAPHVC;
+
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    PROTÓTIPOS DE FUNÇÕES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+GRAPHVC *vc_graph_new(int width, int height);
+GRAPHVC *vc_graph_free(GRAPHVC *graph);
+int vc_graph_input(GRAPHVC *graph, int channels);
+int vc_graph_node(GRAPHVC *graph, int op, int src, int src2, const int *param);
+int vc_graph_output(GRAPHVC *graph, int image);
+int vc_graph_compile(GRAPHVC *graph);
+int vc_graph_run(GRAPHVC *graph, IVC **inputs, IVC **outputs);
+void vc_graph_print(GRAPHVC *graph);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            KERNELS ESPECIALIZADOS (vc_kernels.cpp)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// vc_kernels.cpp é compilado em C++ e tem de entrar na build junto com vc.c e main.cpp:
+// vc.c chama estas funções, pelo que sem ele a ligação falha.
+// Kernels 3, 5, 7 e 9 com 1 ou 3 canais. Devolvem 0 se não houver versão especializada.
+int vc_kernel_gray_erode(IVC *src, IVC *dst, int kernel);
+int vc_kernel_gray_dilate(IVC *src, IVC *dst, int kernel);
+int vc_kernel_binary_dilate(IVC *src, IVC *dst, int kernel);
+int vc_kernel_binary_erode(IVC *src, IVC *dst, int kernel);
+int vc_kernel_niblack(IVC *src, IVC *dst, int kernel, float k);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    HISTOGRAMAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// hist tem 256 posições
+int vc_gray_histogram(IVC *src, int *hist);
+int vc_gray_histogram_benchmark(IVC *src, int iterations);
+int vc_gray_clahe(IVC *src, IVC *dst, int tilesx, int tilesy, float cliplimit);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           ESTRUTURA DE UM LIMIAR AUTOMÁTICO (VÍDEO)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_THRESHOLD_MEAN		1	// Média global
+#define VC_THRESHOLD_OTSU		2	// Otsu
+#define VC_THRESHOLD_TRIANGLE	3	// Triângulo
+
+#define VC_OTSU_MAX_THRESHOLDS	4	// Multi-Otsu: até 5 classes
+
+// O histograma é suavizado entre frames (média exponencial) e só é recalculado a cada
+// 'period' frames; nos restantes é usado o limiar anterior.
+typedef struct {
+	int method;				// VC_THRESHOLD_*
+	float alpha;			// Peso do histograma novo (]0,1], 1 = sem suavização)
+	int period;				// Recalcular o histograma a cada 'period' frames (>= 1)
+	int frame;				// Número de frames processados
+	float smooth[256];		// Histograma suavizado
+	int threshold;			// Último limiar calculado
+} THRESHVC;
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                    PROTÓTIPOS DE FUNÇÕES
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Escolha do limiar a partir de um histograma (os pixéis > limiar ficam a 255)
+int vc_histogram_mean(const int *hist);
+int vc_histogram_otsu(const int *hist);
+int vc_histogram_multi_otsu(const int *hist, int nthresholds, int *thresholds);
+int vc_histogram_triangle(const int *hist);
+
+int vc_gray_to_binary_otsu(IVC *src, IVC *dst);
+int vc_gray_to_binary_triangle(IVC *src, IVC *dst);
+int vc_gray_multi_otsu(IVC *src, IVC *dst, int nthresholds, int *thresholds);
+
+void vc_threshold_init(THRESHVC *state, int method, float alpha, int period);
+int vc_gray_to_binary_auto(IVC *src, IVC *dst, THRESHVC *state);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 TABELAS DE CONSULTA (LUT)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Uma tabela de 1 canal tem 256 entradas; uma tabela de 3 canais tem 3 x 256 entradas
+// (tabela do canal 0, seguida das do canal 1 e do canal 2).
+void vc_lut_identity(unsigned char *lut);
+void vc_lut_negative(unsigned char *lut);
+void vc_lut_threshold(unsigned char *lut, int threshold);
+void vc_lut_equalization(unsigned char *lut, const int *hist, int levels);
+void vc_lut_false_color(unsigned char *lut3);
+void vc_lut_compose(unsigned char *lut, const unsigned char *first, const unsigned char *second);
+
+int vc_lut_apply(IVC *src, IVC *dst, const unsigned char *lut);
+int vc_lut3_apply(IVC *src, IVC *dst, const unsigned char *lut3);
+int vc_lut_gray_to_rgb(IVC *src, IVC *dst, const unsigned char *lut3);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 ORDEM DOS CANAIS DE COR
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Ordem dos bytes de cada pixel. As imagens do OpenCV (cv::Mat, cv::VideoCapture) estão em BGR.
+// Em BGRA (4 canais) o alfa não é alterado pelos operadores de cor.
+#define VC_ORDER_RGB	0
+#define VC_ORDER_BGR	1
+#define VC_ORDER_BGRA	2
+
+// As funções RGB sem ordem (vc_rgb_to_hsv, vc_rgb_get_red_gray, ...) equivalem a VC_ORDER_RGB
+int vc_rgb_to_gray(IVC *src, IVC *dst, int order);
+int vc_rgb_to_gray_accuracy(void);
+int vc_rgb_negative_order(IVC *srcdst, int order);
+int vc_rgb_get_gray_component(IVC *srcdst, int order, int component);
+int vc_rgb_to_hsv_order(IVC *srcdst, int order);
+int vc_hsv_to_rgb_order(IVC *srcdst, int order);
+int vc_color_hsv_segmentation(IVC *src, IVC *dst, int order, int hmin, int hmax, int smin,
+							  int smax, int vmin, int vmax);
+int vc_scale_gray_to_rgb_order(IVC *src, IVC *dst, int order);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 TRANSFORMADA DE DISTÂNCIA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_DIST_EUCLIDEAN	1	// Distância euclidiana ao quadrado (exacta)
+#define VC_DIST_CHAMFER34	2	// Distância chanfrada 3-4 (em terços de pixel)
+#define VC_DIST_INF			0x3fffffff	// Sem pixéis de fundo
+
+int vc_binary_distance_transform(IVC *src, int *dist, int metric);
+
+// Morfologia com um disco de raio arbitrário (custo independente do raio)
+int vc_binary_erode_disc(IVC *src, IVC *dst, int radius);
+int vc_binary_dilate_disc(IVC *src, IVC *dst, int radius);
+int vc_binary_open_disc(IVC *src, IVC *dst, int radius);
+int vc_binary_close_disc(IVC *src, IVC *dst, int radius);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 DESCODIFICAÇÃO DE RESISTÊNCIAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Cores das bandas (o valor é o dígito)
+#define VC_BAND_BLACK		0
+#define VC_BAND_BROWN		1
+#define VC_BAND_RED			2
+#define VC_BAND_ORANGE		3
+#define VC_BAND_YELLOW		4
+#define VC_BAND_GREEN		5
+#define VC_BAND_BLUE		6
+#define VC_BAND_VIOLET		7
+#define VC_BAND_GREY		8
+#define VC_BAND_WHITE		9
+#define VC_BAND_GOLD		10
+#define VC_BAND_SILVER		11
+#define VC_BAND_NONE		12	// Não é cor de banda (corpo bege, fundo)
+
+// Tabela de cores: RGB com 5 bits por canal
+#define VC_RESISTOR_TABLE_SIZE	32768
+#define VC_RESISTOR_INDEX(r, g, b)	((((r) >> 3) << 10) | (((g) >> 3) << 5) | ((b) >> 3))
+
+#define VC_RESISTOR_MAX_BANDS	6
+
+typedef struct {
+	int nbands;
+	int bands[VC_RESISTOR_MAX_BANDS];	// Cores das bandas (VC_BAND_*), pela ordem de leitura
+	double value;						// Resistência, em ohms
+	float tolerance;					// Tolerância, em %
+	int nsamples;						// Pontos amostrados no perfil
+} RESISTORVC;
+
+void vc_resistor_color_table(unsigned char *table);
+int vc_resistor_color_table_range(unsigned char *table, int band, int hmin, int hmax, int smin, int smax, int vmin, int vmax);
+const char *vc_resistor_band_name(int band);
+int vc_resistor_decode_axis(IVC *src, int order, float cx, float cy, float angle, float length, float width,
+							const unsigned char *table, RESISTORVC *resistor);
+int vc_resistor_decode(IVC *src, int order, IVC *labels, OVC *blob, const unsigned char *table, RESISTORVC *resistor);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 REGIÕES ORIENTADAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+int vc_warp_oriented_roi(IVC *src, IVC *dst, float cx, float cy, float angle);
+int vc_blob_oriented_roi(IVC *src, OVC *blob, IVC *dst);
+int vc_resistor_decode_strip(IVC *strip, int order, const unsigned char *table, RESISTORVC *resistor);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              ESCALONADOR COM ORÇAMENTO POR FRAME
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Etapas medidas
+#define VC_SCHED_SEGMENT	0	// Segmentação HSV
+#define VC_SCHED_MORPH		1	// Morfologia
+#define VC_SCHED_LABEL		2	// Etiquetagem e filtro dos blobs
+#define VC_SCHED_DECODE		3	// Descodificação das bandas
+#define VC_SCHED_STAGES		4
+
+// Degradações (bits), aplicadas por esta ordem à medida que o nível sobe
+#define VC_DEGRADE_KERNEL	1	// Kernels morfológicos menores
+#define VC_DEGRADE_ROI		2	// Só as regiões dos objectos seguidos
+#define VC_DEGRADE_PYRAMID	4	// Nível 1 da pirâmide (metade da resolução)
+#define VC_DEGRADE_SKIP		8	// Frame saltada (uma em cada duas)
+#define VC_DEGRADE_COUNT	4
+
+#define VC_SCHED_LEVELS		5	// Níveis de degradação: 0 (nenhuma) a 4 (todas)
+
+typedef struct {
+	double budget;						// Orçamento por frame, em segundos
+	double stage[VC_SCHED_STAGES];		// Duração de cada etapa na última frame processada
+	double average[VC_SCHED_STAGES];		// Média exponencial da duração de cada etapa
+	double total;						// Duração da última frame processada
+	double predicted;					// Média exponencial da duração das frames (0 = sem dados)
+	double tstart, tmark;				// Início da frame e da etapa actual (interno)
+	int level;							// Nível de degradação actual
+	int flags;							// Degradações aplicadas na frame actual (VC_DEGRADE_*)
+	int frame;							// Frames vistas
+	int calm;							// Frames seguidas com folga (interno)
+	int overruns;						// Frames processadas acima do orçamento
+	int count[VC_DEGRADE_COUNT];		// Frames com cada degradação
+} SCHEDVC;
+
+void vc_sched_init(SCHEDVC *sched, double budget);
+int vc_sched_begin_frame(SCHEDVC *sched);
+void vc_sched_stage_end(SCHEDVC *sched, int stage);
+void vc_sched_end_frame(SCHEDVC *sched);
+void vc_sched_print(SCHEDVC *sched);
+void vc_sched_summary(SCHEDVC *sched);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 PIPELINE DE RESISTÊNCIAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_RESISTOR_PIPE_MAX	64
+
+typedef struct {
+	// Parâmetros (alteráveis entre frames)
+	int hmin, hmax, smin, smax, vmin, vmax;	// Corpo das resistências (H em [0,360], S e V em [0,100])
+	int closesize;							// Kernel do fecho (ímpar; <= 1 desliga)
+	BLOBFILTERVC filter;					// Filtro dos blobs, em resolução completa
+	int margin;								// Margem à volta dos objectos seguidos (modo ROI)
+	int refresh;							// No modo ROI, frame completa de 'refresh' em 'refresh' frames
+	// Imagens de trabalho ([0] resolução completa, [1] metade)
+	int width, height;
+	IVC *half;
+	IVC *mask[2], *tmp[2], *labels[2];
+	unsigned char *table;					// Tabela de cores das bandas
+	int frame;								// Frames processadas
+	// Resultados da última frame (mantidos nas frames saltadas)
+	int nfound;
+	OVC blobs[VC_RESISTOR_PIPE_MAX];		// Em coordenadas da frame
+	RESISTORVC resistors[VC_RESISTOR_PIPE_MAX];
+} RESISTORPIPEVC;
+
+int vc_image_pyramid_down(IVC *src, IVC *dst);
+RESISTORPIPEVC *vc_resistor_pipe_new(int width, int height);
+RESISTORPIPEVC *vc_resistor_pipe_free(RESISTORPIPEVC *pipe);
+int vc_resistor_pipe_set(RESISTORPIPEVC *pipe, const char *key, const char *value);
+int vc_resistor_pipe_run(RESISTORPIPEVC *pipe, IVC *frame, int order, SCHEDVC *sched);
+int vc_resistor_pipe_run_many(RESISTORPIPEVC **pipes, IVC **frames, int order, SCHEDVC **scheds, int n, int first);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                 AVALIAÇÃO DO PIPELINE
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Anotação (ground truth) de uma resistência numa frame
+typedef struct {
+	int frame;					// Número da frame (a começar em 1)
+	int x, y, width, height;	// Bounding box
+	double value;				// Resistência, em ohms (0 = não avaliada)
+} ANNOTVC;
+
+// Resultados acumulados de um pipeline ao longo de várias frames
+typedef struct {
+	int nframes;
+	double *latency;			// Duração de cada frame, em segundos
+	int capacity;
+	double total;				// Soma das durações
+	int detections;				// Blobs devolvidos
+	int tp, fp, fn;				// Detecções certas, a mais e em falta
+	int valued, correct;		// Detecções certas com valor anotado, e com o valor lido certo
+} SCOREVC;
+
+ANNOTVC *vc_annotations_read(const char *filename, int *nannotations);
+void vc_score_init(SCOREVC *score);
+void vc_score_free(SCOREVC *score);
+int vc_score_frame(SCOREVC *score, RESISTORPIPEVC *pipe, int frame, const ANNOTVC *annotations, int nannotations, double latency);
+double vc_score_percentile(SCOREVC *score, double p);
+double vc_score_f1(SCOREVC *score);
+int vc_pareto_front(const double *x, const double *y, int n, int *front);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           ARQUIVO DE FRAMES DESCODIFICADAS (RAW)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#define VC_FRAMES_HEADER	64	// Bytes do cabeçalho (as frames começam alinhadas a 64 bytes)
+
+typedef struct {
+	int width, height, channels;
+	int fps;
+	int nframes;
+	int framesize;				// width * height * channels
+	unsigned char *data;		// Frames contíguas (leitura)
+	void *file;					// Ficheiro aberto para escrita (interno)
+	void *map;					// Ficheiro mapeado em memória (interno, NULL se foi lido)
+	long long mapsize;			// Bytes mapeados
+} FRAMESVC;
+
+FRAMESVC *vc_frames_create(const char *filename, int width, int height, int channels, int fps);
+int vc_frames_append(FRAMESVC *frames, IVC *frame);
+FRAMESVC *vc_frames_open(const char *filename);
+FRAMESVC *vc_frames_close(FRAMESVC *frames);
+int vc_frames_get(FRAMESVC *frames, int index, IVC *frame);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//               REGRESSÃO COM CHECKSUMS DE REFERÊNCIA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+unsigned int vc_checksum(const void *data, int size, unsigned int hash);
+unsigned int vc_image_checksum(IVC *image);
+int vc_regress_count(void);
+const char *vc_regress_name(int check);
+int vc_regress_frame(IVC *frame, int order, unsigned int *checksums);
+int vc_fuzz(int iterations, unsigned int seed, int verbose);
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //                    MACROS
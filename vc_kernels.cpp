@@ -0,0 +1,306 @@
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            KERNELS ESPECIALIZADOS POR CANAIS E TAMANHO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Versões em template dos operadores de vizinhança de vc.c, com o número de canais (C) e o
+// tamanho do kernel (K = 3, 5, 7, 9) conhecidos em tempo de compilação. O interior da imagem
+// é percorrido sem verificação de limites e com os K x K acessos desenrolados pelo compilador;
+// só o rebordo (R = (K - 1) / 2 pixéis) usa o ciclo com verificações.
+// As funções devolvem 0 quando não há versão especializada e a função de vc.c segue o
+// caminho genérico. Os resultados são iguais aos do caminho genérico.
+
+#include <math.h>
+
+extern "C"
+{
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            Operações de vizinhança
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Cada operação define o valor inicial, a acumulação de um vizinho e o valor final do pixel
+
+// Erosão em cinzentos (vc_gray_erode): mínimo da vizinhança
+struct VcMinOp
+{
+	static inline int init() { return 255; }
+	static inline int acc(int a, int v) { return (v < a) ? v : a; }
+	static inline unsigned char out(int a) { return (unsigned char)a; }
+};
+
+// Dilatação em cinzentos (vc_gray_dilate): máximo da vizinhança
+struct VcMaxOp
+{
+	static inline int init() { return 0; }
+	static inline int acc(int a, int v) { return (v > a) ? v : a; }
+	static inline unsigned char out(int a) { return (unsigned char)a; }
+};
+
+// Dilatação binária (vc_binary_dilate): 255 se algum vizinho for 255
+struct VcAnyWhiteOp
+{
+	static inline int init() { return 0; }
+	static inline int acc(int a, int v) { return a | (v == 255); }
+	static inline unsigned char out(int a) { return a ? 255 : 0; }
+};
+
+// Erosão binária (vc_binary_erode): AND de todos os vizinhos, 0 se o resultado for 0
+struct VcAndOp
+{
+	static inline int init() { return 255; }
+	static inline int acc(int a, int v) { return a & v; }
+	static inline unsigned char out(int a) { return a ? 255 : 0; }
+};
+
+// Verifica se src e dst são compatíveis com os kernels especializados
+static bool vc_kernel_check(IVC *src, IVC *dst)
+{
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL))
+		return false;
+	if ((src->width <= 0) || (src->height <= 0))
+		return false;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels))
+		return false;
+
+	// Com src == dst o caminho genérico lê pixéis já escritos; mantém-se esse comportamento
+	return src->data != dst->data;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            Morfologia (erosão e dilatação)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Pixel do rebordo: ignora os vizinhos fora da imagem
+template <int C, int K, class Op>
+static inline unsigned char vc_kernel_morph_border(const unsigned char *data, int width, int height, int bytesperline, int x, int y, int c)
+{
+	const int R = (K - 1) / 2;
+	int a = Op::init();
+
+	for (int ky = -R; ky <= R; ky++)
+	{
+		if ((y + ky < 0) || (y + ky >= height))
+			continue;
+
+		for (int kx = -R; kx <= R; kx++)
+		{
+			if ((x + kx < 0) || (x + kx >= width))
+				continue;
+
+			a = Op::acc(a, data[(y + ky) * bytesperline + (x + kx) * C + c]);
+		}
+	}
+
+	return Op::out(a);
+}
+
+template <int C, int K, class Op>
+static void vc_kernel_morph(IVC *src, IVC *dst)
+{
+	const int R = (K - 1) / 2;
+	const unsigned char *datasrc = src->data;
+	unsigned char *datadst = dst->data;
+	int width = src->width;
+	int height = src->height;
+	int bytesperline = src->bytesperline;
+	const unsigned char *rows[K];
+
+	for (int y = 0; y < height; y++)
+	{
+		unsigned char *out = &datadst[y * dst->bytesperline];
+
+		// Linhas do rebordo (ou imagem mais estreita do que o kernel)
+		if ((y < R) || (y >= height - R) || (width <= 2 * R))
+		{
+			for (int x = 0; x < width; x++)
+				for (int c = 0; c < C; c++)
+					out[x * C + c] = vc_kernel_morph_border<C, K, Op>(datasrc, width, height, bytesperline, x, y, c);
+			continue;
+		}
+
+		for (int ky = 0; ky < K; ky++)
+			rows[ky] = &datasrc[(y - R + ky) * bytesperline];
+
+		// Rebordo esquerdo
+		for (int x = 0; x < R; x++)
+			for (int c = 0; c < C; c++)
+				out[x * C + c] = vc_kernel_morph_border<C, K, Op>(datasrc, width, height, bytesperline, x, y, c);
+
+		// Interior: sem verificações de limites
+		for (int x = R; x < width - R; x++)
+		{
+			for (int c = 0; c < C; c++)
+			{
+				int a = Op::init();
+
+				for (int ky = 0; ky < K; ky++)
+					for (int kx = 0; kx < K; kx++)
+						a = Op::acc(a, rows[ky][(x - R + kx) * C + c]);
+
+				out[x * C + c] = Op::out(a);
+			}
+		}
+
+		// Rebordo direito
+		for (int x = width - R; x < width; x++)
+			for (int c = 0; c < C; c++)
+				out[x * C + c] = vc_kernel_morph_border<C, K, Op>(datasrc, width, height, bytesperline, x, y, c);
+	}
+}
+
+template <int C, class Op>
+static int vc_kernel_morph_k(IVC *src, IVC *dst, int kernel)
+{
+	switch (kernel)
+	{
+	case 3:
+		vc_kernel_morph<C, 3, Op>(src, dst);
+		return 1;
+	case 5:
+		vc_kernel_morph<C, 5, Op>(src, dst);
+		return 1;
+	case 7:
+		vc_kernel_morph<C, 7, Op>(src, dst);
+		return 1;
+	case 9:
+		vc_kernel_morph<C, 9, Op>(src, dst);
+		return 1;
+	}
+
+	return 0;
+}
+
+template <class Op>
+static int vc_kernel_morph_dispatch(IVC *src, IVC *dst, int kernel)
+{
+	if (!vc_kernel_check(src, dst))
+		return 0;
+
+	switch (src->channels)
+	{
+	case 1:
+		return vc_kernel_morph_k<1, Op>(src, dst, kernel);
+	case 3:
+		return vc_kernel_morph_k<3, Op>(src, dst, kernel);
+	}
+
+	return 0;
+}
+
+int vc_kernel_gray_erode(IVC *src, IVC *dst, int kernel)
+{
+	return vc_kernel_morph_dispatch<VcMinOp>(src, dst, kernel);
+}
+
+int vc_kernel_gray_dilate(IVC *src, IVC *dst, int kernel)
+{
+	return vc_kernel_morph_dispatch<VcMaxOp>(src, dst, kernel);
+}
+
+int vc_kernel_binary_dilate(IVC *src, IVC *dst, int kernel)
+{
+	return vc_kernel_morph_dispatch<VcAnyWhiteOp>(src, dst, kernel);
+}
+
+int vc_kernel_binary_erode(IVC *src, IVC *dst, int kernel)
+{
+	return vc_kernel_morph_dispatch<VcAndOp>(src, dst, kernel);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            Binarização adaptativa (Niblack)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Reproduz as operações em vírgula flutuante de vc_gray_to_binary_niblack pela mesma ordem
+// (média em float, desvios ao quadrado somados em double), para dar resultados iguais.
+// Tal como no caminho genérico, a média e o desvio padrão dividem sempre por K * K.
+template <int C, int K, bool Border>
+static inline unsigned char vc_kernel_niblack_pixel(const unsigned char *data, int width, int height, int bytesperline, int x, int y, float k)
+{
+	const int R = (K - 1) / 2;
+	float mean = 0.0f;
+	float stdDev = 0.0f;
+	float threshold;
+
+	for (int ky = -R; ky <= R; ky++)
+	{
+		for (int kx = -R; kx <= R; kx++)
+		{
+			if (Border && ((y + ky < 0) || (y + ky >= height) || (x + kx < 0) || (x + kx >= width)))
+				continue;
+
+			mean += data[(y + ky) * bytesperline + (x + kx) * C];
+		}
+	}
+
+	mean = mean / (K * K);
+
+	for (int ky = -R; ky <= R; ky++)
+	{
+		for (int kx = -R; kx <= R; kx++)
+		{
+			if (Border && ((y + ky < 0) || (y + ky >= height) || (x + kx < 0) || (x + kx >= width)))
+				continue;
+
+			double d = (double)(data[(y + ky) * bytesperline + (x + kx) * C] - mean);
+			stdDev = (float)(stdDev + d * d);
+		}
+	}
+
+	stdDev = (float)sqrt(stdDev / (K * K));
+
+	threshold = mean + k * stdDev;
+
+	return (data[y * bytesperline + x * C] <= threshold) ? 0 : 255;
+}
+
+template <int C, int K>
+static void vc_kernel_niblack_k(IVC *src, IVC *dst, float k)
+{
+	const int R = (K - 1) / 2;
+	const unsigned char *datasrc = src->data;
+	unsigned char *datadst = dst->data;
+	int width = src->width;
+	int height = src->height;
+	int bytesperline = src->bytesperline;
+
+	for (int y = 0; y < height; y++)
+	{
+		unsigned char *out = &datadst[y * dst->bytesperline];
+		bool border = (y < R) || (y >= height - R) || (width <= 2 * R);
+
+		for (int x = 0; x < width; x++)
+		{
+			if (border || (x < R) || (x >= width - R))
+				out[x * C] = vc_kernel_niblack_pixel<C, K, true>(datasrc, width, height, bytesperline, x, y, k);
+			else
+				out[x * C] = vc_kernel_niblack_pixel<C, K, false>(datasrc, width, height, bytesperline, x, y, k);
+		}
+	}
+}
+
+int vc_kernel_niblack(IVC *src, IVC *dst, int kernel, float k)
+{
+	if (!vc_kernel_check(src, dst) || (src->channels != 1))
+		return 0;
+
+	switch (kernel)
+	{
+	case 3:
+		vc_kernel_niblack_k<1, 3>(src, dst, k);
+		return 1;
+	case 5:
+		vc_kernel_niblack_k<1, 5>(src, dst, k);
+		return 1;
+	case 7:
+		vc_kernel_niblack_k<1, 7>(src, dst, k);
+		return 1;
+	case 9:
+		vc_kernel_niblack_k<1, 9>(src, dst, k);
+		return 1;
+	}
+
+	return 0;
+}